@@ -0,0 +1,107 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Action.cpp
+/// @brief   Base class for defining forces capable of effecting the
+///          evolution of Motion objects.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <stdexcept>
+
+// ekf Library
+#include <Action.hpp>
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Scalar fallback for actions without a vectorized kernel
+void
+Action::
+getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const
+{
+  for ( int l = 0; l < BatchKinematics::kLanes; ++l )
+  {
+    double laneAcceleration[3] = { 0.0, 0.0, 0.0 };
+    getAcceleration( laneAcceleration, kinematics.lane( l ) );
+    for ( int i = 0; i < 3; ++i )
+    {
+      acceleration[i]( l ) += laneAcceleration[i];
+    }
+  }
+}
+
+// Actions without a templated acceleration have no automatic partials
+void
+Action::
+evaluateAutomatic(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  evaluate( acceleration, partials, kinematics, index );
+}
+
+// Look up where each owned agent sits in the active agent list.
+AgentIndex
+Action::
+indexAgents( const std::vector< std::string > &activeAgents ) const
+{
+  const std::vector< std::string > &owned = getAgentsOwned();
+
+  AgentIndex index;
+  index.numAgents = activeAgents.size();
+  index.position.assign( owned.size(), -1 );
+  for ( std::size_t i = 0; i < owned.size(); ++i )
+  {
+    std::vector< std::string >::const_iterator search =
+      std::find( activeAgents.begin(), activeAgents.end(), owned[i] );
+    if ( search != activeAgents.end() )
+    {
+      index.position[i] = search - activeAgents.begin();
+    }
+  }
+  return index;
+}
+
+// All actions must agree on the rotation of the body they work in.
+double
+Action::
+bodyRotationRate(
+    const std::vector< std::shared_ptr< Action > > &actions )
+{
+  std::vector< double > rates;
+  for ( const std::shared_ptr< Action > &ap: actions )
+  {
+    rates.push_back( ap->getRotationRate() );
+  }
+  return bodyRotationRate( rates );
+}
+
+double
+Action::
+bodyRotationRate( const std::vector< double > &rates )
+{
+  double rotation = 0.0;
+  for ( double rate: rates )
+  {
+    if ( rate == 0.0 )
+    {
+      continue;
+    }
+    if ( rotation != 0.0 && rate != rotation )
+    {
+      throw std::invalid_argument(
+        "Actions have different body rotation rates" );
+    }
+    rotation = rate;
+  }
+  return rotation;
+}
@@ -12,8 +12,29 @@
 #define EKF_ACTION_HEADER_GUARD
 
 // C++ Standard Library
+#include <memory>
+#include <string>
 #include <vector>
 
+// ekf Library
+#include <BatchKinematics.hpp>
+#include <Kinematics.hpp>
+
+/// @brief Position of the agents owned by an Action within the list of
+/// active agents of a Motion.
+///
+/// This is resolved once, when agents are activated, so that Actions
+/// can write their partials straight into the row-major partials block
+/// without looking anything up by name during integration.
+///
+struct AgentIndex
+{
+  // Number of active agents, i.e. the dimension of the partials block.
+  int numAgents;
+  // Active agent position of each owned agent, or -1 if it is inactive.
+  std::vector< int > position;
+};
+
 class Action
 {
  public:
@@ -21,15 +42,59 @@ class Action
   Action(){};
 
   // Computes the acceleration due to this action and adds it to the
-  // passed in vector "acceleration".
-  virtual void getAcceleration( std::vector< double > &acceleration,
-                                const std::vector< double > &state ) const = 0;
-
-  // Computes the partial derivative of the acceleration terms and owned
-  // parameters
-  virtual void getPartials( std::vector < double > &partials,
-                            const std::vector< double > &state,
-                            const std::vector< std::string >  &activeAgents ) = 0;
+  // passed in array "acceleration", given the geometry of the current
+  // stage. Used when only the state is propagated.
+  virtual void getAcceleration( double *acceleration,
+                                const Kinematics &kinematics ) const = 0;
+
+  // Computes the accelerations due to this action for a group of
+  // agents, one per lane, and adds them to the X, Y, Z lanes in
+  // "acceleration". The default calls getAcceleration lane by lane;
+  // actions override it with vectorized array expressions.
+  virtual void getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const;
+
+  // Computes the acceleration due to this action together with its
+  // partial derivatives wrt the active agents, sharing the intermediate
+  // terms between the two. The acceleration is added to "acceleration"
+  // and the partials to the 3 x numAgents row-major "partials" block at
+  // the columns given by "index". These are the only non-trivial rows
+  // of the A matrix; the others follow from the kinematics and are
+  // handled by OdeintHelper.
+  virtual void evaluate( double *acceleration,
+                         double *partials,
+                         const Kinematics &kinematics,
+                         const AgentIndex &index ) const = 0;
+
+  // Same as evaluate, with the partials found by forward-mode automatic
+  // differentiation ( see Dual ) of the action's acceleration instead
+  // of by hand. It is several times slower than evaluate and serves as
+  // the reference evaluate is checked against. The default calls
+  // evaluate.
+  virtual void evaluateAutomatic( double *acceleration,
+                                  double *partials,
+                                  const Kinematics &kinematics,
+                                  const AgentIndex &index ) const;
+
+  // Rotation rate about Z of the body this action models, or zero if it
+  // does not depend on one. Used to fill in Kinematics.
+  virtual double getRotationRate() const { return 0.0; }
+
+  // Names of the agents this action owns partials for. The order of
+  // this list is the order of AgentIndex::position.
+  virtual const std::vector< std::string >& getAgentsOwned() const = 0;
+
+  // Resolve the owned agents against a list of active agent names
+  AgentIndex indexAgents(
+    const std::vector< std::string > &activeAgents ) const;
+
+  // The body rotation rate shared by "actions", zero if none has one.
+  // Throws std::invalid_argument if two actions have different rates.
+  static double bodyRotationRate(
+    const std::vector< std::shared_ptr< Action > > &actions );
+  static double bodyRotationRate( const std::vector< double > &rates );
+
   // Destructor
   virtual ~Action(){};
 
@@ -37,6 +102,22 @@ class Action
     /// @todo this needs to go eventually
     const bool m_debug = false;
 
+    // Rows of the acceleration partials block
+    enum AccelerationComponent { kAccX, kAccY, kAccZ };
+
+    // Add "value" to the partial of acceleration "component" wrt owned
+    // agent "bottom", if it is active.
+    static void addPartial( double *partials,
+                            const AgentIndex &index,
+                            int component, int bottom, double value )
+    {
+      int col = index.position[ bottom ];
+      if ( col >= 0 )
+      {
+        partials[ component * index.numAgents + col ] += value;
+      }
+    }
+
   private:
 };
 
@@ -0,0 +1,102 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ActionList.cpp
+/// @brief   Force model made of Actions chosen at run time.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// ekf Library
+#include <ActionList.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+ActionList::
+ActionList()
+    : m_actions(),
+      m_agentIndices()
+{
+}
+
+ActionList::
+ActionList( const std::vector< std::shared_ptr< Action > > &actions )
+    : m_actions( actions ),
+      m_agentIndices()
+{
+}
+
+ActionList::
+~ActionList()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an action
+void
+ActionList::
+push_back( std::shared_ptr< Action > a )
+{
+  m_actions.push_back( a );
+}
+
+// Number of actions in the list
+std::size_t
+ActionList::
+size() const
+{
+  return m_actions.size();
+}
+
+// Resolve the agents owned by each action against the active agents
+void
+ActionList::
+activateAgents( const std::vector< std::string > &activeAgents )
+{
+  m_agentIndices.clear();
+  for ( const std::shared_ptr< Action > &ap: m_actions )
+  {
+    m_agentIndices.push_back( ap->indexAgents( activeAgents ) );
+  }
+}
+
+// The body rotation rate shared by the actions
+double
+ActionList::
+getRotationRate() const
+{
+  return Action::bodyRotationRate( m_actions );
+}
+
+// Sum the accelerations of all actions
+void
+ActionList::
+getAcceleration(
+    double *acceleration,
+    const Kinematics &kinematics ) const
+{
+  for ( const std::shared_ptr< Action > &ap: m_actions )
+  {
+    ap->getAcceleration( acceleration, kinematics );
+  }
+}
+
+// Sum the accelerations and acceleration partials of all actions
+void
+ActionList::
+evaluate(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics ) const
+{
+  for ( std::size_t k = 0; k < m_actions.size(); ++k )
+  {
+    m_actions[k]->evaluate( acceleration, partials, kinematics,
+                            m_agentIndices[k] );
+  }
+}
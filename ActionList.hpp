@@ -0,0 +1,65 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ActionList.hpp
+/// @brief   Force model made of Actions chosen at run time.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ACTIONLIST_HEADER_GUARD
+#define EKF_ACTIONLIST_HEADER_GUARD
+
+// C++ Standard Library
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Kinematics.hpp>
+
+/// @brief Force model made of Actions chosen at run time.
+///
+/// Holds any number of Actions behind shared pointers and sums their
+/// contributions through virtual calls. This is the configurable force
+/// model; ActionSet is its compile-time counterpart and has the same
+/// interface, so FixedOdeintHelper and FixedMotion take either.
+///
+class ActionList
+{
+ public:
+  ActionList();
+  ActionList( const std::vector< std::shared_ptr< Action > > &actions );
+ ~ActionList();
+
+  // Add an action. activateAgents() must be called again afterwards.
+  void push_back( std::shared_ptr< Action > a );
+
+  // Number of actions in the list
+  std::size_t size() const;
+
+  // Resolve the agents owned by each action against the active agents
+  void activateAgents( const std::vector< std::string > &activeAgents );
+
+  // The body rotation rate shared by the actions, see
+  // Action::bodyRotationRate
+  double getRotationRate() const;
+
+  // Sum the accelerations of all actions
+  void getAcceleration( double *acceleration,
+                        const Kinematics &kinematics ) const;
+
+  // Sum the accelerations and acceleration partials of all actions,
+  // see Action::evaluate
+  void evaluate( double *acceleration,
+                 double *partials,
+                 const Kinematics &kinematics ) const;
+
+ private:
+  std::vector< std::shared_ptr< Action > > m_actions;
+  std::vector< AgentIndex > m_agentIndices;
+};
+
+#endif // EKF_ACTIONLIST_HEADER_GUARD
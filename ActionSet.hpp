@@ -0,0 +1,236 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ActionSet.hpp
+/// @brief   Force model made of Actions chosen at compile time.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ACTIONSET_HEADER_GUARD
+#define EKF_ACTIONSET_HEADER_GUARD
+
+// C++ Standard Library
+#include <array>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Kinematics.hpp>
+
+/// @brief Force model made of Actions chosen at compile time, e.g.
+/// ActionSet< GravityAction, AtmosphereAction >.
+///
+/// The Actions are held by value in a std::tuple and called by
+/// qualified name, so every call is a direct call the compiler may
+/// inline: there is no virtual dispatch and no shared_ptr to copy. It
+/// has the same interface as ActionList and can replace it in
+/// FixedOdeintHelper and FixedMotion when the force model is known
+/// when building.
+///
+template< class... Actions >
+class ActionSet
+{
+ public:
+  typedef std::tuple< Actions... > tuple_type;
+
+  ActionSet( const Actions&... actions );
+ ~ActionSet();
+
+  // Number of actions in the set
+  static constexpr std::size_t size() { return sizeof...( Actions ); }
+
+  // Action number I of the set
+  template< std::size_t I >
+  const typename std::tuple_element< I, tuple_type >::type& get() const;
+
+  // Resolve the agents owned by each action against the active agents
+  void activateAgents( const std::vector< std::string > &activeAgents );
+
+  // The body rotation rate shared by the actions, see
+  // Action::bodyRotationRate
+  double getRotationRate() const;
+
+  // Sum the accelerations of all actions
+  void getAcceleration( double *acceleration,
+                        const Kinematics &kinematics ) const;
+
+  // Sum the accelerations and acceleration partials of all actions,
+  // see Action::evaluate
+  void evaluate( double *acceleration,
+                 double *partials,
+                 const Kinematics &kinematics ) const;
+
+ private:
+  tuple_type m_actions;
+  std::array< AgentIndex, sizeof...( Actions ) > m_agentIndices;
+
+  // Recursion over the tuple, one instantiation per action
+  template< std::size_t I >
+  typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+  activateFrom( const std::vector< std::string > &activeAgents );
+  template< std::size_t I >
+  typename std::enable_if< ( I == sizeof...( Actions ) ) >::type
+  activateFrom( const std::vector< std::string > & ) {}
+
+  template< std::size_t I >
+  typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+  ratesFrom( std::vector< double > &rates ) const;
+  template< std::size_t I >
+  typename std::enable_if< ( I == sizeof...( Actions ) ) >::type
+  ratesFrom( std::vector< double > & ) const {}
+
+  template< std::size_t I >
+  typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+  accelerationFrom( double *acceleration,
+                    const Kinematics &kinematics ) const;
+  template< std::size_t I >
+  typename std::enable_if< ( I == sizeof...( Actions ) ) >::type
+  accelerationFrom( double *, const Kinematics & ) const {}
+
+  template< std::size_t I >
+  typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+  evaluateFrom( double *acceleration,
+                double *partials,
+                const Kinematics &kinematics ) const;
+  template< std::size_t I >
+  typename std::enable_if< ( I == sizeof...( Actions ) ) >::type
+  evaluateFrom( double *, double *, const Kinematics & ) const {}
+};
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+template< class... Actions >
+ActionSet< Actions... >::
+ActionSet( const Actions&... actions )
+    : m_actions( actions... ),
+      m_agentIndices()
+{
+}
+
+template< class... Actions >
+ActionSet< Actions... >::
+~ActionSet()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Action number I of the set
+template< class... Actions >
+template< std::size_t I >
+const typename std::tuple_element<
+  I, typename ActionSet< Actions... >::tuple_type >::type&
+ActionSet< Actions... >::
+get() const
+{
+  return std::get< I >( m_actions );
+}
+
+// Resolve the agents owned by each action against the active agents
+template< class... Actions >
+void
+ActionSet< Actions... >::
+activateAgents( const std::vector< std::string > &activeAgents )
+{
+  activateFrom< 0 >( activeAgents );
+}
+
+// The body rotation rate shared by the actions
+template< class... Actions >
+double
+ActionSet< Actions... >::
+getRotationRate() const
+{
+  std::vector< double > rates;
+  ratesFrom< 0 >( rates );
+  return Action::bodyRotationRate( rates );
+}
+
+// Sum the accelerations of all actions
+template< class... Actions >
+void
+ActionSet< Actions... >::
+getAcceleration(
+    double *acceleration,
+    const Kinematics &kinematics ) const
+{
+  accelerationFrom< 0 >( acceleration, kinematics );
+}
+
+// Sum the accelerations and acceleration partials of all actions
+template< class... Actions >
+void
+ActionSet< Actions... >::
+evaluate(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics ) const
+{
+  evaluateFrom< 0 >( acceleration, partials, kinematics );
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+template< class... Actions >
+template< std::size_t I >
+typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+ActionSet< Actions... >::
+activateFrom( const std::vector< std::string > &activeAgents )
+{
+  m_agentIndices[I] = std::get< I >( m_actions ).indexAgents( activeAgents );
+  activateFrom< I + 1 >( activeAgents );
+}
+
+template< class... Actions >
+template< std::size_t I >
+typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+ActionSet< Actions... >::
+ratesFrom( std::vector< double > &rates ) const
+{
+  rates.push_back( std::get< I >( m_actions ).getRotationRate() );
+  ratesFrom< I + 1 >( rates );
+}
+
+// The qualified calls below bypass the virtual table
+template< class... Actions >
+template< std::size_t I >
+typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+ActionSet< Actions... >::
+accelerationFrom(
+    double *acceleration,
+    const Kinematics &kinematics ) const
+{
+  typedef typename std::tuple_element< I, tuple_type >::type ActionType;
+  std::get< I >( m_actions ).ActionType::getAcceleration( acceleration,
+                                                          kinematics );
+  accelerationFrom< I + 1 >( acceleration, kinematics );
+}
+
+template< class... Actions >
+template< std::size_t I >
+typename std::enable_if< ( I < sizeof...( Actions ) ) >::type
+ActionSet< Actions... >::
+evaluateFrom(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics ) const
+{
+  typedef typename std::tuple_element< I, tuple_type >::type ActionType;
+  std::get< I >( m_actions ).ActionType::evaluate( acceleration, partials,
+                                                   kinematics,
+                                                   m_agentIndices[I] );
+  evaluateFrom< I + 1 >( acceleration, partials, kinematics );
+}
+
+#endif // EKF_ACTIONSET_HEADER_GUARD
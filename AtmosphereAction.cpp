@@ -27,8 +27,7 @@ AtmosphereAction()
       m_refDensity(),
       m_stepHeight(),
       m_rotation(),
-      m_bodyDragTerm(),
-      m_evaledPartials()
+      m_bodyDragTerm()
 {
 }
 
@@ -46,8 +45,7 @@ AtmosphereAction(
       m_refDensity( refDensity ),
       m_stepHeight( stepHeight ),
       m_rotation( rotation ),
-      m_bodyDragTerm( bodyDragTerm ),
-      m_evaledPartials()
+      m_bodyDragTerm( bodyDragTerm )
 {
 }
 
@@ -66,178 +64,236 @@ AtmosphereAction::
 void
 AtmosphereAction::
 getAcceleration(
-    std::vector< double >& acceleration,
-    const std::vector< double >& state ) const
+    double *acceleration,
+    const Kinematics &kinematics ) const
 {
-  double dragPrefix =  - m_bodyDragTerm * adjustedDensity( state )
-                       * adjustedVelocity( state );
-
-  acceleration[0] += dragPrefix * ( state[3] + state[1] * m_rotation );
-  acceleration[1] += dragPrefix * ( state[4] - state[0] * m_rotation );
-  acceleration[2] += dragPrefix * ( state[5] );
-}
-
-// Computes the partial derivative of the acceleration terms and owned
-// parameters
-void
-AtmosphereAction::
-getPartials(
-    std::vector< double > &partials,
-    const std::vector< double > &state,
-    const std::vector< std::string >  &activeAgents )
-{
-  // Evaluate the class partial for this state
-  evalPartials( state );
-
-  // Loop over active agents and get partial values
-  int numAgents = activeAgents.size();
-  for ( int i = 0; i < numAgents; ++i )
+  // The atmosphere moves with the body, so drag acts on the
+  // body-relative velocity
+  double a[3];
+  drag( kinematics.bodyVelocity, kinematics.bodySpeed, kinematics.r,
+        m_refHeight, m_refDensity, m_stepHeight, m_bodyDragTerm, a );
+  for ( int i = 0; i < 3; ++i )
   {
-    // Request the partial from the i loop with respect to all the
-    // active agents in j loop
-    for ( int j = 0; j < numAgents; ++j )
-    {
-      if (m_debug)
-      {
-        std::cout << "\nAtmosphereAction::getPartials()" << std::endl
-                  << "Requested Partials: " << activeAgents[i] <<  " wrt "
-                  << activeAgents[j] << std::endl
-                  << "Value of partials: "
-                  << getAgentPartial( activeAgents[i], activeAgents[j] );
-      }
-      partials[ i * numAgents + j ] += getAgentPartial( activeAgents[i],
-                                                        activeAgents[j] );
-    }
+    acceleration[i] += a[i];
   }
 }
 
-//=====================================================================
-//=====================================================================
-// PRIVATE MEMBERS
-
-// Get the atmospheric density at current state
-double
-AtmosphereAction::
-adjustedDensity( const std::vector< double > state ) const
-{
-  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                pow( state[2], 2 ) );
-
-  return m_refDensity * exp( - ( dist - m_refHeight ) / m_stepHeight );
-}
-
-// Get the atmospheric relative velocity at current state
-double
-AtmosphereAction::
-adjustedVelocity( const std::vector< double > state ) const
-{
-  return sqrt( pow( state[3] + state[1] * m_rotation, 2 ) +
-               pow( state[4] - state[0] * m_rotation, 2 ) +
-               pow( state[5], 2 ) );
-}
-
-double
+// Computes the accelerations as in getAcceleration() for every lane
+void
 AtmosphereAction::
-getAgentPartial(
-    const std::string &top,
-    const std::string &bottom )
+getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const
 {
-  // Form param search string
-  std::string partialRequest = top + " wrt " + bottom;
-
-  if( m_evaledPartials.find( partialRequest ) == m_evaledPartials.end() )
+  typedef BatchKinematics::Lanes Lanes;
+  Lanes a[3];
+  drag( kinematics.bodyVelocity, kinematics.bodySpeed, kinematics.r,
+        Lanes( Lanes::Constant( m_refHeight ) ),
+        Lanes( Lanes::Constant( m_refDensity ) ),
+        Lanes( Lanes::Constant( m_stepHeight ) ),
+        Lanes( Lanes::Constant( m_bodyDragTerm ) ), a );
+  for ( int i = 0; i < 3; ++i )
   {
-    // If requested partial is not supported by this action, return 0
-    return 0.0;
+    acceleration[i] += a[i];
   }
-  return m_evaledPartials[ partialRequest ];
 }
 
+// Computes the acceleration as in getAcceleration() and the partial
+// derivative of the acceleration terms and owned parameters, sharing
+// the density between both.
 void
 AtmosphereAction::
-evalPartials( const std::vector< double > &state )
+evaluate(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
 {
   // Condense variable names to make following equations more legible
-  double r = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-             pow( state[2], 2 ) );
-  double X = state[0];
-  double Y = state[1];
-  double Z = state[2];
-  double dX = state[3];
-  double dY = state[4];
-  double dZ = state[5];
+  double X = kinematics.position[0];
+  double Y = kinematics.position[1];
+  double Z = kinematics.position[2];
   double step = m_stepHeight;
   double rot =  m_rotation;
-  double rho = adjustedDensity( state );
-  double vel = adjustedVelocity( state );
   double Cd = m_bodyDragTerm;
+  double height = ( kinematics.r - m_refHeight ) / step;
+  double decay = exp( -height );
+  double rho = m_refDensity * decay;
+
+  // Velocity relative to the rotating atmosphere
+  double vX = kinematics.bodyVelocity[0];
+  double vY = kinematics.bodyVelocity[1];
+  double vZ = kinematics.bodyVelocity[2];
+  double vel = kinematics.bodySpeed;
 
   if (m_debug)
   {
-    std::cout << "In AtmosphereAction::evalPartials " << std::endl
+    std::cout << "In AtmosphereAction::evaluate " << std::endl
               << "Val of vel: " << vel << std::endl
               << "Val of rho: " << rho << std::endl
               << "Val of cd: " << Cd << std::endl;
   }
 
-  m_evaledPartials[ "X wrt dX" ] = 1;
-  m_evaledPartials[ "Y wrt dY" ] = 1;
-  m_evaledPartials[ "Z wrt dZ" ] = 1;
+  // Acceleration
+  double CdRhoVel = Cd * rho * vel;
+  acceleration[0] += -CdRhoVel * vX;
+  acceleration[1] += -CdRhoVel * vY;
+  acceleration[2] += -CdRhoVel * vZ;
+
+  // Factors shared by the partials: the density gradient term, the
+  // relative speed gradient term, and vel * d(vel)/dX, vel * d(vel)/dY.
+  double densityTerm = CdRhoVel * kinematics.invR / step;
+  double speedTerm = Cd * rho / vel;
+  double velX = -rot * vY;
+  double velY = rot * vX;
 
   // Partials of acceleration X component wrt state.
-  m_evaledPartials[ "dX wrt X" ] = (
-    Cd * rho * vel * X * ( dX + rot * Y ) / ( r * step ) +
-   -Cd * rho * ( -rot * dY + pow( rot, 2 ) * X ) * ( dX + rot * Y ) / vel );
-  m_evaledPartials[ "dX wrt Y" ] = (
-    Cd * rho * vel * Y * ( dX + rot * Y ) / ( r * step ) +
-   -Cd * rho * ( rot * dX + pow( rot, 2 ) * Y ) * ( dX + rot * Y ) / vel +
-   -Cd * rho * vel * rot );
-  m_evaledPartials[ "dX wrt Z" ] =
-    Cd * rho * vel * Z * ( dX + rot * Y ) / ( r * step );
-  m_evaledPartials[ "dX wrt dX" ] =
-   -Cd * rho * pow( dX + rot * Y, 2 ) / vel - Cd * rho * vel ;
-  m_evaledPartials[ "dX wrt dY" ] =
-   -Cd * rho * ( dY - rot * X ) * ( dX + rot * Y ) / vel;
-  m_evaledPartials[ "dX wrt dZ" ] =
-   -Cd * rho * dZ * ( dX + rot * Y ) / vel;
+  addPartial( partials, index, kAccX, kX,
+    densityTerm * X * vX - speedTerm * velX * vX );
+  addPartial( partials, index, kAccX, kY,
+    densityTerm * Y * vX - speedTerm * velY * vX - CdRhoVel * rot );
+  addPartial( partials, index, kAccX, kZ, densityTerm * Z * vX );
+  addPartial( partials, index, kAccX, kDX, -speedTerm * vX * vX - CdRhoVel );
+  addPartial( partials, index, kAccX, kDY, -speedTerm * vY * vX );
+  addPartial( partials, index, kAccX, kDZ, -speedTerm * vZ * vX );
 
   // Partials of acceleration Y component wrt state.
-  m_evaledPartials[ "dY wrt X" ] = (
-    Cd * rho * vel * X * ( dY - rot * X ) / ( r * step ) +
-   -Cd * rho * ( pow( rot, 2 ) * X - rot * dY ) * ( dY - rot * X ) / vel +
-    Cd * rho * vel * rot );
-  m_evaledPartials[ "dY wrt Y" ] = (
-    Cd * rho * vel * Y * ( dY - rot * X ) / ( r * step) +
-   -Cd * rho * ( rot * dX + pow( rot, 2 ) * Y ) * ( dY - rot * X ) / vel );
-  m_evaledPartials[ "dY wrt Z" ] =
-    Cd * rho * vel * Z * ( dY - rot * X ) / ( r * step );
-  m_evaledPartials[ "dY wrt dX" ] =
-   -Cd * rho * ( dY - rot * X ) * ( dX + rot * Y ) / vel;
-  m_evaledPartials[ "dY wrt dY" ] =
-   -Cd * rho * pow( dY - rot * X, 2 ) / vel - Cd * rho * vel;
-  m_evaledPartials[ "dY wrt dZ" ] =
-   -Cd * rho * dZ * ( dY - rot * X ) / vel;
+  addPartial( partials, index, kAccY, kX,
+    densityTerm * X * vY - speedTerm * velX * vY + CdRhoVel * rot );
+  addPartial( partials, index, kAccY, kY,
+    densityTerm * Y * vY - speedTerm * velY * vY );
+  addPartial( partials, index, kAccY, kZ, densityTerm * Z * vY );
+  addPartial( partials, index, kAccY, kDX, -speedTerm * vX * vY );
+  addPartial( partials, index, kAccY, kDY, -speedTerm * vY * vY - CdRhoVel );
+  addPartial( partials, index, kAccY, kDZ, -speedTerm * vZ * vY );
 
   // Partials of acceleration Z component wrt state.
-  m_evaledPartials[ "dZ wrt X" ] = (
-    Cd * rho * vel * dZ * X / (r * step) +
-   -Cd * rho * dZ * ( pow( rot, 2 ) * X - rot * dY ) / vel );
-  m_evaledPartials[ "dZ wrt Y" ] = (
-    Cd * rho * vel * dZ * Y / ( r * step ) +
-   -Cd * rho * dZ * ( rot * dX + pow( rot, 2 ) * Y) / vel );
-  m_evaledPartials[ "dZ wrt Z" ] =
-    Cd * rho * vel * Z * dZ / ( r * step );
-  m_evaledPartials[ "dZ wrt dX" ] =
-   -Cd * rho * dZ * ( dX + rot * Y ) / vel;
-  m_evaledPartials[ "dZ wrt dY" ] =
-   -Cd * rho * dZ * ( dY - rot * X ) / vel;
-  m_evaledPartials[ "dZ wrt dZ" ] = (
-   -Cd * rho * pow( dZ, 2 ) / vel ) + ( -Cd * rho * vel );
-
-/// @todo implement remaining partials:
-///   - Exponential atmosphere referece height
-///   - Exponential atmosphere reference density
-///   - Exponential atmosphere step height
-///   - Planetary rotation
-///   - Agent body drag term
+  addPartial( partials, index, kAccZ, kX,
+    densityTerm * X * vZ - speedTerm * velX * vZ );
+  addPartial( partials, index, kAccZ, kY,
+    densityTerm * Y * vZ - speedTerm * velY * vZ );
+  addPartial( partials, index, kAccZ, kZ, densityTerm * Z * vZ );
+  addPartial( partials, index, kAccZ, kDX, -speedTerm * vX * vZ );
+  addPartial( partials, index, kAccZ, kDY, -speedTerm * vY * vZ );
+  addPartial( partials, index, kAccZ, kDZ, -speedTerm * vZ * vZ - CdRhoVel );
+
+  // Partials wrt the atmosphere parameters, through the density. The
+  // acceleration is linear in the reference density and in Cd.
+  double v[3] = { vX, vY, vZ };
+  double refHeightTerm = CdRhoVel / step;
+  double stepTerm = CdRhoVel * height / step;
+  double refDensityTerm = Cd * decay * vel;
+  double CdTerm = rho * vel;
+  for ( int i = 0; i < 3; ++i )
+  {
+    addPartial( partials, index, i, kRefHeight, -refHeightTerm * v[i] );
+    addPartial( partials, index, i, kRefDensity, -refDensityTerm * v[i] );
+    addPartial( partials, index, i, kStepHeight, -stepTerm * v[i] );
+    addPartial( partials, index, i, kCd, -CdTerm * v[i] );
+  }
+
+  // Partials wrt the rotation rate, through the relative velocity,
+  // whose derivative is ( Y, -X, 0 )
+  double velRot = vX * Y - vY * X;
+  addPartial( partials, index, kAccX, kRotation,
+    -speedTerm * velRot * vX - CdRhoVel * Y );
+  addPartial( partials, index, kAccY, kRotation,
+    -speedTerm * velRot * vY + CdRhoVel * X );
+  addPartial( partials, index, kAccZ, kRotation, -speedTerm * velRot * vZ );
+}
+
+// Computes the acceleration as in getAcceleration() and its partials
+// by differentiating drag() with Duals. The body-relative velocity is
+// derived here with this atmosphere's rotation rate, which is the
+// Kinematics rate ( see Action::bodyRotationRate ), in the same order
+// as Kinematics::update so the values match getAcceleration exactly.
+void
+AtmosphereAction::
+evaluateAutomatic(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  Scalar position[3];
+  Scalar velocity[3];
+  for ( int i = 0; i < 3; ++i )
+  {
+    position[i] = Scalar::variable( kinematics.position[i], i );
+    velocity[i] = Scalar::variable( kinematics.velocity[i], 3 + i );
+  }
+  Scalar rotation = Scalar::variable( m_rotation, 9 );
+
+  Scalar r = sqrt( position[0] * position[0] + position[1] * position[1] +
+                   position[2] * position[2] );
+  Scalar bodyVelocity[3] = { velocity[0] + rotation * position[1],
+                             velocity[1] - rotation * position[0],
+                             velocity[2] };
+  Scalar bodySpeed = sqrt( bodyVelocity[0] * bodyVelocity[0] +
+                           bodyVelocity[1] * bodyVelocity[1] +
+                           bodyVelocity[2] * bodyVelocity[2] );
+
+  Scalar a[3];
+  drag( bodyVelocity, bodySpeed, r, Scalar::variable( m_refHeight, 6 ),
+        Scalar::variable( m_refDensity, 7 ),
+        Scalar::variable( m_stepHeight, 8 ),
+        Scalar::variable( m_bodyDragTerm, 10 ), a );
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += a[i].value;
+    for ( int j = 0; j < kNumVariables; ++j )
+    {
+      addPartial( partials, index, i, kVariables[j], a[i].d( j ) );
+    }
+  }
+}
+
+// Names of the agents this action owns partials for
+const std::vector< std::string >&
+AtmosphereAction::
+getAgentsOwned() const
+{
+  return m_agentsOwned;
+}
+
+// Rotation rate of the planet carrying the atmosphere
+double
+AtmosphereAction::
+getRotationRate() const
+{
+  return m_rotation;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+const AtmosphereAction::OwnedAgent
+AtmosphereAction::kVariables[ AtmosphereAction::kNumVariables ] = {
+  kX, kY, kZ, kDX, kDY, kDZ, kRefHeight, kRefDensity, kStepHeight,
+  kRotation, kCd };
+
+// Drag on the body-relative velocity in an exponential atmosphere
+template< typename T >
+void
+AtmosphereAction::
+drag(
+    const T *bodyVelocity,
+    const T &bodySpeed,
+    const T &r,
+    const T &refHeight,
+    const T &refDensity,
+    const T &stepHeight,
+    const T &bodyDragTerm,
+    T *acceleration )
+{
+  using std::exp;
+  T density = refDensity * exp( -( r - refHeight ) / stepHeight );
+  T dragPrefix = -bodyDragTerm * density * bodySpeed;
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] = dragPrefix * bodyVelocity[i];
+  }
 }
@@ -15,10 +15,10 @@
 // C++ Standard Library
 #include <string>
 #include <vector>
-#include <map>
 
 // ekf Library
 #include <Action.hpp>
+#include <Dual.hpp>
 
 /// @brief Compute state accelerations and partial derivates due to
 /// the interaction of an agent and planetary atmosphere.
@@ -36,6 +36,13 @@
 ///   - Planetary rotation
 ///   - Agent body drag term
 ///
+/// The acceleration is written once, in drag(), as a template over the
+/// scalar type. getAcceleration calls it with doubles,
+/// getBatchAcceleration with SIMD lanes, and evaluateAutomatic with
+/// Duals seeded on the state and the five parameters, which yields the
+/// partials. evaluate has the same partials written out by hand, at a
+/// fraction of the cost.
+///
 class AtmosphereAction : public Action
 {
  public:
@@ -46,23 +53,53 @@ class AtmosphereAction : public Action
  ~AtmosphereAction() override;
 
   // Computes the acceleration due to this action and adds it to
-  // the passed in vector "acceleration".
-  void getAcceleration( std::vector< double > &acceleration,
-                        const std::vector< double > &state ) const override;
-
-  // Computes the partial derivative of the acceleration terms and
-  // owned parameters
-  void getPartials( std::vector< double > &partials,
-                    const std::vector< double > &state,
-                    const std::vector< std::string >  &activeAgents ) override;
+  // the passed in array "acceleration".
+  void getAcceleration( double *acceleration,
+                        const Kinematics &kinematics ) const override;
+
+  // Computes the accelerations of a group of agents, one per lane
+  void getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const override;
+
+  // Computes the acceleration and the partial derivative of the
+  // acceleration terms wrt the owned agents
+  void evaluate( double *acceleration,
+                 double *partials,
+                 const Kinematics &kinematics,
+                 const AgentIndex &index ) const override;
+
+  // Computes the same as evaluate, differentiating the acceleration
+  // with Duals
+  void evaluateAutomatic( double *acceleration,
+                          double *partials,
+                          const Kinematics &kinematics,
+                          const AgentIndex &index ) const override;
+
+  // Names of the agents this action owns partials for
+  const std::vector< std::string >& getAgentsOwned() const override;
+
+  // Rotation rate of the planet carrying the atmosphere
+  double getRotationRate() const override;
+
  private:
+  // Position of each agent in m_agentsOwned
+  enum OwnedAgent { kX, kY, kZ, kDX, kDY, kDZ, kRefHeight, kRefDensity,
+                    kStepHeight, kRotation, kCd };
+
+  // Owned agent of each Dual variable of evaluateAutomatic(), the
+  // ones the acceleration depends on. The last variable pads the
+  // derivatives to an even count.
+  typedef Dual< 12 > Scalar;
+  static const int kNumVariables = 11;
+  static const OwnedAgent kVariables[ kNumVariables ];
+
   std::string m_name;
   double m_refHeight;
   double m_refDensity;
   double m_stepHeight;
   double m_rotation;
   double m_bodyDragTerm;
-  std::map< std::string, double > m_evaledPartials;
 
   /// @todo need some way of identifying h_ref, rho_ref, step, rot, Cd
   /// for a particular planetary atmosphere.
@@ -70,11 +107,14 @@ class AtmosphereAction : public Action
                                              "h_ref", "rho_ref", "step", "rot",
                                              "Cd" };
 
-  double adjustedDensity( const std::vector< double > state ) const;
-  double adjustedVelocity( const std::vector< double > state ) const;
-
-  double getAgentPartial( const std::string &top, const std::string &bottom );
-  void evalPartials( const std::vector< double > &state );
+  // Drag acceleration for the velocity relative to the atmosphere
+  // "bodyVelocity", its magnitude, distance "r" from the body center
+  // and the atmosphere and body parameters, for any scalar type T
+  template< typename T >
+  static void drag( const T *bodyVelocity, const T &bodySpeed, const T &r,
+                    const T &refHeight, const T &refDensity,
+                    const T &stepHeight, const T &bodyDragTerm,
+                    T *acceleration );
 };
 
 #endif // EKF_ATMOSPHEREACTION_HEADER_GUARD
@@ -0,0 +1,117 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchKinematics.hpp
+/// @brief   Geometry of a group of agents at one integration stage, one
+///          SIMD lane per agent.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_BATCHKINEMATICS_HEADER_GUARD
+#define EKF_BATCHKINEMATICS_HEADER_GUARD
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Kinematics.hpp>
+
+/// @brief Geometry of kLanes agents at one integration stage.
+///
+/// The structure-of-arrays counterpart of Kinematics, used by
+/// BatchMotion. Every quantity is an Eigen array with one lane per
+/// agent, so Actions can compute the accelerations of the whole group
+/// with Eigen's vectorized array expressions. kLanes = 8 fills one
+/// AVX-512 register, two AVX2 or four SSE2 registers of doubles;
+/// which one is used depends on the target the code is built for.
+///
+/// The state of a group is stored component-major: component c of lane
+/// l is at state[ c * kLanes + l ].
+///
+struct BatchKinematics
+{
+  static const int kLanes = 8;
+
+  // Unaligned, so the struct can live anywhere on the heap
+  typedef Eigen::Array< double, kLanes, 1, Eigen::DontAlign > Lanes;
+
+  // Integration time
+  double time;
+
+  // Inertial position X, Y, Z and velocity dX, dY, dZ
+  Lanes position[3];
+  Lanes velocity[3];
+
+  // Distance from the body center, its square, and inverse powers
+  Lanes r;
+  Lanes r2;
+  Lanes invR;
+  Lanes invR2;
+  Lanes invR3;
+  Lanes invR5;
+
+  // Body rotation rate about Z, and the velocity relative to the
+  // rotating body with its magnitude
+  double rotation;
+  Lanes bodyVelocity[3];
+  Lanes bodySpeed;
+
+  BatchKinematics( double rotationRate = 0.0 )
+      : time( 0.0 ),
+        r( Lanes::Zero() ),
+        r2( Lanes::Zero() ),
+        invR( Lanes::Zero() ),
+        invR2( Lanes::Zero() ),
+        invR3( Lanes::Zero() ),
+        invR5( Lanes::Zero() ),
+        rotation( rotationRate ),
+        bodySpeed( Lanes::Zero() )
+  {
+    for ( int i = 0; i < 3; ++i )
+    {
+      position[i].setZero();
+      velocity[i].setZero();
+      bodyVelocity[i].setZero();
+    }
+  }
+
+  // Derive the geometry from the X, Y, Z, dX, dY, dZ components of the
+  // component-major "state" at time "t".
+  void update( const double *state, double t )
+  {
+    time = t;
+    for ( int i = 0; i < 3; ++i )
+    {
+      position[i] = Eigen::Map< const Lanes >( state + i * kLanes );
+      velocity[i] = Eigen::Map< const Lanes >( state + ( 3 + i ) * kLanes );
+    }
+
+    r2 = position[0].square() + position[1].square() + position[2].square();
+    r = r2.sqrt();
+    invR = r.inverse();
+    invR2 = invR.square();
+    invR3 = invR2 * invR;
+    invR5 = invR3 * invR2;
+
+    bodyVelocity[0] = velocity[0] + rotation * position[1];
+    bodyVelocity[1] = velocity[1] - rotation * position[0];
+    bodyVelocity[2] = velocity[2];
+    bodySpeed = ( bodyVelocity[0].square() + bodyVelocity[1].square() +
+                  bodyVelocity[2].square() ).sqrt();
+  }
+
+  // The scalar Kinematics of lane "l"
+  Kinematics lane( int l ) const
+  {
+    Kinematics k( rotation );
+    double state[6] = { position[0]( l ), position[1]( l ),
+                        position[2]( l ), velocity[0]( l ),
+                        velocity[1]( l ), velocity[2]( l ) };
+    k.update( state, time );
+    return k;
+  }
+};
+
+#endif // EKF_BATCHKINEMATICS_HEADER_GUARD
@@ -0,0 +1,262 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchLeastSquares.cpp
+/// @brief   Estimate the state and parameters at epoch from an arc of
+///          observations with the normal equations.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// ekf Library
+#include <BatchLeastSquares.hpp>
+
+namespace
+{
+
+typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                       Eigen::RowMajor > RowMatrix;
+
+// Observations per task, and rows per rank-k update within a task
+const std::size_t kChunkSize = 4096;
+const int kBlockRows = 64;
+
+// Partial sums of one chunk of observations
+struct ChunkSums
+{
+  Eigen::MatrixXd information;
+  Eigen::VectorXd normal;
+  std::size_t numObservations;
+  double residualSquares;
+};
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Constructor for "numAgents" estimated agents
+BatchLeastSquares::
+BatchLeastSquares( int numAgents )
+    : m_size( numAgents ),
+      m_information( Eigen::MatrixXd::Zero( numAgents, numAgents ) ),
+      m_normal( Eigen::VectorXd::Zero( numAgents ) ),
+      m_aprioriInformation( Eigen::MatrixXd::Zero( numAgents, numAgents ) ),
+      m_aprioriNormal( Eigen::VectorXd::Zero( numAgents ) ),
+      m_numObservations( 0 ),
+      m_residualSquares( 0.0 )
+{
+}
+
+// Default Destructor
+BatchLeastSquares::
+~BatchLeastSquares()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Set the a priori covariance and deviation
+void
+BatchLeastSquares::
+setApriori(
+    const std::vector< double > &covariance,
+    const std::vector< double > &deviation )
+{
+  const int n = m_size;
+  if ( ( covariance.size() != std::size_t( n * n ) ) ||
+       ( deviation.size() != std::size_t( n ) ) )
+  {
+    throw std::invalid_argument(
+      "BatchLeastSquares::setApriori: need an n x n covariance and n "
+      "deviations" );
+  }
+
+  Eigen::LLT< Eigen::MatrixXd > cholesky(
+    Eigen::Map< const RowMatrix >( covariance.data(), n, n ) );
+  if ( cholesky.info() != Eigen::Success )
+  {
+    throw std::invalid_argument(
+      "BatchLeastSquares::setApriori: covariance is not positive definite" );
+  }
+  m_aprioriInformation = cholesky.solve( Eigen::MatrixXd::Identity( n, n ) );
+  m_aprioriNormal = m_aprioriInformation *
+    Eigen::Map< const Eigen::VectorXd >( deviation.data(), n );
+}
+
+// Drop the accumulated observations
+void
+BatchLeastSquares::
+reset()
+{
+  m_information.setZero();
+  m_normal.setZero();
+  m_numObservations = 0;
+  m_residualSquares = 0.0;
+}
+
+// Accumulate the normal equations of the observations at "times", one
+// chunk per task
+void
+BatchLeastSquares::
+accumulate(
+    const Motion &motion,
+    const std::vector< double > &times,
+    const Measurement &measurement,
+    ThreadPool &pool )
+{
+  const int n = m_size;
+  if ( motion.getActiveAgents().size() != std::size_t( n ) )
+  {
+    throw std::invalid_argument(
+      "BatchLeastSquares::accumulate: Motion has the wrong number of agents" );
+  }
+
+  std::size_t numChunks = ( times.size() + kChunkSize - 1 ) / kChunkSize;
+  std::vector< ChunkSums > sums( numChunks );
+
+  pool.run( numChunks, [ & ]( std::size_t c )
+  {
+    ChunkSums &chunk = sums[c];
+    chunk.information = Eigen::MatrixXd::Zero( n, n );
+    chunk.normal = Eigen::VectorXd::Zero( n );
+    chunk.numObservations = 0;
+    chunk.residualSquares = 0.0;
+
+    // Workspaces, reused for every observation of the chunk
+    std::vector< double > stateAndPartials( 6 + n * n );
+    Eigen::Map< const RowMatrix > stm( stateAndPartials.data() + 6, n, n );
+    Eigen::RowVectorXd partials( n );
+    RowMatrix rows( kBlockRows, n );
+    Eigen::VectorXd residuals( kBlockRows );
+    int numRows = 0;
+
+    // Add the weighted rows gathered so far, H^T H with one rank-k
+    // update
+    auto flush = [ & ]()
+    {
+      chunk.information.selfadjointView< Eigen::Upper >().rankUpdate(
+        rows.topRows( numRows ).transpose() );
+      chunk.normal.noalias() +=
+        rows.topRows( numRows ).transpose() * residuals.head( numRows );
+      numRows = 0;
+    };
+
+    // Observations sharing a time, e.g. range and range-rate of one
+    // pass sample, share one interpolation of the reference
+    std::size_t end = std::min( times.size(), ( c + 1 ) * kChunkSize );
+    for ( std::size_t k = c * kChunkSize; k < end; ++k )
+    {
+      if ( ( k == c * kChunkSize ) || ( times[k] != times[ k - 1 ] ) )
+      {
+        motion.getStateAndPartials( times[k], stateAndPartials.data() );
+      }
+      double residual = 0.0;
+      double weight = 0.0;
+      if ( !measurement( k, times[k], stateAndPartials.data(),
+                         partials.data(), residual, weight ) ||
+           !( weight > 0.0 ) )
+      {
+        continue;
+      }
+
+      // Map the partials back to epoch, and scale the row and the
+      // residual by sqrt( weight ) so the rank-k update weighs them
+      double root = std::sqrt( weight );
+      rows.row( numRows ).noalias() = root * ( partials * stm );
+      residuals( numRows ) = root * residual;
+      ++numRows;
+      ++chunk.numObservations;
+      chunk.residualSquares += weight * residual * residual;
+      if ( numRows == kBlockRows )
+      {
+        flush();
+      }
+    }
+    if ( numRows > 0 )
+    {
+      flush();
+    }
+  } );
+
+  for ( const ChunkSums &chunk: sums )
+  {
+    m_information.triangularView< Eigen::Upper >() += chunk.information;
+    m_normal += chunk.normal;
+    m_numObservations += chunk.numObservations;
+    m_residualSquares += chunk.residualSquares;
+  }
+}
+
+// Number of observations accumulated
+std::size_t
+BatchLeastSquares::
+getNumObservations() const
+{
+  return m_numObservations;
+}
+
+// Sum of the weighted squared residuals
+double
+BatchLeastSquares::
+getResidualSquares() const
+{
+  return m_residualSquares;
+}
+
+// Solve the normal equations with a Cholesky factorization
+std::vector< double >
+BatchLeastSquares::
+solve() const
+{
+  Eigen::LLT< Eigen::MatrixXd > cholesky( fullInformation() );
+  if ( cholesky.info() != Eigen::Success )
+  {
+    throw std::runtime_error(
+      "BatchLeastSquares::solve: information matrix is not positive "
+      "definite" );
+  }
+  Eigen::VectorXd correction = cholesky.solve( m_normal + m_aprioriNormal );
+  return std::vector< double >( correction.data(),
+                                correction.data() + m_size );
+}
+
+// Invert the information matrix
+std::vector< double >
+BatchLeastSquares::
+getCovariance() const
+{
+  Eigen::LLT< Eigen::MatrixXd > cholesky( fullInformation() );
+  if ( cholesky.info() != Eigen::Success )
+  {
+    throw std::runtime_error(
+      "BatchLeastSquares::getCovariance: information matrix is not "
+      "positive definite" );
+  }
+  RowMatrix covariance =
+    cholesky.solve( Eigen::MatrixXd::Identity( m_size, m_size ) );
+  return std::vector< double >( covariance.data(),
+                                covariance.data() + m_size * m_size );
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// The symmetric information matrix, with the a priori
+Eigen::MatrixXd
+BatchLeastSquares::
+fullInformation() const
+{
+  Eigen::MatrixXd information =
+    m_information.selfadjointView< Eigen::Upper >();
+  return information + m_aprioriInformation;
+}
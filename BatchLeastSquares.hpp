@@ -0,0 +1,102 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchLeastSquares.hpp
+/// @brief   Estimate the state and parameters at epoch from an arc of
+///          observations with the normal equations.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_BATCHLEASTSQUARES_HEADER_GUARD
+#define EKF_BATCHLEASTSQUARES_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Motion.hpp>
+#include <ThreadPool.hpp>
+
+/// @brief Estimate the state and parameters at epoch from an arc of
+/// observations with the normal equations.
+///
+/// The batch counterpart of Knowledge. A Motion propagated over the arc
+/// from epoch, with its STM logged, is the reference trajectory. Each
+/// observation's partials at its own time are mapped back to epoch
+/// through the logged STM, H = H~( t ) Phi( t, t0 ), and accumulated
+/// into the information matrix H^T W H and the vector H^T W y. solve()
+/// then gives the correction to the reference at epoch with a Cholesky
+/// factorization.
+///
+/// accumulate() splits the observations into fixed-size chunks run on
+/// a ThreadPool. Each chunk sums into its own partial information
+/// matrix, with a rank-k update per block of rows, and the partial sums
+/// are added up in chunk order afterwards. The result therefore does
+/// not depend on the number of threads.
+///
+/// The estimate has one element per active agent of the Motion, as in
+/// Knowledge: the six state components, then corrections to the
+/// parameters relative to the values the Actions were built with.
+///
+class BatchLeastSquares
+{
+ public:
+  // Observation k at time t: given the reference state at t, write its
+  // observed minus computed "residual", its "weight" ( 1 / sigma^2 ) and
+  // its "partials" with respect to the active agents at time t. Return
+  // false to leave the observation out. Called from several threads at
+  // once.
+  typedef std::function< bool( std::size_t k, double t, const double *state,
+                               double *partials, double &residual,
+                               double &weight ) > Measurement;
+
+  explicit BatchLeastSquares( int numAgents );
+ ~BatchLeastSquares();
+
+  // A priori row-major covariance of the estimate, and a priori
+  // deviation from the reference at epoch. Without one, every agent
+  // has to be observable from the observations alone.
+  void setApriori( const std::vector< double > &covariance,
+                   const std::vector< double > &deviation );
+
+  // Drop the accumulated observations, keeping the a priori
+  void reset();
+
+  // Add observations k = 0 .. times.size() - 1 at "times", which must
+  // lie inside the span "motion" logged with its STM
+  void accumulate( const Motion &motion, const std::vector< double > &times,
+                   const Measurement &measurement, ThreadPool &pool );
+
+  // Number of observations accumulated, and the sum of their weighted
+  // squared residuals
+  std::size_t getNumObservations() const;
+  double getResidualSquares() const;
+
+  // Correction to the reference at epoch. Throws std::runtime_error if
+  // the information matrix is not positive definite.
+  std::vector< double > solve() const;
+  // Row-major covariance of the estimate, the inverse of the
+  // information matrix
+  std::vector< double > getCovariance() const;
+
+ private:
+  int m_size;
+  // Upper triangle of H^T W H, and H^T W y
+  Eigen::MatrixXd m_information;
+  Eigen::VectorXd m_normal;
+  Eigen::MatrixXd m_aprioriInformation;
+  Eigen::VectorXd m_aprioriNormal;
+  std::size_t m_numObservations;
+  double m_residualSquares;
+
+  Eigen::MatrixXd fullInformation() const;
+};
+
+#endif // EKF_BATCHLEASTSQUARES_HEADER_GUARD
@@ -0,0 +1,213 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchMotion.cpp
+/// @brief   Manage the motion of many agents through space together.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <functional>
+#include <stdexcept>
+
+// ekf Library
+#include <BatchMotion.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+BatchMotion::
+BatchMotion()
+    : m_time( 0 ),
+      m_step( 1. ),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_numAgents( 0 ),
+      m_groups(),
+      m_helper()
+{
+}
+
+// Constructor with initial step size
+BatchMotion::
+BatchMotion( double step )
+    : m_time( 0 ),
+      m_step( step ),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_numAgents( 0 ),
+      m_groups(),
+      m_helper()
+{
+}
+
+// Default Destructor
+BatchMotion::
+~BatchMotion()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an Action
+void
+BatchMotion::
+addAction( std::shared_ptr< Action > a )
+{
+  m_helper.addAction( a );
+
+  // The dynamics changed, so the derivatives at m_time are stale
+  for ( LaneGroup &group: m_groups )
+  {
+    group.ratesValid = false;
+  }
+}
+
+// Add an agent to the last group, or start a new group padded with
+// copies of it
+std::size_t
+BatchMotion::
+addAgent( const std::vector< double > &state )
+{
+  const int lanes = BatchKinematics::kLanes;
+  if ( state.size() < 6 )
+  {
+    throw std::invalid_argument(
+      "BatchMotion::addAgent: the state needs X, Y, Z, dX, dY, dZ" );
+  }
+
+  std::size_t lane = m_numAgents % lanes;
+  if ( lane == 0 )
+  {
+    LaneGroup group;
+    for ( int i = 0; i < 6; ++i )
+    {
+      for ( int l = 0; l < lanes; ++l )
+      {
+        group.state[ i * lanes + l ] = state[i];
+      }
+    }
+    group.dt = m_step;
+    m_groups.push_back( group );
+  }
+  else
+  {
+    for ( int i = 0; i < 6; ++i )
+    {
+      m_groups.back().state[ i * lanes + lane ] = state[i];
+    }
+  }
+  m_groups.back().ratesValid = false;
+
+  return m_numAgents++;
+}
+
+// Step all groups to time t. Each group runs the same adaptive loop as
+// Motion::stepTo, with its own step size.
+void
+BatchMotion::
+stepTo( double t )
+{
+  if ( t < m_time )
+  {
+    throw std::invalid_argument( "BatchMotion::stepTo: cannot step backwards" );
+  }
+
+  using namespace boost::numeric::odeint;
+
+  ControlledStepper stepper(
+    ControlledStepper::error_checker_type( m_absTol, m_relTol ) );
+
+  for ( LaneGroup &group: m_groups )
+  {
+    double time = m_time;
+    if ( !group.ratesValid )
+    {
+      m_helper( group.state, group.rates, time );
+      group.ratesValid = true;
+    }
+
+    while ( time < t )
+    {
+      bool clipped = ( t - time <= group.dt );
+      double trialStep = clipped ? t - time : group.dt;
+      if ( stepper.try_step( std::ref( m_helper ), group.state, group.rates,
+                             time, trialStep ) == success )
+      {
+        if ( clipped )
+        {
+          time = t;
+        }
+        else
+        {
+          group.dt = trialStep;
+        }
+      }
+      else
+      {
+        group.dt = trialStep;
+      }
+    }
+  }
+
+  m_time = t;
+}
+
+// Return the current time step.
+double
+BatchMotion::
+getTime() const
+{
+  return m_time;
+}
+
+// Number of agents
+std::size_t
+BatchMotion::
+size() const
+{
+  return m_numAgents;
+}
+
+// Return the current state of an agent
+std::vector< double >
+BatchMotion::
+getState( std::size_t agent ) const
+{
+  const int lanes = BatchKinematics::kLanes;
+  if ( agent >= m_numAgents )
+  {
+    throw std::out_of_range( "BatchMotion::getState: no such agent" );
+  }
+
+  const LaneGroup &group = m_groups[ agent / lanes ];
+  std::size_t lane = agent % lanes;
+  std::vector< double > state( 6 );
+  for ( int i = 0; i < 6; ++i )
+  {
+    state[i] = group.state[ i * lanes + lane ];
+  }
+  return state;
+}
+
+// Set the step size error tolerances
+void
+BatchMotion::
+setTolerances( double absTol, double relTol )
+{
+  m_absTol = absTol;
+  m_relTol = relTol;
+}
+
+// Number of right hand side evaluations so far
+unsigned long
+BatchMotion::
+getRhsCount() const
+{
+  return m_helper.getNumCalls();
+}
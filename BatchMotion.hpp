@@ -0,0 +1,97 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchMotion.hpp
+/// @brief   Manage the motion of many agents through space together.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_BATCHMOTION_HEADER_GUARD
+#define EKF_BATCHMOTION_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// ekf Library
+#include <Action.hpp>
+#include <BatchKinematics.hpp>
+#include <BatchOdeintHelper.hpp>
+
+/// @brief Manage the motion of many agents through space together, such
+/// as a catalog of objects under the same Actions.
+///
+/// The agents are packed in groups of BatchKinematics::kLanes, one SIMD
+/// lane each, and every group is integrated as one system by dopri5.
+/// The Actions compute the accelerations of a whole group at once. A
+/// group shares its step size, which is the one its most demanding lane
+/// needs, so each agent is integrated at least as accurately as a
+/// Motion with state-only error control and the same tolerances would.
+/// The last group is padded with copies of its first agent.
+///
+/// Only the states are propagated; there are no partials and no
+/// history. Agents can be added at the current time, between calls to
+/// stepTo.
+///
+class BatchMotion {
+
+ public:
+  BatchMotion();
+  BatchMotion( double step );
+ ~BatchMotion();
+
+  // Add effect of action to all agents
+  void addAction( std::shared_ptr< Action > a );
+  // Add an agent with state "state" at the current time, and return its
+  // number
+  std::size_t addAgent( const std::vector< double > &state );
+
+  // Step all agents to time t
+  void stepTo( double t );
+
+  // Get current time step
+  double getTime() const;
+  // Number of agents
+  std::size_t size() const;
+  // Get the current state of agent "agent"
+  std::vector< double > getState( std::size_t agent ) const;
+
+  // Step size error tolerances, 1.E-10 and 1.E-9 by default
+  void setTolerances( double absTol, double relTol );
+  // Number of right hand side evaluations so far, each covering a
+  // group of kLanes agents
+  unsigned long getRhsCount() const;
+
+ private:
+  typedef BatchOdeintHelper::state_type state_type;
+  typedef boost::numeric::odeint::controlled_runge_kutta<
+    boost::numeric::odeint::runge_kutta_dopri5< state_type > >
+    ControlledStepper;
+
+  // kLanes agents integrated together
+  struct LaneGroup
+  {
+    state_type state;
+    // Time derivative of state at m_time
+    state_type rates;
+    bool ratesValid;
+    // Step size adapted so far
+    double dt;
+  };
+
+  double m_time;
+  double m_step;
+  double m_absTol;
+  double m_relTol;
+  std::size_t m_numAgents;
+  std::vector< LaneGroup > m_groups;
+  BatchOdeintHelper m_helper;
+};
+
+#endif // EKF_BATCHMOTION_HEADER_GUARD
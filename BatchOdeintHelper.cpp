@@ -0,0 +1,85 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchOdeintHelper.cpp
+/// @brief   Interface class between ekf and boost::odeint for a group of
+///          agents propagated together.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// ekf Library
+#include <BatchOdeintHelper.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+BatchOdeintHelper::
+BatchOdeintHelper()
+    : m_actions(),
+      m_kinematics(),
+      m_numCalls( 0 )
+{
+}
+
+BatchOdeintHelper::
+~BatchOdeintHelper()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// This method defines the equations of motion of every lane for the
+// odeint integrator.
+void
+BatchOdeintHelper::
+operator() (
+    const state_type &x,
+    state_type &dxdt,
+    const double t )
+{
+  const int lanes = BatchKinematics::kLanes;
+  ++m_numCalls;
+
+  // Derive the geometry of all lanes once for all actions
+  m_kinematics.update( x.data(), t );
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    m_accel[i].setZero();
+  }
+  for ( const std::shared_ptr< Action > &ap: m_actions )
+  {
+    ap->getBatchAcceleration( m_accel, m_kinematics );
+  }
+
+  // Positions move with the velocities, velocities with the
+  // accelerations
+  for ( int i = 0; i < 3; ++i )
+  {
+    Eigen::Map< BatchKinematics::Lanes >( dxdt.data() + i * lanes ) =
+      m_kinematics.velocity[i];
+    Eigen::Map< BatchKinematics::Lanes >( dxdt.data() + ( 3 + i ) * lanes ) =
+      m_accel[i];
+  }
+}
+
+// Add an action, and take the body rotation rate from the actions
+void
+BatchOdeintHelper::
+addAction( std::shared_ptr< Action > a )
+{
+  m_actions.push_back( a );
+  m_kinematics = BatchKinematics( Action::bodyRotationRate( m_actions ) );
+}
+
+// Number of times operator() was called
+unsigned long
+BatchOdeintHelper::
+getNumCalls() const
+{
+  return m_numCalls;
+}
@@ -0,0 +1,61 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BatchOdeintHelper.hpp
+/// @brief   Interface class between ekf and boost::odeint for a group of
+///          agents propagated together.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_BATCHODEINTHELPER_HEADER_GUARD
+#define EKF_BATCHODEINTHELPER_HEADER_GUARD
+
+// C++ Standard Library
+#include <array>
+#include <memory>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <BatchKinematics.hpp>
+
+/// @brief Interface class between ekf and boost::odeint for a group of
+/// BatchKinematics::kLanes agents.
+///
+/// The state of the group is the component-major X, Y, Z, dX, dY, dZ
+/// of every lane, as described in BatchKinematics. Only the states are
+/// propagated, not the STM. Each Action adds the accelerations of the
+/// whole group in one getBatchAcceleration call.
+///
+/// The helper owns its list of actions, so it can be copied and moved
+/// along with its owner.
+///
+class BatchOdeintHelper{
+ public:
+  typedef std::array< double, 6 * BatchKinematics::kLanes > state_type;
+
+  BatchOdeintHelper();
+ ~BatchOdeintHelper();
+
+  // Allows this class to be called by the odeint solver
+  void operator() ( const state_type& x, state_type& dxdt, const double t );
+
+  // Add an action, and take the body rotation rate from the actions
+  void addAction( std::shared_ptr< Action > a );
+
+  // Number of times operator() was called
+  unsigned long getNumCalls() const;
+
+ private:
+  std::vector< std::shared_ptr< Action > > m_actions;
+
+  // Geometry of the current stage, and the accelerations of each lane
+  BatchKinematics m_kinematics;
+  BatchKinematics::Lanes m_accel[3];
+
+  unsigned long m_numCalls;
+};
+
+#endif // EKF_BATCHODEINTHELPER_HEADER_GUARD
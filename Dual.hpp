@@ -0,0 +1,183 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Dual.hpp
+/// @brief   Dual numbers for forward-mode automatic differentiation of
+///          the Actions.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_DUAL_HEADER_GUARD
+#define EKF_DUAL_HEADER_GUARD
+
+// C++ Standard Library
+#include <cmath>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+/// @brief A value together with its derivatives wrt N variables.
+///
+/// Arithmetic on Duals applies the chain rule to every derivative at
+/// once, so a function written as a template over its scalar type
+/// returns its full Jacobian row when called with Duals. The
+/// derivatives are a fixed size Eigen array, so each operation is a
+/// few straight-line SIMD instructions with no loop or branch. Keep N
+/// even to fill whole SSE registers.
+///
+/// Only the operations the Actions need are defined: + - * / with
+/// Duals and doubles, sqrt and exp.
+///
+template< int N >
+struct Dual
+{
+  typedef Eigen::Array< double, N, 1 > Derivatives;
+
+  double value;
+  Derivatives d;
+
+  Dual()
+      : value( 0.0 ),
+        d( Derivatives::Zero() )
+  {
+  }
+
+  // A constant
+  Dual( double v )
+      : value( v ),
+        d( Derivatives::Zero() )
+  {
+  }
+
+  Dual( double v, const Derivatives &derivatives )
+      : value( v ),
+        d( derivatives )
+  {
+  }
+
+  // Independent variable "i" of the N, at value "v"
+  static Dual variable( double v, int i )
+  {
+    Dual x( v );
+    x.d( i ) = 1.0;
+    return x;
+  }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator-( const Dual< N > &a )
+{
+  return Dual< N >( -a.value, -a.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator+( const Dual< N > &a, const Dual< N > &b )
+{
+  return Dual< N >( a.value + b.value, a.d + b.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator+( const Dual< N > &a, double b )
+{
+  return Dual< N >( a.value + b, a.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator+( double a, const Dual< N > &b )
+{
+  return Dual< N >( a + b.value, b.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator-( const Dual< N > &a, const Dual< N > &b )
+{
+  return Dual< N >( a.value - b.value, a.d - b.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator-( const Dual< N > &a, double b )
+{
+  return Dual< N >( a.value - b, a.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator-( double a, const Dual< N > &b )
+{
+  return Dual< N >( a - b.value, -b.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator*( const Dual< N > &a, const Dual< N > &b )
+{
+  return Dual< N >( a.value * b.value, b.value * a.d + a.value * b.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator*( const Dual< N > &a, double b )
+{
+  return Dual< N >( a.value * b, b * a.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator*( double a, const Dual< N > &b )
+{
+  return Dual< N >( a * b.value, a * b.d );
+}
+
+// One division, then multiplications
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator/( const Dual< N > &a, const Dual< N > &b )
+{
+  double inverse = 1.0 / b.value;
+  double q = a.value * inverse;
+  return Dual< N >( q, inverse * ( a.d - q * b.d ) );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator/( const Dual< N > &a, double b )
+{
+  double inverse = 1.0 / b;
+  return Dual< N >( a.value * inverse, inverse * a.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+operator/( double a, const Dual< N > &b )
+{
+  double q = a / b.value;
+  return Dual< N >( q, ( -q / b.value ) * b.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+sqrt( const Dual< N > &a )
+{
+  double root = std::sqrt( a.value );
+  return Dual< N >( root, ( 0.5 / root ) * a.d );
+}
+
+template< int N >
+EIGEN_ALWAYS_INLINE Dual< N >
+exp( const Dual< N > &a )
+{
+  double e = std::exp( a.value );
+  return Dual< N >( e, e * a.d );
+}
+
+#endif // EKF_DUAL_HEADER_GUARD
@@ -0,0 +1,90 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ErrorChecker.hpp
+/// @brief   Step size error control for the odeint controlled steppers
+///          used by Motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_ERRORCHECKER_HEADER_GUARD
+#define EKF_ERRORCHECKER_HEADER_GUARD
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+/// @brief Step size error control over a chosen subset of the state.
+///
+/// Drop-in replacement for odeint's default_error_checker. The error of
+/// each component is scaled as odeint does, by eps_abs + eps_rel * ( |x|
+/// + dt * |dxdt| ), and then multiplied by a per-component weight before
+/// taking the maximum. Components past the end of the weights are not
+/// controlled at all, so weights of six ones control the step size on
+/// the state alone and simply carry the STM along. No weights at all
+/// means every component has weight one, as with the default checker.
+///
+class WeightedErrorChecker
+{
+ public:
+  typedef double value_type;
+  typedef boost::numeric::odeint::range_algebra algebra_type;
+  typedef boost::numeric::odeint::default_operations operations_type;
+
+  WeightedErrorChecker( double epsAbs = 1.E-6, double epsRel = 1.E-6,
+                        const std::vector< double > &weights =
+                          std::vector< double >() )
+      : m_epsAbs( epsAbs ),
+        m_epsRel( epsRel ),
+        m_weights( weights )
+  {
+  }
+
+  // Weighted, scaled maximum error of a trial step
+  template< class State, class Deriv, class Err, class Time >
+  double error( algebra_type &, const State &xOld,
+                const Deriv &dxdtOld, Err &xErr, Time dt ) const
+  {
+    std::size_t size = xErr.size();
+    if ( !m_weights.empty() )
+    {
+      size = std::min( size, m_weights.size() );
+    }
+
+    double absDt = std::abs( dt );
+    double maxError = 0.0;
+    for ( std::size_t i = 0; i < size; ++i )
+    {
+      double scale = m_epsAbs + m_epsRel * ( std::abs( xOld[i] ) +
+                                             absDt * std::abs( dxdtOld[i] ) );
+      double error = std::abs( xErr[i] ) / scale;
+      if ( !m_weights.empty() )
+      {
+        error *= m_weights[i];
+      }
+      maxError = std::max( maxError, error );
+    }
+    return maxError;
+  }
+
+  template< class State, class Deriv, class Err, class Time >
+  double error( const State &xOld, const Deriv &dxdtOld, Err &xErr,
+                Time dt ) const
+  {
+    algebra_type algebra;
+    return error( algebra, xOld, dxdtOld, xErr, dt );
+  }
+
+ private:
+  double m_epsAbs;
+  double m_epsRel;
+  std::vector< double > m_weights;
+};
+
+#endif // EKF_ERRORCHECKER_HEADER_GUARD
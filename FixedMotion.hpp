@@ -0,0 +1,425 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    FixedMotion.hpp
+/// @brief   Manage the motion of an agent through space, for a number
+///          of active agents fixed at compile time.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_FIXEDMOTION_HEADER_GUARD
+#define EKF_FIXEDMOTION_HEADER_GUARD
+
+// C++ Standard Library
+#include <array>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// ekf Library
+#include <Action.hpp>
+#include <ActionList.hpp>
+#include <FixedOdeintHelper.hpp>
+
+/// @brief Manage the motion of an agent through space, with N active
+/// agents.
+///
+/// This is the compile-time sized counterpart of Motion, for production
+/// set ups where the state size is known when building: N = 6 for the
+/// state alone, or 6 plus a fixed set of parameters. The state and STM
+/// are held in a std::array, so the stepper algebra and the right hand
+/// side work on fixed-size data throughout.
+///
+/// Unlike Motion, it only keeps the current state and STM; it does not
+/// log past states. Motion remains the general, dynamically sized
+/// fallback.
+///
+/// The force model is an ActionList, filled by addAction, unless an
+/// ActionSet is given as Forces and passed to the constructor.
+///
+template< int N, class Forces = ActionList >
+class FixedMotion {
+
+ public:
+  typedef typename FixedOdeintHelper< N, Forces >::state_type state_type;
+
+  FixedMotion();
+  FixedMotion( const std::vector< double > &ic, double step );
+  FixedMotion( const std::vector< double > &ic, double step,
+               const Forces &forces );
+  // Copies and moves rebind the integrator to the new object's force
+  // model and agents
+  FixedMotion( const FixedMotion &other );
+  FixedMotion( FixedMotion &&other );
+  FixedMotion& operator=( const FixedMotion &other );
+  FixedMotion& operator=( FixedMotion &&other );
+ ~FixedMotion();
+
+  // Step to time t
+  void stepTo( double t );
+
+  // Add effect of action to motion. Only for an ActionList force model.
+  void addAction( std::shared_ptr<Action> a );
+  // Activate agents for partials computations. Together with the six
+  // state components, there must be exactly N active agents.
+  void activateAgents( const std::vector< std::string > agentNames );
+
+  // Choose the step size tolerances, over every component of the state
+  // and STM
+  void setTolerances( double absTol = 1.E-10, double relTol = 1.E-9 );
+
+  // Get current time step
+  double getTime() const;
+  // Get value of state at the current time
+  std::vector< double > getState() const;
+  // Get the partials of state at the current time
+  std::vector< double > getStatePartials() const;
+
+ private:
+  typedef boost::numeric::odeint::controlled_runge_kutta<
+    boost::numeric::odeint::runge_kutta_dopri5< state_type > >
+    ControlledStepper;
+
+  double m_time;
+  state_type m_stateAndPartials;
+  // Time derivative of m_stateAndPartials at m_time
+  state_type m_rates;
+  bool m_ratesValid;
+  std::vector< std::string > m_activeAgents;
+  // Initial step size, and the step size adapted so far
+  double m_step;
+  double m_dt;
+  double m_absTol;
+  double m_relTol;
+  ControlledStepper m_stepper;
+  Forces m_forces;
+  FixedOdeintHelper< N, Forces > m_helper;
+
+  void initializePartials();
+};
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+template< int N, class Forces >
+FixedMotion< N, Forces >::
+FixedMotion()
+    : m_time(),
+      m_stateAndPartials(),
+      m_rates(),
+      m_ratesValid( false ),
+      m_activeAgents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
+      m_step(),
+      m_dt(),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_stepper( typename ControlledStepper::error_checker_type( m_absTol,
+                                                                m_relTol ) ),
+      m_forces(),
+      m_helper( m_forces, m_activeAgents )
+{
+  initializePartials();
+  m_helper.activateAgents();
+}
+
+// Constructor with set of intitial conditions
+template< int N, class Forces >
+FixedMotion< N, Forces >::
+FixedMotion(
+    const std::vector< double >& ic,
+    double step )
+    : m_time( 0 ),
+      m_stateAndPartials(),
+      m_rates(),
+      m_ratesValid( false ),
+      m_activeAgents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
+      m_step( step ),
+      m_dt( step ),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_stepper( typename ControlledStepper::error_checker_type( m_absTol,
+                                                                m_relTol ) ),
+      m_forces(),
+      m_helper( m_forces, m_activeAgents )
+{
+  for ( int i = 0; i < 6 ; ++i )
+  {
+    m_stateAndPartials[i] = ic[i];
+  }
+  initializePartials();
+  m_helper.activateAgents();
+}
+
+// Constructor with set of initial conditions and force model
+template< int N, class Forces >
+FixedMotion< N, Forces >::
+FixedMotion(
+    const std::vector< double >& ic,
+    double step,
+    const Forces &forces )
+    : m_time( 0 ),
+      m_stateAndPartials(),
+      m_rates(),
+      m_ratesValid( false ),
+      m_activeAgents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
+      m_step( step ),
+      m_dt( step ),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_stepper( typename ControlledStepper::error_checker_type( m_absTol,
+                                                                m_relTol ) ),
+      m_forces( forces ),
+      m_helper( m_forces, m_activeAgents )
+{
+  for ( int i = 0; i < 6 ; ++i )
+  {
+    m_stateAndPartials[i] = ic[i];
+  }
+  initializePartials();
+  m_helper.activateAgents();
+}
+
+// Copy Constructor
+template< int N, class Forces >
+FixedMotion< N, Forces >::
+FixedMotion( const FixedMotion &other )
+    : m_time( other.m_time ),
+      m_stateAndPartials( other.m_stateAndPartials ),
+      m_rates( other.m_rates ),
+      m_ratesValid( other.m_ratesValid ),
+      m_activeAgents( other.m_activeAgents ),
+      m_step( other.m_step ),
+      m_dt( other.m_dt ),
+      m_absTol( other.m_absTol ),
+      m_relTol( other.m_relTol ),
+      m_stepper( other.m_stepper ),
+      m_forces( other.m_forces ),
+      m_helper( other.m_helper, m_forces, m_activeAgents )
+{
+}
+
+// Move Constructor
+template< int N, class Forces >
+FixedMotion< N, Forces >::
+FixedMotion( FixedMotion &&other )
+    : m_time( other.m_time ),
+      m_stateAndPartials( other.m_stateAndPartials ),
+      m_rates( other.m_rates ),
+      m_ratesValid( other.m_ratesValid ),
+      m_activeAgents( std::move( other.m_activeAgents ) ),
+      m_step( other.m_step ),
+      m_dt( other.m_dt ),
+      m_absTol( other.m_absTol ),
+      m_relTol( other.m_relTol ),
+      m_stepper( std::move( other.m_stepper ) ),
+      m_forces( std::move( other.m_forces ) ),
+      m_helper( other.m_helper, m_forces, m_activeAgents )
+{
+}
+
+// Copy Assignment
+template< int N, class Forces >
+FixedMotion< N, Forces >&
+FixedMotion< N, Forces >::
+operator=( const FixedMotion &other )
+{
+  if ( this != &other )
+  {
+    FixedMotion copy( other );
+    *this = std::move( copy );
+  }
+  return *this;
+}
+
+// Move Assignment
+template< int N, class Forces >
+FixedMotion< N, Forces >&
+FixedMotion< N, Forces >::
+operator=( FixedMotion &&other )
+{
+  if ( this != &other )
+  {
+    m_time = other.m_time;
+    m_stateAndPartials = other.m_stateAndPartials;
+    m_rates = other.m_rates;
+    m_ratesValid = other.m_ratesValid;
+    m_activeAgents = std::move( other.m_activeAgents );
+    m_step = other.m_step;
+    m_dt = other.m_dt;
+    m_absTol = other.m_absTol;
+    m_relTol = other.m_relTol;
+    m_stepper = std::move( other.m_stepper );
+    m_forces = std::move( other.m_forces );
+    m_helper = FixedOdeintHelper< N, Forces >( other.m_helper, m_forces,
+                                               m_activeAgents );
+  }
+  return *this;
+}
+
+// Default Destructor
+template< int N, class Forces >
+FixedMotion< N, Forces >::
+~FixedMotion() {}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an Action
+template< int N, class Forces >
+void
+FixedMotion< N, Forces >::
+addAction( std::shared_ptr< Action > a )
+{
+  m_forces.push_back( a );
+  m_helper.activateAgents();
+
+  // The dynamics changed, so the derivative at m_time is stale
+  m_ratesValid = false;
+}
+
+// Activate partials tracking for named agents
+template< int N, class Forces >
+void
+FixedMotion< N, Forces >::
+activateAgents( const std::vector< std::string > agentNames )
+{
+  if ( m_activeAgents.size() + agentNames.size() != std::size_t( N ) )
+  {
+    throw std::invalid_argument(
+      "FixedMotion::activateAgents: wrong number of agents for N" );
+  }
+  for ( std::string a: agentNames )
+  {
+    m_activeAgents.push_back( a );
+  }
+
+  initializePartials();
+  m_helper.activateAgents();
+  m_ratesValid = false;
+}
+
+// Step the integration of Motion object to time t
+template< int N, class Forces >
+void
+FixedMotion< N, Forces >::
+stepTo( double t )
+{
+  if ( m_activeAgents.size() != std::size_t( N ) )
+  {
+    throw std::logic_error(
+      "FixedMotion::stepTo: fewer than N agents are active" );
+  }
+
+  // dopri5 is FSAL, so each accepted step hands back the derivative at
+  // its end for free, and it only has to be evaluated here after the
+  // dynamics were changed from outside
+  if ( !m_ratesValid )
+  {
+    m_helper( m_stateAndPartials, m_rates, m_time );
+    m_ratesValid = true;
+  }
+
+  // Integrate from current time to time t with adaptive steps, clipping
+  // the last step to land on t. A clipped step does not shrink the step
+  // size carried to the next one. The helper is passed by reference, so
+  // that odeint does not copy it on every step.
+  double time = m_time;
+  while ( time < t )
+  {
+    bool clipped = ( t - time <= m_dt );
+    double trialStep = clipped ? t - time : m_dt;
+    if ( m_stepper.try_step( std::ref( m_helper ), m_stateAndPartials,
+                             m_rates, time, trialStep ) ==
+         boost::numeric::odeint::success )
+    {
+      if ( clipped )
+      {
+        time = t;
+      }
+      else
+      {
+        m_dt = trialStep;
+      }
+    }
+    else
+    {
+      m_dt = trialStep;
+    }
+  }
+  m_time = t;
+}
+
+// Choose the step size tolerances
+template< int N, class Forces >
+void
+FixedMotion< N, Forces >::
+setTolerances( double absTol, double relTol )
+{
+  m_absTol = absTol;
+  m_relTol = relTol;
+  m_stepper = ControlledStepper(
+    typename ControlledStepper::error_checker_type( absTol, relTol ) );
+}
+
+// Return the current time step.
+template< int N, class Forces >
+double
+FixedMotion< N, Forces >::
+getTime() const
+{
+  return m_time;
+}
+
+// Return the state of the motion at the current time step.
+template< int N, class Forces >
+std::vector< double >
+FixedMotion< N, Forces >::
+getState() const
+{
+  return std::vector< double >( m_stateAndPartials.begin(),
+                                m_stateAndPartials.begin() + 6 );
+}
+
+// Return the state partials of the motion wrt the active agents at the
+// current time step ( the partials are dX(t)/dX(t0) )
+template< int N, class Forces >
+std::vector< double >
+FixedMotion< N, Forces >::
+getStatePartials() const
+{
+  return std::vector< double >( m_stateAndPartials.begin() + 6,
+                                m_stateAndPartials.end() );
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Set the state partials from t0 to t0, i.e. the identity matrix
+template< int N, class Forces >
+void
+FixedMotion< N, Forces >::
+initializePartials()
+{
+  for ( int i = 0; i < N * N; ++i )
+  {
+    m_stateAndPartials[ 6 + i ] = 0.0;
+  }
+  for ( int i = 0; i < N; ++i )
+  {
+    m_stateAndPartials[ 6 + N * i + i ] = 1.0;
+  }
+}
+
+#endif // EKF_FIXEDMOTION_HEADER_GUARD
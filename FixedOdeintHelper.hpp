@@ -0,0 +1,211 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    FixedOdeintHelper.hpp
+/// @brief   Interface class between ekf and boost::odeint for a number
+///          of active agents fixed at compile time.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_FIXEDODEINTHELPER_HEADER_GUARD
+#define EKF_FIXEDODEINTHELPER_HEADER_GUARD
+
+// C++ Standard Library
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <ActionList.hpp>
+#include <Kinematics.hpp>
+
+/// @brief Interface class between ekf and boost::odeint for N active
+/// agents.
+///
+/// This is the compile-time sized counterpart of OdeintHelper. The
+/// state, STM and workspaces are std::array / fixed-size Eigen types,
+/// so the compiler can unroll and vectorize the right hand side. It
+/// propagates the STM with the same block structure as OdeintHelper,
+/// and likewise expects the first six active agents to be the state.
+///
+/// The force model is an ActionList by default. An ActionSet fixes it
+/// at compile time as well, removing the virtual calls.
+///
+template< int N, class Forces = ActionList >
+class FixedOdeintHelper
+{
+  static_assert( N >= 6, "The six state components must be active" );
+
+ public:
+  typedef std::array< double, 6 + N * N > state_type;
+
+  FixedOdeintHelper();
+  FixedOdeintHelper( Forces& forces,
+                     std::vector< std::string >& activeAgents );
+  // Copy of "other" working on "forces" and "activeAgents" instead, for
+  // the owner of the helper to use when it is copied or moved
+  FixedOdeintHelper( const FixedOdeintHelper &other, Forces& forces,
+                     std::vector< std::string >& activeAgents );
+ ~FixedOdeintHelper();
+
+  // Allows this class to be called by the odeint solver
+  void operator() ( const state_type& x, state_type& dxdt, const double t );
+
+  // Resolve the agents owned by each action against the active agents
+  // and take the body rotation rate from the actions. Must be called
+  // whenever actions or active agents change. Throws
+  // std::invalid_argument unless the active agents start with X, Y, Z,
+  // dX, dY, dZ.
+  void activateAgents();
+
+ private:
+  typedef Eigen::Matrix< double, N, N, Eigen::RowMajor > StmMatrix;
+  typedef Eigen::Matrix< double, 3, N, Eigen::RowMajor > PartialsMatrix;
+
+  Forces* m_forces;
+  std::vector< std::string >* m_activeAgents;
+
+  // Geometry of the current stage, shared by the actions
+  Kinematics m_kinematics;
+
+  // Workspaces
+  std::array< double, 3 > m_accel;
+  std::array< double, 3 * N > m_partials;
+};
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+template< int N, class Forces >
+FixedOdeintHelper< N, Forces >::
+FixedOdeintHelper()
+    : m_forces(),
+      m_activeAgents(),
+      m_kinematics(),
+      m_accel(),
+      m_partials()
+{
+}
+
+template< int N, class Forces >
+FixedOdeintHelper< N, Forces >::
+FixedOdeintHelper(
+    Forces& forces,
+    std::vector< std::string >& activeAgents )
+    : m_forces( &forces ),
+      m_activeAgents( &activeAgents ),
+      m_kinematics(),
+      m_accel(),
+      m_partials()
+{
+}
+
+template< int N, class Forces >
+FixedOdeintHelper< N, Forces >::
+FixedOdeintHelper(
+    const FixedOdeintHelper &other,
+    Forces& forces,
+    std::vector< std::string >& activeAgents )
+    : FixedOdeintHelper( other )
+{
+  m_forces = &forces;
+  m_activeAgents = &activeAgents;
+}
+
+template< int N, class Forces >
+FixedOdeintHelper< N, Forces >::
+~FixedOdeintHelper()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// This method defines the equations of motion for the odeint
+// integrator. See OdeintHelper::operator() for the structure of the
+// STM derivative.
+template< int N, class Forces >
+void
+FixedOdeintHelper< N, Forces >::
+operator() (
+    const state_type &x,
+    state_type &dxdt,
+    const double t )
+{
+  // Derive the geometry once for all actions
+  m_kinematics.update( x.data(), t );
+
+  // Accumulate accelerations and acceleration partials from the
+  // force model.
+  m_accel.fill( 0.0 );
+  m_partials.fill( 0.0 );
+  m_forces->evaluate( m_accel.data(), m_partials.data(), m_kinematics );
+  Eigen::Map< const PartialsMatrix > accelPartials( m_partials.data() );
+
+  // View the current STM and its derivative, stored row-major after
+  // the state
+  Eigen::Map< const StmMatrix > stm( x.data() + 6 );
+  Eigen::Map< StmMatrix > dStm( dxdt.data() + 6 );
+
+  // Position rows: d/dt dR/dX0 = dV/dX0
+  dStm.template topRows< 3 >() = stm.template middleRows< 3 >( 3 );
+
+  // Velocity rows: d/dt dV/dX0 = [Ar Av] * dState/dX0 + [0 Ap]
+  dStm.template middleRows< 3 >( 3 ).noalias() =
+    accelPartials.template leftCols< 6 >() * stm.template topRows< 6 >();
+  dStm.template block< 3, N - 6 >( 3, 6 ) +=
+    accelPartials.template rightCols< N - 6 >();
+
+  // Parameter rows: constant
+  dStm.template bottomRows< N - 6 >().setZero();
+
+  // State elements
+  dxdt[0] = x[3]; // X_dot
+  dxdt[1] = x[4]; // Y_dot
+  dxdt[2] = x[5]; // Z_dot
+  dxdt[3] = m_accel[0]; // DX_dot
+  dxdt[4] = m_accel[1]; // DY_dot
+  dxdt[5] = m_accel[2]; // DY_dot
+}
+
+// Resolve where each action's owned agents sit in the partials block,
+// and take the body rotation rate from the force model.
+template< int N, class Forces >
+void
+FixedOdeintHelper< N, Forces >::
+activateAgents()
+{
+  // The state block of the partials is laid out by operator() as X, Y, Z,
+  // dX, dY, dZ; anything else would silently mislabel the STM.
+  static const char *const kStateAgents[] = { "X", "Y", "Z",
+                                              "dX", "dY", "dZ" };
+  if ( m_activeAgents->size() < 6 )
+  {
+    throw std::invalid_argument(
+      "The active agents must start with X, Y, Z, dX, dY, dZ" );
+  }
+  for ( int i = 0; i < 6; ++i )
+  {
+    if ( ( *m_activeAgents )[i] != kStateAgents[i] )
+    {
+      throw std::invalid_argument(
+        "Active agent " + std::to_string( i ) + " is \"" +
+        ( *m_activeAgents )[i] + "\", expected \"" + kStateAgents[i] +
+        "\"" );
+    }
+  }
+
+  m_kinematics = Kinematics( m_forces->getRotationRate() );
+  m_forces->activateAgents( *m_activeAgents );
+}
+
+#endif // EKF_FIXEDODEINTHELPER_HEADER_GUARD
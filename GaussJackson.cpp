@@ -0,0 +1,497 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    GaussJackson.cpp
+/// @brief   Eighth order Gauss-Jackson fixed step integrator for the
+///          state and STM of Motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
+
+// ekf Library
+#include <GaussJackson.hpp>
+
+namespace
+{
+
+// The second derivative is fitted with a polynomial of degree kOrder
+// over kPoints points, at offsets -4 to 4 from the center point
+const int kOrder = 8;
+const int kPoints = kOrder + 1;
+const int kHalf = kOrder / 2;
+
+const int kMaxCorrections = 10;
+const int kMaxStartupIterations = 20;
+
+// Operator series of the sums, in powers of D = d/dn for a unit step.
+// With the first sum s(n+1) = s(n) + ( f(n) + f(n+1) ) / 2 and the
+// second sum S(n+1) = S(n) + s(n) + f(n) / 2 of the second derivatives
+// f, the velocity is h ( s + L f ) and the position h^2 ( S + A f ),
+// where L = 1 / D - coth( D / 2 ) / 2 and A = 1 / D^2 - 1 / ( 4
+// sinh^2( D / 2 ) ). Terms past D^8 vanish on the fitted polynomial.
+const double kVelocitySeries[ kPoints ] = {
+  0.0, -1.0 / 12.0, 0.0, 1.0 / 720.0, 0.0, -1.0 / 30240.0, 0.0,
+  1.0 / 1209600.0, 0.0 };
+const double kPositionSeries[ kPoints ] = {
+  1.0 / 12.0, 0.0, -1.0 / 240.0, 0.0, 1.0 / 6048.0, 0.0,
+  -1.0 / 172800.0, 0.0, 1.0 / 5322240.0 };
+
+// Weights of the Gauss-Jackson formulas on the nine points, in rows for
+// the offsets -4 to 5 from the center point
+struct Coefficients
+{
+  // Monomial coefficients of the Lagrange basis polynomials
+  double lagrange[ kPoints ][ kPoints ];
+  // Position and velocity weights
+  double a[ kPoints + 1 ][ kPoints ];
+  double b[ kPoints + 1 ][ kPoints ];
+  // Velocity weights of the predictor at offset 5, with the half of the
+  // new second derivative that its first sum lacks
+  double predictor[ kPoints ];
+
+  Coefficients();
+};
+
+// Apply the series to each basis polynomial at each offset
+Coefficients::
+Coefficients()
+{
+  for ( int k = 0; k < kPoints; ++k )
+  {
+    double *l = lagrange[k];
+    std::fill( l, l + kPoints, 0.0 );
+    l[0] = 1.0;
+    int degree = 0;
+    for ( int m = 0; m < kPoints; ++m )
+    {
+      if ( m == k )
+      {
+        continue;
+      }
+      // Multiply by ( x - x_m ) / ( x_k - x_m )
+      double scale = 1.0 / ( k - m );
+      for ( int d = degree + 1; d >= 0; --d )
+      {
+        l[d] = ( ( d > 0 ? l[ d - 1 ] : 0.0 ) - ( m - kHalf ) * l[d] ) * scale;
+      }
+      ++degree;
+    }
+
+    for ( int row = 0; row <= kPoints; ++row )
+    {
+      // Derivatives of the basis polynomial at offset j, by Horner's
+      // rule on the differentiated monomials
+      double j = row - kHalf;
+      double value = 0.0, position = 0.0, velocity = 0.0;
+      for ( int order = 0; order < kPoints; ++order )
+      {
+        double derivative = 0.0;
+        for ( int d = kOrder; d >= order; --d )
+        {
+          double factor = 1.0;
+          for ( int e = d - order + 1; e <= d; ++e )
+          {
+            factor *= e;
+          }
+          derivative = derivative * j + factor * l[d];
+        }
+        if ( order == 0 )
+        {
+          value = derivative;
+        }
+        position += kPositionSeries[ order ] * derivative;
+        velocity += kVelocitySeries[ order ] * derivative;
+      }
+      a[ row ][k] = position;
+      b[ row ][k] = velocity;
+      if ( row == kPoints )
+      {
+        predictor[k] = 0.5 * value + velocity;
+      }
+    }
+  }
+}
+
+// Coefficients, derived once
+const Coefficients&
+coefficients()
+{
+  static const Coefficients c;
+  return c;
+}
+
+// Value at x of the n-th antiderivative of the polynomial with monomial
+// coefficients "l", the one vanishing at zero
+double
+antiderivative( const double *l, int n, double x )
+{
+  double sum = 0.0;
+  for ( int d = kOrder; d >= 0; --d )
+  {
+    double factor = 1.0;
+    for ( int e = d + 1; e <= d + n; ++e )
+    {
+      factor *= e;
+    }
+    sum = sum * x + l[d] / factor;
+  }
+  return sum * std::pow( x, n );
+}
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+GaussJackson::
+GaussJackson()
+    : GaussJackson( 1.0, 1.E-10, 1.E-9 )
+{
+}
+
+GaussJackson::
+GaussJackson(
+    double step,
+    double absTol,
+    double relTol )
+    : m_step( step ),
+      m_absTol( absTol ),
+      m_relTol( relTol ),
+      m_numPairs( 0 ),
+      m_rowOffset( 0 ),
+      m_startTime( 0.0 ),
+      m_lastPoint( -1 ),
+      m_states(),
+      m_rates(),
+      m_firstSum(),
+      m_secondSum()
+{
+  if ( !( step > 0.0 ) )
+  {
+    throw std::invalid_argument( "GaussJackson: step must be positive" );
+  }
+}
+
+GaussJackson::
+~GaussJackson()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Drop the grid
+void
+GaussJackson::
+reset()
+{
+  m_lastPoint = -1;
+}
+
+// Whether the grid was started
+bool
+GaussJackson::
+isStarted() const
+{
+  return m_lastPoint >= 0;
+}
+
+// Start the grid with eight Runge-Kutta-Fehlberg 7(8) steps, and iterate
+// the startup corrector over them. The sums are anchored at point 0,
+// whose state is given, and each iteration recomputes points 1 to 8
+// from the second derivatives of the previous one.
+void
+GaussJackson::
+start(
+    OdeintHelper &system,
+    const std::vector< double > &x,
+    double t )
+{
+  using namespace boost::numeric::odeint;
+
+  int numAgents = int( std::sqrt( double( x.size() - 6 ) ) + 0.5 );
+  m_numPairs = 3 + 3 * numAgents;
+  m_rowOffset = 3 * numAgents;
+  m_startTime = t;
+  m_states.assign( kSlots, x );
+  m_rates.assign( kSlots, std::vector< double >( x.size(), 0.0 ) );
+  m_firstSum.assign( m_numPairs, 0.0 );
+  m_secondSum.assign( m_numPairs, 0.0 );
+
+  // The helper is passed by reference, as by Motion
+  system( m_states[0], m_rates[0], t );
+  runge_kutta_fehlberg78< std::vector< double > > startup;
+  for ( int p = 1; p <= kOrder; ++p )
+  {
+    m_states[p] = m_states[ p - 1 ];
+    startup.do_step( std::ref( system ), m_states[p], m_rates[ p - 1 ],
+                     time( p - 1 ), m_step );
+    system( m_states[p], m_rates[p], time( p ) );
+  }
+
+  const Coefficients &c = coefficients();
+  const double *f[ kPoints ];
+  window( 0, f );
+  double h = m_step;
+  for ( int iteration = 0; iteration < kMaxStartupIterations; ++iteration )
+  {
+    // Sums at point 0, at offset -4 from the center
+    const std::vector< double > &x0 = m_states[0];
+    for ( int i = 0; i < m_numPairs; ++i )
+    {
+      int v = velocity( i );
+      double sa = 0.0, sb = 0.0;
+      for ( int k = 0; k < kPoints; ++k )
+      {
+        sa += c.a[0][k] * f[k][v];
+        sb += c.b[0][k] * f[k][v];
+      }
+      m_secondSum[i] = x0[ position( i ) ] / ( h * h ) - sa;
+      m_firstSum[i] = x0[ v ] / h - sb;
+    }
+
+    bool converged = true;
+    for ( int p = 1; p <= kOrder; ++p )
+    {
+      double *xp = m_states[p].data();
+      for ( int i = 0; i < m_numPairs; ++i )
+      {
+        double f0 = f[ p - 1 ][ velocity( i ) ];
+        double f1 = f[p][ velocity( i ) ];
+        m_secondSum[i] += m_firstSum[i] + 0.5 * f0;
+        m_firstSum[i] += 0.5 * ( f0 + f1 );
+        converged &= apply( m_secondSum[i], m_firstSum[i], c.a[p], c.b[p], f,
+                            i, xp );
+      }
+    }
+    if ( converged || ( iteration + 1 == kMaxStartupIterations ) )
+    {
+      break;
+    }
+    for ( int p = 1; p <= kOrder; ++p )
+    {
+      system( m_states[p], m_rates[p], time( p ) );
+    }
+  }
+
+  // The derivative of a position is the corrected velocity
+  for ( int p = 1; p <= kOrder; ++p )
+  {
+    for ( int i = 0; i < m_numPairs; ++i )
+    {
+      m_rates[p][ position( i ) ] = m_states[p][ velocity( i ) ];
+    }
+  }
+  m_lastPoint = kOrder;
+}
+
+// Predict the next point from the last nine, then evaluate and correct
+// from the nine ending with it, until the correction settles. The
+// second derivative from the last evaluation is kept with the point.
+void
+GaussJackson::
+step( OdeintHelper &system )
+{
+  const Coefficients &c = coefficients();
+  long last = m_lastPoint;
+  long next = last + 1;
+  std::vector< double > &x = m_states[ next % kSlots ];
+  std::vector< double > &dxdt = m_rates[ next % kSlots ];
+  double t = time( next );
+
+  // Predict, with the second sum at the new point and the first sum
+  // less half the new second derivative. The parameter rows are copied.
+  const double *f[ kPoints ];
+  window( last - kOrder, f );
+  const double *fLast = f[ kOrder ];
+  x = m_states[ last % kSlots ];
+  for ( int i = 0; i < m_numPairs; ++i )
+  {
+    double half = 0.5 * fLast[ velocity( i ) ];
+    m_secondSum[i] += m_firstSum[i] + half;
+    apply( m_secondSum[i], m_firstSum[i] + half, c.a[ kPoints ],
+           c.predictor, f, i, x.data() );
+  }
+
+  // Evaluate and correct
+  window( last - kOrder + 1, f );
+  for ( int correction = 0; correction < kMaxCorrections; ++correction )
+  {
+    system( x, dxdt, t );
+    bool converged = true;
+    for ( int i = 0; i < m_numPairs; ++i )
+    {
+      int v = velocity( i );
+      double firstSum = m_firstSum[i] + 0.5 * ( fLast[v] + dxdt[v] );
+      converged &= apply( m_secondSum[i], firstSum, c.a[ kOrder ],
+                          c.b[ kOrder ], f, i, x.data() );
+    }
+    if ( converged )
+    {
+      break;
+    }
+  }
+
+  for ( int i = 0; i < m_numPairs; ++i )
+  {
+    int v = velocity( i );
+    m_firstSum[i] += 0.5 * ( fLast[v] + dxdt[v] );
+    dxdt[ position( i ) ] = x[v];
+  }
+  m_lastPoint = next;
+}
+
+// Index of the latest grid point
+long
+GaussJackson::
+lastPoint() const
+{
+  return m_lastPoint;
+}
+
+// Time of grid point "point"
+double
+GaussJackson::
+time( long point ) const
+{
+  return m_startTime + point * m_step;
+}
+
+// State and STM at grid point "point"
+const std::vector< double >&
+GaussJackson::
+state( long point ) const
+{
+  return m_states[ point % kSlots ];
+}
+
+// Derivative of the state and STM at grid point "point"
+const std::vector< double >&
+GaussJackson::
+rates( long point ) const
+{
+  return m_rates[ point % kSlots ];
+}
+
+// Integrate the polynomial through the last nine second derivatives
+// from the grid point nearest to t, once for the velocities and twice
+// for the positions
+void
+GaussJackson::
+interpolate( double t, double *x ) const
+{
+  long first = m_lastPoint - kOrder;
+  if ( ( first < 0 ) || ( t < time( first ) ) || ( t > time( m_lastPoint ) ) )
+  {
+    throw std::out_of_range( "GaussJackson: time is outside the last steps" );
+  }
+
+  // Offsets from the center point of t and of the nearest point
+  long center = m_lastPoint - kHalf;
+  double y = ( t - time( center ) ) / m_step;
+  long nearest = std::min( std::max( center + std::lround( y ), first ),
+                           m_lastPoint );
+  double start = nearest - center;
+
+  const Coefficients &c = coefficients();
+  double w1[ kPoints ], w2[ kPoints ];
+  for ( int k = 0; k < kPoints; ++k )
+  {
+    double q1 = antiderivative( c.lagrange[k], 1, start );
+    w1[k] = antiderivative( c.lagrange[k], 1, y ) - q1;
+    w2[k] = antiderivative( c.lagrange[k], 2, y ) -
+            antiderivative( c.lagrange[k], 2, start ) - ( y - start ) * q1;
+  }
+
+  const double *f[ kPoints ];
+  window( first, f );
+  const std::vector< double > &xn = state( nearest );
+  std::copy( xn.begin(), xn.end(), x );
+  double h = m_step;
+  for ( int i = 0; i < m_numPairs; ++i )
+  {
+    int p = position( i ), v = velocity( i );
+    double s1 = 0.0, s2 = 0.0;
+    for ( int k = 0; k < kPoints; ++k )
+    {
+      s1 += w1[k] * f[k][v];
+      s2 += w2[k] * f[k][v];
+    }
+    x[p] = xn[p] + h * ( y - start ) * xn[v] + h * h * s2;
+    x[v] = xn[v] + h * s1;
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// The positions come first in the state, and the position rows first
+// in the STM; the velocities and velocity rows follow each
+int
+GaussJackson::
+position( int i ) const
+{
+  return ( i < 3 ) ? i : i + 3;
+}
+
+int
+GaussJackson::
+velocity( int i ) const
+{
+  return ( i < 3 ) ? i + 3 : i + 3 + m_rowOffset;
+}
+
+// Derivatives at the nine grid points from "first". The second
+// derivative of a position is the derivative of its velocity.
+void
+GaussJackson::
+window( long first, const double **rates ) const
+{
+  for ( int k = 0; k < kPoints; ++k )
+  {
+    rates[k] = m_rates[ ( first + k ) % kSlots ].data();
+  }
+}
+
+// Position and velocity of element i from the sums and the weights
+bool
+GaussJackson::
+apply(
+    double secondSum,
+    double firstSum,
+    const double *a,
+    const double *b,
+    const double *const *rates,
+    int i,
+    double *x ) const
+{
+  int p = position( i ), v = velocity( i );
+  double sa = 0.0, sb = 0.0;
+  for ( int k = 0; k < kPoints; ++k )
+  {
+    sa += a[k] * rates[k][v];
+    sb += b[k] * rates[k][v];
+  }
+  double newPosition = m_step * m_step * ( secondSum + sa );
+  double newVelocity = m_step * ( firstSum + sb );
+  bool converged =
+    ( std::abs( newPosition - x[p] ) <=
+      m_absTol + m_relTol * std::abs( newPosition ) ) &&
+    ( std::abs( newVelocity - x[v] ) <=
+      m_absTol + m_relTol * std::abs( newVelocity ) );
+  x[p] = newPosition;
+  x[v] = newVelocity;
+  return converged;
+}
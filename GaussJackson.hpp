@@ -0,0 +1,120 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    GaussJackson.hpp
+/// @brief   Eighth order Gauss-Jackson fixed step integrator for the
+///          state and STM of Motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_GAUSSJACKSON_HEADER_GUARD
+#define EKF_GAUSSJACKSON_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// ekf Library
+#include <OdeintHelper.hpp>
+
+/// @brief Eighth order Gauss-Jackson integrator, in the summed ordinate
+/// form of Berry and Healy, "Implementation of Gauss-Jackson integration
+/// for orbit propagation", J. Astronaut. Sci. 52 ( 2004 ).
+///
+/// It integrates the state and row-major STM laid out by OdeintHelper as
+/// a second order system: the positions and the position rows of the
+/// STM are advanced from the second sum of their second derivatives,
+/// the accelerations and the derivatives of the velocity rows, and the
+/// velocities and the velocity rows from the first sum. The parameter
+/// rows of the STM are constant.
+///
+/// The grid starts with eight fixed Runge-Kutta-Fehlberg 7(8) steps,
+/// which the startup corrector then iterates to agree with the Gauss-
+/// Jackson formulas. Each following step predicts the new point, takes
+/// the derivative there, and corrects; the correction is repeated, with
+/// a new derivative, until it changes no element by more than the
+/// tolerances, so a step usually costs one right hand side evaluation.
+///
+/// The coefficients are derived at first use, from the operator series
+/// of the sums, as the weights that make the formulas exact when the
+/// second derivative is a polynomial of degree 8 over the nine points.
+///
+class GaussJackson
+{
+ public:
+  GaussJackson();
+  // Integrator with fixed step "step". The corrector iterates until no
+  // element changes by more than absTol + relTol * |element|.
+  GaussJackson( double step, double absTol, double relTol );
+ ~GaussJackson();
+
+  // Drop the grid, so that it is started anew
+  void reset();
+  // Whether the grid was started since construction or reset()
+  bool isStarted() const;
+
+  // Start the grid at the state and STM "x" at time t. Grid points 0 to
+  // 8 are then available.
+  void start( OdeintHelper &system, const std::vector< double > &x,
+              double t );
+  // Add the next grid point
+  void step( OdeintHelper &system );
+
+  // Index of the latest grid point. The last nine can be queried.
+  long lastPoint() const;
+  // Time, state and STM, and their derivative at grid point "point"
+  double time( long point ) const;
+  const std::vector< double >& state( long point ) const;
+  const std::vector< double >& rates( long point ) const;
+
+  // Write the state and STM at time t to "x", from the Gauss-Jackson
+  // interpolation over the last nine grid points. t must lie between
+  // the first and the last of them.
+  void interpolate( double t, double *x ) const;
+
+ private:
+  // Points kept: the nine of the formulas and the one being added
+  static const int kSlots = 10;
+
+  double m_step;
+  double m_absTol;
+  double m_relTol;
+
+  // Number of position-like elements, and offset from the first STM
+  // position row to the first STM velocity row
+  int m_numPairs;
+  int m_rowOffset;
+
+  double m_startTime;
+  long m_lastPoint;
+
+  // State and STM, and their derivative, at grid point p in slot
+  // p % kSlots
+  std::vector< std::vector< double > > m_states;
+  std::vector< std::vector< double > > m_rates;
+
+  // First and second sums of the second derivatives at the latest
+  // point, one per position-like element
+  std::vector< double > m_firstSum;
+  std::vector< double > m_secondSum;
+
+  // Position-like element i of the state and STM, and its velocity-like
+  // partner
+  int position( int i ) const;
+  int velocity( int i ) const;
+
+  // Point "rates" at the derivatives of the nine grid points from
+  // "first"
+  void window( long first, const double **rates ) const;
+
+  // Set position-like element i of "x" and its velocity-like partner
+  // from the sums and the weights "a" and "b" applied to the second
+  // derivatives of the nine points in "rates"; returns whether both
+  // changed by no more than the tolerances
+  bool apply( double secondSum, double firstSum, const double *a,
+              const double *b, const double *const *rates, int i,
+              double *x ) const;
+};
+
+#endif // EKF_GAUSSJACKSON_HEADER_GUARD
@@ -8,10 +8,6 @@
 /// @date    January 24, 2015
 ///
 
-// C++ Standard Library
-#include <iostream>
-#include <cmath>
-
 // ekf Library
 #include <GravityAction.hpp>
 
@@ -25,8 +21,7 @@ GravityAction()
     : m_name(),
       m_radius(),
       m_mu(),
-      m_J2(),
-      m_evaledPartials()
+      m_J2()
 {
 }
 
@@ -40,8 +35,7 @@ GravityAction(
     : m_name( name ),
       m_radius( radius ),
       m_mu( mu ),
-      m_J2( J2 ),
-      m_evaledPartials()
+      m_J2( J2 )
 {
 }
 
@@ -60,152 +54,186 @@ GravityAction::
 void
 GravityAction::
 getAcceleration(
-    std::vector< double > &acceleration,
-    const std::vector< double > &state ) const
+    double *acceleration,
+    const Kinematics &kinematics ) const
 {
-  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                pow( state[2], 2 ) );
-  acceleration[0] += -m_mu * state[0] / pow( dist, 3 ) * accJ2( state, 'x' );
-  acceleration[1] += -m_mu * state[1] / pow( dist, 3 ) * accJ2( state, 'y' );
-  acceleration[2] += -m_mu * state[2] / pow( dist, 3 ) * accJ2( state, 'z' );
+  double a[3];
+  gravity( kinematics.position, kinematics.invR2, kinematics.invR3,
+           m_radius, m_mu, m_J2, a );
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += a[i];
+  }
 }
 
-// Computes the partial derivative of the acceleration terms and owned
-// parameters
+// Computes the accelerations as in getAcceleration() for every lane
 void
 GravityAction::
-getPartials(
-    std::vector< double > &partials,
-    const std::vector< double > &state,
-    const std::vector< std::string >  &activeAgents )
+getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const
 {
-  // Evaluate the class partial for this state
-  evalPartials( state );
-
-  // Loop over active agents and get partial values
-  int numAgents = activeAgents.size();
-  for ( int i = 0; i < numAgents; ++i )
+  typedef BatchKinematics::Lanes Lanes;
+  Lanes a[3];
+  gravity( kinematics.position, kinematics.invR2, kinematics.invR3,
+           Lanes( Lanes::Constant( m_radius ) ),
+           Lanes( Lanes::Constant( m_mu ) ),
+           Lanes( Lanes::Constant( m_J2 ) ), a );
+  for ( int i = 0; i < 3; ++i )
   {
-    // Request the partial from the i loop with respect to all the active
-    // agents ( j loop )
-    for ( int j = 0; j < numAgents; ++j )
-    {
-      if (m_debug)
-      {
-        std::cout << "\nGravityAction::getPartials()" << std::endl
-                  << "Requested Partials: " << activeAgents[i] <<  " wrt "
-                  << activeAgents[j] << std::endl
-                  << "Value of partials: "
-                  << getAgentPartial( activeAgents[i], activeAgents[j] );
-      }
-      partials[ i * numAgents + j ] += getAgentPartial( activeAgents[i],
-                                                        activeAgents[j] );
-    }
+    acceleration[i] += a[i];
   }
 }
 
-//=====================================================================
-//=====================================================================
-// PRIVATE MEMBERS
-
-// Computes the J2 gravitational perturbation, by state component.
-double
+// Computes the acceleration as in getAcceleration() and the partial
+// derivative of the acceleration terms and owned parameters, sharing
+// the terms common to both.
+void
 GravityAction::
-accJ2(
-    const std::vector< double > &state,
-    const char component ) const
+evaluate(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
 {
-  double dist = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                      pow( state[2], 2 ) );
+  // Condense variable names to make following equations more legible
+  double R = m_radius;
+  double mu = m_mu;
+  double J2 = m_J2;
+  double X = kinematics.position[0];
+  double Y = kinematics.position[1];
+  double Z = kinematics.position[2];
+  double R_r2 = R * R * kinematics.invR2;
+  double Z_r2 = Z * Z * kinematics.invR2;
+  double mu_r3 = mu * kinematics.invR3;
+  double mu3_r5 = 3 * mu * kinematics.invR5;
+
+  // Acceleration
+  double J2xy = 1.0 - 1.5 * J2 * R_r2 * ( 5 * Z_r2 - 1 );
+  double J2z = 1.0 - 1.5 * J2 * R_r2 * ( 5 * Z_r2 - 3 );
+
+  acceleration[0] += -mu_r3 * X * J2xy;
+  acceleration[1] += -mu_r3 * Y * J2xy;
+  acceleration[2] += -mu_r3 * Z * J2z;
+
+  // Factors shared by the partials
+  double Q1 = 1.0 - 2.5 * J2 * R_r2 * ( 7 * Z_r2 - 1 );
+  double Q3 = 1.0 - 2.5 * J2 * R_r2 * ( 7 * Z_r2 - 3 );
+  double Q5 = 1.0 - 2.5 * J2 * R_r2 * ( 7 * Z_r2 - 5 );
+  double XY = mu3_r5 * X * Y * Q1;
+  double XZ = mu3_r5 * X * Z * Q3;
+  double YZ = mu3_r5 * Y * Z * Q3;
 
-  // This function augments the two-body EOMs with a J2 term.
-  if ( ( component == 'x' ) || ( component == 'y' ) )
-  {
-    return ( 1.0 - 1.5 * m_J2 * pow( ( m_radius / dist ), 2.0 ) *
-           ( 5 * pow( ( state[2] / dist ), 2) - 1 ) );
-  }
-  else if ( component == 'z' )
+  // Partials of acceleration X component wrt state.
+  addPartial( partials, index, kAccX, kX,
+    -mu_r3 * J2xy + mu3_r5 * X * X * Q1 );
+  addPartial( partials, index, kAccX, kY, XY );
+  addPartial( partials, index, kAccX, kZ, XZ );
+
+  // Partials of acceleration Y component wrt state.
+  addPartial( partials, index, kAccY, kX, XY );
+  addPartial( partials, index, kAccY, kY,
+    -mu_r3 * J2xy + mu3_r5 * Y * Y * Q1 );
+  addPartial( partials, index, kAccY, kZ, YZ );
+
+  // Partials of acceleration Z component wrt state.
+  addPartial( partials, index, kAccZ, kX, XZ );
+  addPartial( partials, index, kAccZ, kY, YZ );
+  addPartial( partials, index, kAccZ, kZ,
+    -mu_r3 * J2z + mu3_r5 * Z * Z * Q5 );
+
+  // Partials wrt GM: the acceleration is linear in it.
+  addPartial( partials, index, kAccX, kMu, -kinematics.invR3 * X * J2xy );
+  addPartial( partials, index, kAccY, kMu, -kinematics.invR3 * Y * J2xy );
+  addPartial( partials, index, kAccZ, kMu, -kinematics.invR3 * Z * J2z );
+
+  // Partials wrt J2 and the radius, which enter as J2 * R^2.
+  double xyFactor = mu_r3 * ( 5 * Z_r2 - 1 );
+  double zFactor = mu_r3 * ( 5 * Z_r2 - 3 );
+  double J2Term = 1.5 * R_r2;
+  double radiusTerm = 3 * J2 * R * kinematics.invR2;
+  addPartial( partials, index, kAccX, kJ2, J2Term * xyFactor * X );
+  addPartial( partials, index, kAccY, kJ2, J2Term * xyFactor * Y );
+  addPartial( partials, index, kAccZ, kJ2, J2Term * zFactor * Z );
+  addPartial( partials, index, kAccX, kRadius, radiusTerm * xyFactor * X );
+  addPartial( partials, index, kAccY, kRadius, radiusTerm * xyFactor * Y );
+  addPartial( partials, index, kAccZ, kRadius, radiusTerm * zFactor * Z );
+}
+
+// Computes the acceleration as in getAcceleration() and its partials
+// by differentiating gravity() with Duals. The geometry is derived from
+// the position in the same order as Kinematics::update, so the values
+// match getAcceleration exactly.
+void
+GravityAction::
+evaluateAutomatic(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  Scalar position[3];
+  for ( int i = 0; i < 3; ++i )
   {
-    return ( 1.0 - 1.5 * m_J2 * pow( ( m_radius / dist ), 2 ) *
-           ( 5 * pow( ( state[2] / dist ), 2 ) - 3 ) );
+    position[i] = Scalar::variable( kinematics.position[i], i );
   }
-  else
+  Scalar r2 = position[0] * position[0] + position[1] * position[1] +
+              position[2] * position[2];
+  Scalar invR = 1.0 / sqrt( r2 );
+  Scalar invR2 = invR * invR;
+  Scalar invR3 = invR2 * invR;
+
+  Scalar a[3];
+  gravity( position, invR2, invR3, Scalar::variable( m_radius, 3 ),
+           Scalar::variable( m_mu, 4 ), Scalar::variable( m_J2, 5 ), a );
+
+  for ( int i = 0; i < 3; ++i )
   {
-     std::cout << "Error in request for J2 perturbation." << std::endl
-               << "Component " << component << " not recognized" << std::endl;
-     throw;
+    acceleration[i] += a[i].value;
+    for ( int j = 0; j < kNumVariables; ++j )
+    {
+      addPartial( partials, index, i, kVariables[j], a[i].d( j ) );
+    }
   }
 }
 
-double
+// Names of the agents this action owns partials for
+const std::vector< std::string >&
 GravityAction::
-getAgentPartial(
-    const std::string &top,
-    const std::string &bottom )
+getAgentsOwned() const
 {
-  // Form param search string
-  std::string partialRequest = top + " wrt " + bottom;
-
-  if( m_evaledPartials.find( partialRequest ) == m_evaledPartials.end() )
-  {
-    // If requested partial is not supported by this action, return 0
-    return 0.0;
-  }
-  return m_evaledPartials[ partialRequest ];
+  return m_agentsOwned;
 }
 
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+const GravityAction::OwnedAgent
+GravityAction::kVariables[ GravityAction::kNumVariables ] = {
+  kX, kY, kZ, kRadius, kMu, kJ2 };
+
+// Two-body acceleration augmented with the J2 perturbation
+template< typename T >
 void
 GravityAction::
-evalPartials( const std::vector< double > &state )
+gravity(
+    const T *position,
+    const T &invR2,
+    const T &invR3,
+    const T &radius,
+    const T &mu,
+    const T &J2,
+    T *acceleration )
 {
-  // Condense variable names to make following equations more legible
-  double r = sqrt( pow( state[0], 2 ) + pow( state[1], 2 ) +
-                   pow( state[2], 2 ) );
-  double R = m_radius;
-  double mu = m_mu;
-  double J2 = m_J2;
-  double X = state[0];
-  double Y = state[1];
-  double Z = state[2];
-  double r3 = pow( r, 3 );
-  double r5 = pow( r, 5 );
-  double R_r2 = pow( R / r, 2 );
-  double Z_r2 = pow( Z / r, 2 );
-
-  // Partials of acceleration X component wrt state.
-  m_evaledPartials[ "dX wrt X" ] = (
-    - mu / r3 * ( 1 - ( 3 / 2 ) * J2 * R_r2 * ( 5 * Z_r2 - 1.) ) +
-    3 * mu * pow( X, 2 ) / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 *
-    ( 7 * Z_r2 - 1 ) ) );
-  m_evaledPartials[ "dX wrt Y" ] =
-    3 * mu * X * Y / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 1 ) );
-  m_evaledPartials[ "dX wrt Z" ] =
-    3 * mu * X * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
+  T mu_r3 = mu * invR3;
+  T R_r2 = radius * radius * invR2;
+  T Z_r2 = position[2] * position[2] * invR2;
 
-  // Partials of acceleration Y component wrt state.
-  m_evaledPartials[ "dY wrt X" ] =
-    3 * mu * X * Y / r5 * ( 1 - ( 5  / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 1 ) );
-  m_evaledPartials[ "dY wrt Y" ] =
-    ( - mu / r3 * ( 1 - ( 3 / 2 ) * J2 * R_r2 * ( 5 * Z_r2 - 1 ) ) +
-    3 * mu * pow( Y, 2 ) / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 *
-    ( 7 * Z_r2 - 1 ) ) );
-  m_evaledPartials[ "dY wrt Z" ] =
-    3 * mu * Y * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
+  T J2xy = 1.0 - 1.5 * J2 * R_r2 * ( 5.0 * Z_r2 - 1.0 );
+  T J2z = 1.0 - 1.5 * J2 * R_r2 * ( 5.0 * Z_r2 - 3.0 );
 
-  // Partials of acceleration Z component wrt state.
-  m_evaledPartials[ "dZ wrt X" ] =
-    3 * mu * X * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
-  m_evaledPartials[ "dZ wrt Y" ] =
-    3 * mu * Y * Z / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 * ( 7 * Z_r2 - 3 ) );
-  m_evaledPartials[ "dZ wrt Z" ] =
-    ( - mu / r3 * ( 1 - ( 3 / 2 ) * J2 * R_r2 * ( 5 * Z_r2 - 3 ) ) +
-    3 * mu * pow( Z, 2 ) / r5 * ( 1 - ( 5 / 2 ) * J2 * R_r2 *
-    ( 7 * Z_r2 - 5 ) ) );
-
-  /// @todo implement remaining partials:
-  ///   - Cartesian state X, Y, Z, dX, dY, dZ components
-  ///   - Gravitational body radius
-  ///   - Gravitational body GM
-  ///   - Gravitational body J2 term
+  acceleration[0] = -mu_r3 * position[0] * J2xy;
+  acceleration[1] = -mu_r3 * position[1] * J2xy;
+  acceleration[2] = -mu_r3 * position[2] * J2z;
 }
-
@@ -15,10 +15,10 @@
 // C++ Standard Library
 #include <string>
 #include <vector>
-#include <map>
 
 // ekf Library
 #include <Action.hpp>
+#include <Dual.hpp>
 
 /// @brief Compute state accelerations and partial derivates due to
 /// the interaction of an agent and gravitational body.
@@ -34,6 +34,13 @@
 ///   - Gravitational body GM
 ///   - Gravitational body J2 term
 ///
+/// The acceleration is written once, in gravity(), as a template over
+/// the scalar type. getAcceleration calls it with doubles,
+/// getBatchAcceleration with SIMD lanes, and evaluateAutomatic with
+/// Duals seeded on X, Y, Z, radius, mu and J2, which yields the
+/// partials. evaluate has the same partials written out by hand, at a
+/// fraction of the cost.
+///
 class GravityAction : public Action
 {
  public:
@@ -44,16 +51,42 @@ class GravityAction : public Action
  ~GravityAction() override;
 
   // Computes the acceleration due to this action and adds it to the
-  // passed in vector "acceleration".
-  void getAcceleration( std::vector< double > &acceleration,
-                        const std::vector< double > &state ) const override;
-
-  // Computes the partial derivative of the acceleration terms and
-  // owned parameters
-  void getPartials( std::vector< double > &partials,
-                    const std::vector< double > &state,
-                    const std::vector< std::string >  &activeAgents ) override;
+  // passed in array "acceleration".
+  void getAcceleration( double *acceleration,
+                        const Kinematics &kinematics ) const override;
+
+  // Computes the accelerations of a group of agents, one per lane
+  void getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const override;
+
+  // Computes the acceleration and the partial derivative of the
+  // acceleration terms wrt the owned agents
+  void evaluate( double *acceleration,
+                 double *partials,
+                 const Kinematics &kinematics,
+                 const AgentIndex &index ) const override;
+
+  // Computes the same as evaluate, differentiating the acceleration
+  // with Duals
+  void evaluateAutomatic( double *acceleration,
+                          double *partials,
+                          const Kinematics &kinematics,
+                          const AgentIndex &index ) const override;
+
+  // Names of the agents this action owns partials for
+  const std::vector< std::string >& getAgentsOwned() const override;
+
  private:
+  // Position of each agent in m_agentsOwned
+  enum OwnedAgent { kX, kY, kZ, kDX, kDY, kDZ, kRadius, kMu, kJ2 };
+
+  // Owned agent of each Dual variable of evaluateAutomatic(), the
+  // ones the acceleration depends on
+  typedef Dual< 6 > Scalar;
+  static const int kNumVariables = 6;
+  static const OwnedAgent kVariables[ kNumVariables ];
+
   std::string m_name;
   double m_radius;
   double m_mu;
@@ -62,13 +95,14 @@ class GravityAction : public Action
   /// particular gravitational body
   std::vector< std::string > m_agentsOwned = { "X", "Y", "Z", "dX", "dY", "dZ",
                                                "radius", "mu", "J2" };
-  std::map< std::string, double > m_evaledPartials;
-
-  double accJ2( const std::vector< double > &state,
-                const char component ) const;
 
-  double getAgentPartial( const std::string &top, const std::string &bottom );
-  void evalPartials( const std::vector< double > &state );
+  // Acceleration at "position" with the given inverse powers of its
+  // distance from the body center and field parameters, for any scalar
+  // type T
+  template< typename T >
+  static void gravity( const T *position, const T &invR2, const T &invR3,
+                       const T &radius, const T &mu, const T &J2,
+                       T *acceleration );
 };
 
 #endif // EKF_GRAVITYACTION_HEADER_GUARD
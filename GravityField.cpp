@@ -0,0 +1,324 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    GravityField.cpp
+/// @brief   Spherical harmonic gravity field coefficients, read from a
+///          memory-mapped binary coefficient file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ekf Library
+#include <GravityField.hpp>
+
+namespace
+{
+
+// File header, followed by one GravityCoefficients per degree and order
+struct GravityHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t degree;
+  double mu;
+  double radius;
+};
+
+struct GravityCoefficients
+{
+  double C;
+  double S;
+};
+
+const char kMagic[8] = { 'E', 'K', 'F', 'G', 'R', 'A', 'V', '\0' };
+const std::uint32_t kVersion = 1;
+
+// Largest degree a file may hold, so that index() of the harmonics two
+// degrees beyond it stays within an int
+const std::uint32_t kMaxFileDegree = std::numeric_limits< int >::max() - 3;
+
+// Parse a number of an ICGEM file, which may use a Fortran D exponent
+double
+parseGfcNumber( std::string text )
+{
+  std::replace( text.begin(), text.end(), 'D', 'E' );
+  std::replace( text.begin(), text.end(), 'd', 'e' );
+  char *end;
+  double value = std::strtod( text.c_str(), &end );
+  if ( ( end == text.c_str() ) || ( *end != '\0' ) )
+  {
+    throw std::runtime_error( "GravityField: bad number " + text );
+  }
+  return value;
+}
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, no field
+GravityField::
+GravityField()
+    : m_degree( -1 ),
+      m_mu( 0.0 ),
+      m_radius( 0.0 ),
+      m_C(),
+      m_S(),
+      m_amplitude()
+{
+}
+
+// Load a coefficient file
+GravityField::
+GravityField(
+    const std::string &path,
+    int maxDegree )
+    : m_degree( -1 ),
+      m_mu( 0.0 ),
+      m_radius( 0.0 ),
+      m_C(),
+      m_S(),
+      m_amplitude()
+{
+  if ( maxDegree < kAllDegrees )
+  {
+    throw std::invalid_argument( "GravityField: degree " +
+                                 std::to_string( maxDegree ) +
+                                 " out of range" );
+  }
+
+  int fd = open( path.c_str(), O_RDONLY );
+  if ( fd < 0 )
+  {
+    throw std::runtime_error( "GravityField: cannot open " + path );
+  }
+  struct stat info;
+  if ( ( fstat( fd, &info ) != 0 ) ||
+       ( std::size_t( info.st_size ) < sizeof( GravityHeader ) ) )
+  {
+    close( fd );
+    throw std::runtime_error( "GravityField: " + path +
+                              " is not a gravity field file" );
+  }
+  std::size_t mapSize = info.st_size;
+  void *map = mmap( nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( map == MAP_FAILED )
+  {
+    throw std::runtime_error( "GravityField: cannot map " + path );
+  }
+
+  // The degree is bounded before it is used as an int, and the number
+  // of coefficients by the mapping before it is multiplied, so a
+  // corrupt degree cannot wrap around to a matching size
+  const GravityHeader *header = static_cast< const GravityHeader* >( map );
+  std::size_t maxCount =
+    ( mapSize - sizeof( GravityHeader ) ) / sizeof( GravityCoefficients );
+  if ( ( std::memcmp( header->magic, kMagic, sizeof( kMagic ) ) != 0 ) ||
+       ( header->version != kVersion ) ||
+       ( header->degree > kMaxFileDegree ) ||
+       ( index( int( header->degree ) + 1, 0 ) > maxCount ) ||
+       ( sizeof( GravityHeader ) + index( int( header->degree ) + 1, 0 ) *
+         sizeof( GravityCoefficients ) != mapSize ) )
+  {
+    munmap( map, mapSize );
+    throw std::runtime_error( "GravityField: " + path +
+                              " is not a gravity field file" );
+  }
+  const GravityCoefficients *normalized =
+    reinterpret_cast< const GravityCoefficients* >( header + 1 );
+  m_degree = int( header->degree );
+  if ( maxDegree != kAllDegrees )
+  {
+    m_degree = std::min( m_degree, maxDegree );
+  }
+  m_mu = header->mu;
+  m_radius = header->radius;
+
+  std::size_t size = index( m_degree + 1, 0 );
+  m_C.resize( size );
+  m_S.resize( size );
+  m_amplitude.assign( m_degree + 1, 0.0 );
+  for ( int n = 0; n <= m_degree; ++n )
+  {
+    double sumSquares = 0.0;
+    for ( int m = 0; m <= n; ++m )
+    {
+      const GravityCoefficients &c = normalized[ index( n, m ) ];
+      m_C[ index( n, m ) ] = c.C;
+      m_S[ index( n, m ) ] = c.S;
+      sumSquares += c.C * c.C + c.S * c.S;
+    }
+    m_amplitude[n] = std::sqrt( sumSquares );
+  }
+
+  munmap( map, mapSize );
+}
+
+// Default Destructor
+GravityField::
+~GravityField()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Write a coefficient file
+void
+GravityField::
+write(
+    const std::string &path,
+    double mu,
+    double radius,
+    int degree,
+    const std::vector< double > &C,
+    const std::vector< double > &S )
+{
+  std::size_t size = index( degree + 1, 0 );
+  if ( ( degree < 0 ) || ( C.size() != size ) || ( S.size() != size ) )
+  {
+    throw std::invalid_argument(
+      "GravityField::write: coefficients do not match the degree" );
+  }
+
+  GravityHeader header;
+  std::memcpy( header.magic, kMagic, sizeof( kMagic ) );
+  header.version = kVersion;
+  header.degree = degree;
+  header.mu = mu;
+  header.radius = radius;
+
+  std::vector< GravityCoefficients > coefficients( size );
+  for ( std::size_t i = 0; i < size; ++i )
+  {
+    coefficients[i].C = C[i];
+    coefficients[i].S = S[i];
+  }
+
+  std::ofstream file( path.c_str(), std::ios::binary | std::ios::trunc );
+  file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+  file.write( reinterpret_cast< const char* >( coefficients.data() ),
+              size * sizeof( GravityCoefficients ) );
+  if ( !file )
+  {
+    throw std::runtime_error( "GravityField: cannot write " + path );
+  }
+}
+
+// Convert an ICGEM .gfc file to a coefficient file. The header, up to
+// "end_of_head", gives GM, the radius, the degree and the
+// normalization; each "gfc n m C S ..." line after it a coefficient.
+int
+GravityField::
+convertGfc(
+    const std::string &gfcPath,
+    const std::string &path,
+    int maxDegree )
+{
+  std::ifstream gfc( gfcPath.c_str() );
+  if ( !gfc )
+  {
+    throw std::runtime_error( "GravityField: cannot open " + gfcPath );
+  }
+
+  double mu = 0.0;
+  double radius = 0.0;
+  int degree = -1;
+  std::string line;
+  bool inHeader = true;
+  std::vector< double > C, S;
+  while ( std::getline( gfc, line ) )
+  {
+    std::istringstream fields( line );
+    std::string key;
+    if ( !( fields >> key ) )
+    {
+      continue;
+    }
+
+    if ( inHeader )
+    {
+      std::string value;
+      fields >> value;
+      if ( key == "end_of_head" )
+      {
+        if ( ( mu == 0.0 ) || ( radius == 0.0 ) || ( degree < 0 ) )
+        {
+          throw std::runtime_error( "GravityField: " + gfcPath +
+                                    " has an incomplete header" );
+        }
+        if ( maxDegree != kAllDegrees )
+        {
+          degree = std::min( degree, maxDegree );
+        }
+        C.assign( index( degree + 1, 0 ), 0.0 );
+        S.assign( index( degree + 1, 0 ), 0.0 );
+        inHeader = false;
+      }
+      else if ( key == "earth_gravity_constant" )
+      {
+        mu = parseGfcNumber( value );
+      }
+      else if ( key == "radius" )
+      {
+        radius = parseGfcNumber( value );
+      }
+      else if ( key == "max_degree" )
+      {
+        degree = std::atoi( value.c_str() );
+      }
+      else if ( ( key == "norm" ) && ( value != "fully_normalized" ) )
+      {
+        throw std::runtime_error( "GravityField: " + gfcPath +
+                                  " is not fully normalized" );
+      }
+      continue;
+    }
+
+    if ( key != "gfc" )
+    {
+      continue;
+    }
+    int n, m;
+    std::string c, s;
+    if ( !( fields >> n >> m >> c >> s ) || ( m < 0 ) || ( m > n ) )
+    {
+      throw std::runtime_error( "GravityField: bad line in " + gfcPath +
+                                ": " + line );
+    }
+    if ( n <= degree )
+    {
+      C[ index( n, m ) ] = parseGfcNumber( c );
+      S[ index( n, m ) ] = parseGfcNumber( s );
+    }
+  }
+  if ( inHeader )
+  {
+    throw std::runtime_error( "GravityField: " + gfcPath +
+                              " has no end_of_head" );
+  }
+
+  write( path, mu, radius, degree, C, S );
+  return degree;
+}
@@ -0,0 +1,91 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    GravityField.hpp
+/// @brief   Spherical harmonic gravity field coefficients, read from a
+///          memory-mapped binary coefficient file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_GRAVITYFIELD_HEADER_GUARD
+#define EKF_GRAVITYFIELD_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief The coefficients of a spherical harmonic gravity field.
+///
+/// The coefficient file is a fixed header, holding GM, the reference
+/// radius and the degree, followed by the fully normalized C_nm, S_nm
+/// pairs for n = 0 .. degree, m = 0 .. n, in the native byte order. The
+/// file is mapped once, when the field is loaded, and the coefficients
+/// are kept fully normalized, as SphericalHarmonicAction sums them
+/// against normalized harmonics. A field is meant to be loaded once and
+/// shared between actions through a shared_ptr.
+///
+/// write() and convertGfc() produce coefficient files, the latter from
+/// the ICGEM .gfc format the usual Earth models are distributed in.
+///
+class GravityField
+{
+ public:
+  // Degree limit that keeps every degree of a file or model
+  static const int kAllDegrees = -1;
+
+  GravityField();
+  // Load the coefficients of the file at "path" up to degree
+  // "maxDegree", or the degree of the file if lower or "maxDegree" is
+  // kAllDegrees. Throws std::runtime_error if it cannot be opened or is
+  // not a coefficient file, and std::invalid_argument if "maxDegree" is
+  // below kAllDegrees.
+  explicit GravityField( const std::string &path,
+                         int maxDegree = kAllDegrees );
+ ~GravityField();
+
+  int getDegree() const { return m_degree; }
+  double getMu() const { return m_mu; }
+  double getRadius() const { return m_radius; }
+
+  // Fully normalized coefficients, by index( n, m )
+  const std::vector< double >& getC() const { return m_C; }
+  const std::vector< double >& getS() const { return m_S; }
+
+  // Root sum square of the normalized coefficients of degree n, the
+  // size of its contribution to the potential at the reference radius
+  // relative to the central term
+  double getDegreeAmplitude( int n ) const { return m_amplitude[n]; }
+
+  // Position of degree n, order m in the triangular coefficient arrays
+  static std::size_t index( int n, int m )
+    { return std::size_t( n ) * ( n + 1 ) / 2 + m; }
+
+  // Write a coefficient file at "path" with the fully normalized
+  // coefficients "C" and "S", by index( n, m ), up to "degree". Throws
+  // std::invalid_argument if they do not hold index( degree + 1, 0 )
+  // elements.
+  static void write( const std::string &path, double mu, double radius,
+                     int degree, const std::vector< double > &C,
+                     const std::vector< double > &S );
+
+  // Convert the ICGEM .gfc file at "gfcPath" to a coefficient file at
+  // "path", up to degree "maxDegree" or every degree for kAllDegrees,
+  // and return the degree written. Only the static "gfc" lines of fully
+  // normalized models are read.
+  static int convertGfc( const std::string &gfcPath,
+                         const std::string &path,
+                         int maxDegree = kAllDegrees );
+
+ private:
+  int m_degree;
+  double m_mu;
+  double m_radius;
+  std::vector< double > m_C;
+  std::vector< double > m_S;
+  std::vector< double > m_amplitude;
+};
+
+#endif // EKF_GRAVITYFIELD_HEADER_GUARD
@@ -0,0 +1,97 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Kinematics.hpp
+/// @brief   Geometry of an agent at one integration stage, shared by
+///          all Actions.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_KINEMATICS_HEADER_GUARD
+#define EKF_KINEMATICS_HEADER_GUARD
+
+// C++ Standard Library
+#include <cmath>
+
+/// @brief Geometry of an agent at one integration stage.
+///
+/// OdeintHelper fills this in once per right hand side evaluation and
+/// passes it to every Action, so terms needed by several Actions, such
+/// as the distance from the body center, are not derived again by each
+/// of them.
+///
+/// The body rotates about the inertial Z axis at a rate given by the
+/// Actions (see Action::getRotationRate). The body-relative velocity
+/// is the inertial velocity minus w x r, expressed in the inertial
+/// frame.
+///
+struct Kinematics
+{
+  // Integration time
+  double time;
+
+  // Inertial position X, Y, Z and velocity dX, dY, dZ
+  double position[3];
+  double velocity[3];
+
+  // Distance from the body center, its square, and inverse powers
+  double r;
+  double r2;
+  double invR;
+  double invR2;
+  double invR3;
+  double invR5;
+
+  // Body rotation rate about Z, and the velocity relative to the
+  // rotating body with its magnitude
+  double rotation;
+  double bodyVelocity[3];
+  double bodySpeed;
+
+  Kinematics( double rotationRate = 0.0 )
+      : time( 0.0 ),
+        position(),
+        velocity(),
+        r( 0.0 ),
+        r2( 0.0 ),
+        invR( 0.0 ),
+        invR2( 0.0 ),
+        invR3( 0.0 ),
+        invR5( 0.0 ),
+        rotation( rotationRate ),
+        bodyVelocity(),
+        bodySpeed( 0.0 )
+  {
+  }
+
+  // Derive the geometry from the X, Y, Z, dX, dY, dZ components of
+  // "state" at time "t".
+  void update( const double *state, double t )
+  {
+    time = t;
+    for ( int i = 0; i < 3; ++i )
+    {
+      position[i] = state[i];
+      velocity[i] = state[3 + i];
+    }
+
+    r2 = position[0] * position[0] + position[1] * position[1] +
+         position[2] * position[2];
+    r = std::sqrt( r2 );
+    invR = 1.0 / r;
+    invR2 = invR * invR;
+    invR3 = invR2 * invR;
+    invR5 = invR3 * invR2;
+
+    bodyVelocity[0] = velocity[0] + rotation * position[1];
+    bodyVelocity[1] = velocity[1] - rotation * position[0];
+    bodyVelocity[2] = velocity[2];
+    bodySpeed = std::sqrt( bodyVelocity[0] * bodyVelocity[0] +
+                           bodyVelocity[1] * bodyVelocity[1] +
+                           bodyVelocity[2] * bodyVelocity[2] );
+  }
+};
+
+#endif // EKF_KINEMATICS_HEADER_GUARD
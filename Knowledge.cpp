@@ -1,31 +1,162 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
 
+///
+/// @file    Knowledge.cpp
+/// @brief   Estimate an agent's state and parameters with an extended
+///          Kalman filter.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <stdexcept>
+
+// ekf Library
 #include <Knowledge.hpp>
 
-//=============================================================================  
-//=============================================================================  
-// CONSTRUCTORS / DESCTRUCTOR   
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
 
-// Default Constructor
+// Constructor from the reference trajectory and initial covariance.
+// Only the current state and partials of the Motion are used, so
+// nothing is logged.
 Knowledge::
-Knowledge()
-   : m_agentCovariance() 
+Knowledge(
+    const Motion &motion,
+    const std::vector< double > &covariance )
+    : m_motion( motion ),
+      m_estimate( motion.getActiveAgents().size(), 0.0 ),
+      m_covariance( motion.getActiveAgents().size(), covariance ),
+      m_processNoise(),
+      m_stateAndPartials( 6 + m_estimate.size() * m_estimate.size(), 0.0 ),
+      m_noise( motion.getActiveAgents().size(), 0.0 ),
+      m_gain( motion.getActiveAgents().size(), 0.0 )
 {
+  m_motion.setLogPolicy( Motion::kLogNothing );
+  m_motion.getStateAndPartials( m_motion.getTime(),
+                                m_stateAndPartials.data() );
+  std::copy( m_stateAndPartials.begin(), m_stateAndPartials.begin() + 6,
+             m_estimate.begin() );
 }
 
+// Default Destructor
 Knowledge::
-~Knowledge(){}
+~Knowledge()
+{
+}
 
-//=============================================================================  
-//=============================================================================  
-// PUBLIC MEMBERS      
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
 
+// Propagate the estimate and covariance to time t. The reference
+// trajectory restarts from the estimated state, with the parameters
+// the Actions were built with, so the predicted state is the reference
+// state plus the effect of the parameter corrections through the STM.
 void
 Knowledge::
 step( double t )
 {
+  const int n = m_estimate.size();
+  double t0 = m_motion.getTime();
+
+  m_motion.setState( m_estimate );
+  m_motion.stepTo( t );
+
+  m_motion.getStateAndPartials( m_motion.getTime(),
+                                m_stateAndPartials.data() );
+  const double *stm = m_stateAndPartials.data() + 6;
+  for ( int i = 0; i < 6; ++i )
+  {
+    m_estimate[i] = m_stateAndPartials[i];
+    for ( int j = 6; j < n; ++j )
+    {
+      m_estimate[i] += stm[ i * n + j ] * m_estimate[j];
+    }
+  }
+
+  if ( m_processNoise.empty() )
+  {
+    m_covariance.propagate( stm, nullptr );
+  }
+  else
+  {
+    for ( int i = 0; i < n; ++i )
+    {
+      m_noise[i] = m_processNoise[i] * ( t - t0 );
+    }
+    m_covariance.propagate( stm, m_noise.data() );
+  }
+}
+
+// Scalar measurement update
+double
+Knowledge::
+update(
+    double residual,
+    const std::vector< double > &partials,
+    double variance )
+{
+  if ( partials.size() != m_estimate.size() )
+  {
+    throw std::invalid_argument(
+      "Knowledge::update: need one partial per estimated agent" );
+  }
+
+  double innovation = m_covariance.update( partials.data(), variance,
+                                           m_gain.data() );
+  for ( std::size_t i = 0; i < m_estimate.size(); ++i )
+  {
+    m_estimate[i] += m_gain[i] * residual;
+  }
+  return innovation;
+}
 
+// Set the process noise variance rates
+void
+Knowledge::
+setProcessNoise( const std::vector< double > &rates )
+{
+  if ( !rates.empty() && ( rates.size() != m_estimate.size() ) )
+  {
+    throw std::invalid_argument(
+      "Knowledge::setProcessNoise: need one rate per estimated agent" );
+  }
+  m_processNoise = rates;
 }
 
-//=============================================================================  
-//=============================================================================  
-// PRIVATE MEMBERS      
+// Return the current time
+double
+Knowledge::
+getTime() const
+{
+  return m_motion.getTime();
+}
+
+// Return the current estimate
+const std::vector< double >&
+Knowledge::
+getEstimate() const
+{
+  return m_estimate;
+}
+
+// Return the current covariance
+std::vector< double >
+Knowledge::
+getCovariance() const
+{
+  std::vector< double > covariance( m_estimate.size() * m_estimate.size() );
+  m_covariance.getCovariance( covariance.data() );
+  return covariance;
+}
+
+// Return the reference trajectory
+const Motion&
+Knowledge::
+getMotion() const
+{
+  return m_motion;
+}
@@ -1,21 +1,81 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
 
-#include <Eigen/Dense>
-#include <AgentGroup.hpp>
+///
+/// @file    Knowledge.hpp
+/// @brief   Estimate an agent's state and parameters with an extended
+///          Kalman filter.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
 
+#pragma once
+#ifndef EKF_KNOWLEDGE_HEADER_GUARD
+#define EKF_KNOWLEDGE_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// ekf Library
+#include <Motion.hpp>
+#include <UDCovariance.hpp>
+
+/// @brief Estimate an agent's state and parameters with an extended
+/// Kalman filter.
+///
+/// The estimate has one element per active agent of the Motion: the
+/// six X, Y, Z, dX, dY, dZ state components, then corrections to the
+/// parameters ( mu, J2, Cd, station coordinates ... ) relative to the
+/// values the Actions were built with. The Motion is the reference
+/// trajectory. Each step restarts it from the estimated state, so its
+/// STM is the transition matrix of that step, and the parameter
+/// corrections are carried into the predicted state through the
+/// parameter columns of the STM.
+///
+/// The covariance is kept as UDCovariance factors. Measurements are
+/// applied one scalar at a time with update(). Neither step() nor
+/// update() allocate once the reference trajectory has taken its first
+/// step.
+///
 class Knowledge
 {
+ public:
+  // Start from the current state of "motion", with the row-major
+  // covariance of all its active agents
+  Knowledge( const Motion &motion, const std::vector< double > &covariance );
+ ~Knowledge();
 
-   public:
-      Knowledge();
-      ~Knowledge();
+  // Time update to time t
+  void step( double t );
 
-      void step( double t );
+  // Measurement update with the measurement "residual" ( observed minus
+  // computed from getEstimate() ), its partials with respect to the
+  // estimate and its noise variance. Returns the innovation variance.
+  double update( double residual, const std::vector< double > &partials,
+                 double variance );
 
-   private:
-
-      AgentGroup m_agents;
-      Eigen::MatrixXd m_agentCovariance;
-      
+  // Process noise as variance rates per second for each element of the
+  // estimate, added as a diagonal Q = rates * dt on each step
+  void setProcessNoise( const std::vector< double > &rates );
 
+  // Current time
+  double getTime() const;
+  // Current estimate
+  const std::vector< double >& getEstimate() const;
+  // Current row-major covariance
+  std::vector< double > getCovariance() const;
+  // The reference trajectory
+  const Motion& getMotion() const;
 
+ private:
+  Motion m_motion;
+  std::vector< double > m_estimate;
+  UDCovariance m_covariance;
+  std::vector< double > m_processNoise;
+  // Workspaces for the state and STM read back from the Motion, the
+  // process noise of a step and the gain of an update
+  std::vector< double > m_stateAndPartials;
+  std::vector< double > m_noise;
+  std::vector< double > m_gain;
 };
+
+#endif // EKF_KNOWLEDGE_HEADER_GUARD
@@ -8,7 +8,14 @@
 ///
 
 // C++ Standard Library
+#include <algorithm>
 #include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 
 // boost Library
 #include <boost/numeric/odeint.hpp>
@@ -16,25 +23,6 @@
 // ekf Library
 #include <Motion.hpp>
 
-//=====================================================================
-//=====================================================================
-// This struct is used to "observe" the integrator and log states.
-struct log_state
-{
-  std::map< double, std::vector< double > >* m_pastStates;
-
-  // Constructor
-  log_state(  std::map< double, std::vector< double > >& pastStates )
-      : m_pastStates( &pastStates ) { }
-
-  // Takes in state and time from odeint integrate function and logs
-  // them in the m_pastStates map.
-  void operator()( const std::vector< double >& x, double t )
-  {
-    m_pastStates->insert( std::pair<double, std::vector< double > >(t,x) );
-  }
-};
-
 //=====================================================================
 //=====================================================================
 // CONSTRUCTORS / DESCTRUCTOR
@@ -43,14 +31,35 @@ struct log_state
 Motion::
 Motion()
     : m_time(),
-      m_state(),
-      m_partials(),
+      m_stateAndPartials( 6, 0.0 ),
+      m_rates(),
+      m_ratesValid( false ),
       m_activeAgents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
       m_step(),
+      m_dt(),
+      m_integrator( kDopri5 ),
+      m_stepper(),
+      m_fehlbergStepper(),
+      m_bulirschStoer(),
+      m_adamsStepper(),
+      m_gaussJackson(),
+      m_gridPoint( 0 ),
+      m_stats(),
+      m_errorControl( kControlAll ),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_errorWeights(),
       m_actions(),
       m_helper( m_actions, m_activeAgents ),
-      m_pastStates()
+      m_trajectory(),
+      m_logPolicy( kLogEveryStep ),
+      m_logInterval( 1 ),
+      m_logEpochs()
 {
+  initializePartials( m_activeAgents );
+  resetTrajectory();
+  resetStepper();
+  m_helper.activateAgents();
 }
 
 // Constructor with set of intitial conditions
@@ -59,15 +68,146 @@ Motion(
     const std::vector< double >& ic,
     double step )
     : m_time( 0 ),
-      m_state( ic ),
-      m_partials(),
+      m_stateAndPartials( ic.begin(), ic.begin() + 6 ),
+      m_rates(),
+      m_ratesValid( false ),
       m_activeAgents( { "X", "Y", "Z", "dX", "dY", "dZ" } ),
       m_step( step ),
+      m_dt( step ),
+      m_integrator( kDopri5 ),
+      m_stepper(),
+      m_fehlbergStepper(),
+      m_bulirschStoer(),
+      m_adamsStepper(),
+      m_gaussJackson(),
+      m_gridPoint( 0 ),
+      m_stats(),
+      m_errorControl( kControlAll ),
+      m_absTol( 1.E-10 ),
+      m_relTol( 1.E-9 ),
+      m_errorWeights(),
       m_actions(),
       m_helper( m_actions, m_activeAgents ),
-      m_pastStates()
+      m_trajectory(),
+      m_logPolicy( kLogEveryStep ),
+      m_logInterval( 1 ),
+      m_logEpochs()
 {
   initializePartials( m_activeAgents );
+  resetTrajectory();
+  resetStepper();
+  m_helper.activateAgents();
+}
+
+// Copy Constructor
+Motion::
+Motion( const Motion &other )
+    : m_time( other.m_time ),
+      m_stateAndPartials( other.m_stateAndPartials ),
+      m_rates( other.m_rates ),
+      m_ratesValid( other.m_ratesValid ),
+      m_activeAgents( other.m_activeAgents ),
+      m_step( other.m_step ),
+      m_dt( other.m_dt ),
+      m_integrator( other.m_integrator ),
+      m_stepper( other.m_stepper ),
+      m_fehlbergStepper( other.m_fehlbergStepper ),
+      m_bulirschStoer( other.m_bulirschStoer ),
+      m_adamsStepper( other.m_adamsStepper ),
+      m_gaussJackson( other.m_gaussJackson ),
+      m_gridPoint( other.m_gridPoint ),
+      m_stats( other.m_stats ),
+      m_errorControl( other.m_errorControl ),
+      m_absTol( other.m_absTol ),
+      m_relTol( other.m_relTol ),
+      m_errorWeights( other.m_errorWeights ),
+      m_actions( other.m_actions ),
+      m_helper( other.m_helper, m_actions, m_activeAgents ),
+      m_trajectory( other.m_trajectory ),
+      m_logPolicy( other.m_logPolicy ),
+      m_logInterval( other.m_logInterval ),
+      m_logEpochs( other.m_logEpochs )
+{
+}
+
+// Move Constructor
+Motion::
+Motion( Motion &&other )
+    : m_time( other.m_time ),
+      m_stateAndPartials( std::move( other.m_stateAndPartials ) ),
+      m_rates( std::move( other.m_rates ) ),
+      m_ratesValid( other.m_ratesValid ),
+      m_activeAgents( std::move( other.m_activeAgents ) ),
+      m_step( other.m_step ),
+      m_dt( other.m_dt ),
+      m_integrator( other.m_integrator ),
+      m_stepper( std::move( other.m_stepper ) ),
+      m_fehlbergStepper( std::move( other.m_fehlbergStepper ) ),
+      m_bulirschStoer( std::move( other.m_bulirschStoer ) ),
+      m_adamsStepper( std::move( other.m_adamsStepper ) ),
+      m_gaussJackson( std::move( other.m_gaussJackson ) ),
+      m_gridPoint( other.m_gridPoint ),
+      m_stats( other.m_stats ),
+      m_errorControl( other.m_errorControl ),
+      m_absTol( other.m_absTol ),
+      m_relTol( other.m_relTol ),
+      m_errorWeights( std::move( other.m_errorWeights ) ),
+      m_actions( std::move( other.m_actions ) ),
+      m_helper( other.m_helper, m_actions, m_activeAgents ),
+      m_trajectory( std::move( other.m_trajectory ) ),
+      m_logPolicy( other.m_logPolicy ),
+      m_logInterval( other.m_logInterval ),
+      m_logEpochs( std::move( other.m_logEpochs ) )
+{
+}
+
+// Copy Assignment
+Motion&
+Motion::
+operator=( const Motion &other )
+{
+  if ( this != &other )
+  {
+    Motion copy( other );
+    *this = std::move( copy );
+  }
+  return *this;
+}
+
+// Move Assignment
+Motion&
+Motion::
+operator=( Motion &&other )
+{
+  if ( this != &other )
+  {
+    m_time = other.m_time;
+    m_stateAndPartials = std::move( other.m_stateAndPartials );
+    m_rates = std::move( other.m_rates );
+    m_ratesValid = other.m_ratesValid;
+    m_activeAgents = std::move( other.m_activeAgents );
+    m_step = other.m_step;
+    m_dt = other.m_dt;
+    m_integrator = other.m_integrator;
+    m_stepper = std::move( other.m_stepper );
+    m_fehlbergStepper = std::move( other.m_fehlbergStepper );
+    m_bulirschStoer = std::move( other.m_bulirschStoer );
+    m_adamsStepper = std::move( other.m_adamsStepper );
+    m_gaussJackson = std::move( other.m_gaussJackson );
+    m_gridPoint = other.m_gridPoint;
+    m_stats = other.m_stats;
+    m_errorControl = other.m_errorControl;
+    m_absTol = other.m_absTol;
+    m_relTol = other.m_relTol;
+    m_errorWeights = std::move( other.m_errorWeights );
+    m_actions = std::move( other.m_actions );
+    m_helper = OdeintHelper( other.m_helper, m_actions, m_activeAgents );
+    m_trajectory = std::move( other.m_trajectory );
+    m_logPolicy = other.m_logPolicy;
+    m_logInterval = other.m_logInterval;
+    m_logEpochs = std::move( other.m_logEpochs );
+  }
+  return *this;
 }
 
 // Default Destructor
@@ -84,7 +224,12 @@ Motion::
 addAction( std::shared_ptr< Action > a )
 {
   m_actions.push_back( a );
-  m_helper.howManyActions();
+  m_helper.activateAgents();
+
+  // The dynamics changed, so the derivative at m_time is stale, and so
+  // is the history of a multistep integrator
+  m_ratesValid = false;
+  resetStepper();
 }
 
 // Activate partials tracking for named agents
@@ -97,48 +242,331 @@ activateAgents( const std::vector< std::string > agentNames )
     m_activeAgents.push_back( a );
   }
 
-  // Re-initialize the partials to make room for new agents
+  // Re-initialize the partials to make room for new agents. The logged
+  // history has the old STM layout, so it is dropped.
   initializePartials( m_activeAgents );
+  resetTrajectory();
+  m_ratesValid = false;
+  resetStepper();
+
+  // Resolve agent names to partials block positions and size the
+  // integration workspaces once, up front
+  m_helper.activateAgents();
 }
 
-// Step the integration of Motion object to time t
+// Names of the active agents
+const std::vector< std::string >&
+Motion::
+getActiveAgents() const
+{
+  return m_activeAgents;
+}
+
+// Replace the current state, e.g. with a filter's estimate. The
+// partials restart from the identity, so they are then dX(t)/dX(t_set),
+// and the history no longer joins up with what follows, so it is
+// dropped.
 void
 Motion::
-stepTo( double t )
+setState( const std::vector< double > &state )
 {
-  // Set up state initial condition
-  int partialsSize = m_partials.size();
-  std::vector< double > stateAndPartials( 6 + partialsSize, 0.0 );
-  for ( int i = 0; i < 6 ; ++i )
+  if ( state.size() < 6 )
   {
-    stateAndPartials[i] = m_state[i];
+    throw std::invalid_argument( "Motion::setState: need six states" );
   }
-  for ( int i = 0; i < partialsSize; ++i )
+  std::copy( state.begin(), state.begin() + 6, m_stateAndPartials.begin() );
+  initializePartials( m_activeAgents );
+  resetTrajectory();
+  m_ratesValid = false;
+
+  // The Runge-Kutta steppers keep nothing of the steps before but their
+  // workspaces, so they are kept, and a filter restarting the state
+  // every step does not allocate. The integrators with a history of
+  // their own are rebuilt.
+  if ( ( m_integrator != kDopri5 ) &&
+       ( m_integrator != kRungeKuttaFehlberg78 ) )
   {
-    stateAndPartials[6 + i] = m_partials[i];
+    resetStepper();
   }
+}
 
-  using namespace boost::numeric::odeint;
+// Step the integration of Motion object to time t. Accepted steps are
+// logged together with their time derivative, as chosen by the log
+// policy, which is what getState() and getStatePartials() interpolate
+// between.
+//
+// The stepper, the combined state and STM, its derivative and the
+// adapted step size all persist across calls, so stepping to t in many
+// small increments integrates the same way as a single call would,
+// apart from the steps clipped to land on each increment.
+void
+Motion::
+stepTo( double t )
+{
+  if ( t < m_time )
+  {
+    throw std::invalid_argument( "Motion::stepTo: cannot step backwards" );
+  }
 
-  typedef runge_kutta_dopri5< std::vector< double > > rkStepper;
+  // Output epochs still ahead of us
+  std::vector< double >::const_iterator nextEpoch =
+    std::lower_bound( m_logEpochs.begin(), m_logEpochs.end(), m_time );
+  bool atEpochs = ( m_logPolicy == kLogAtEpochs );
+  unsigned long rhsCalls = m_helper.getNumCalls();
+  unsigned long jacobianCalls = m_helper.getNumJacobians();
 
-  // Integrate from current time to time t
-  integrate_const( make_controlled( 1.E-10, 1.E-9, rkStepper() ),
-                   m_helper, stateAndPartials, m_time, t, m_step,
-                   log_state( m_pastStates ) );
+  // The Runge-Kutta and extrapolation integrators start each step from
+  // the derivative at its start. dopri5 is FSAL, so each accepted step
+  // hands back the derivative at its end for free, and it only has to
+  // be evaluated here after the state or the dynamics were changed from
+  // outside. Adams-Bashforth-Moulton and Gauss-Jackson keep a history
+  // of derivatives of their own.
+  double time = m_time;
 
-  // Update state, partials, and time
-  for ( int i = 0; i < 6 ; ++i )
+  // With a frozen Jacobian, the last accepted step left the partials
+  // held at its end. They are only evaluated here after the state, the
+  // dynamics or the mode were changed from outside, which also leaves
+  // the derivative stale.
+  if ( m_helper.isFrozenJacobian() &&
+       !( m_ratesValid && m_helper.holdsJacobianAt( time ) ) )
   {
-    m_state[i] = stateAndPartials[i];
+    m_helper.holdJacobian( m_stateAndPartials.data(), time );
   }
-  for ( int i = 0; i < partialsSize; ++i )
+  if ( ( m_integrator != kAdamsBashforthMoulton ) &&
+       ( m_integrator != kGaussJackson ) )
   {
-    m_partials[i] = stateAndPartials[6 + i];
+    updateRates( time );
+  }
+
+  // Log the initial condition with its derivative
+  if ( atEpochs )
+  {
+    if ( ( nextEpoch != m_logEpochs.end() ) && ( *nextEpoch == time ) )
+    {
+      logState( time );
+      ++nextEpoch;
+    }
+  }
+  else if ( m_logPolicy != kLogNothing )
+  {
+    logState( time );
+  }
+
+  if ( m_integrator == kGaussJackson )
+  {
+    stepGaussJackson( t, nextEpoch );
+    time = t;
+  }
+
+  // Integrate from current time to time t with adaptive steps, clipping
+  // steps to land on t, and on each output epoch before it. A clipped
+  // step does not shrink the step size carried to the next one.
+  int numSteps = 0;
+  while ( time < t )
+  {
+    double stopTime = t;
+    if ( atEpochs && ( nextEpoch != m_logEpochs.end() ) && ( *nextEpoch < t ) )
+    {
+      stopTime = *nextEpoch;
+    }
+
+    bool clipped = ( stopTime - time <= m_dt );
+    double trialStep = clipped ? stopTime - time : m_dt;
+    if ( m_helper.isFrozenJacobian() )
+    {
+      holdJacobianTo( time, trialStep );
+    }
+    if ( tryStep( time, trialStep ) )
+    {
+      if ( m_helper.isFrozenJacobian() )
+      {
+        m_helper.advanceJacobian();
+      }
+      if ( clipped )
+      {
+        time = stopTime;
+      }
+      else
+      {
+        m_dt = trialStep;
+      }
+      ++numSteps;
+      ++m_stats.acceptedSteps;
+
+      switch ( m_logPolicy )
+      {
+        case kLogEveryStep:
+        case kLogStateOnly:
+          logState( time );
+          break;
+        case kLogEveryKthStep:
+          // The last step is always logged so the log spans [t0, t]
+          if ( ( numSteps % m_logInterval == 0 ) || ( time == t ) )
+          {
+            logState( time );
+          }
+          break;
+        case kLogAtEpochs:
+          if ( ( nextEpoch != m_logEpochs.end() ) && ( *nextEpoch == time ) )
+          {
+            logState( time );
+            ++nextEpoch;
+          }
+          break;
+        case kLogNothing:
+          break;
+      }
+    }
+    else
+    {
+      m_dt = trialStep;
+      ++m_stats.rejectedSteps;
+    }
   }
+
+  m_stats.rhsCalls += m_helper.getNumCalls() - rhsCalls;
+  m_stats.jacobianCalls += m_helper.getNumJacobians() - jacobianCalls;
   m_time = t;
 }
 
+// Choose the integrator and its tolerances
+void
+Motion::
+setIntegrator( Integrator integrator, double absTol, double relTol )
+{
+  bool ownErrorControl = ( integrator == kBulirschStoer ) ||
+                         ( integrator == kAdamsBashforthMoulton );
+  if ( ownErrorControl && ( m_errorControl != kControlAll ) )
+  {
+    throw std::invalid_argument(
+      "Motion::setIntegrator: integrator controls every component" );
+  }
+  if ( ( integrator == kGaussJackson ) && !( m_step > 0.0 ) )
+  {
+    throw std::invalid_argument(
+      "Motion::setIntegrator: Gauss-Jackson needs a positive step" );
+  }
+  bool staged = ( integrator == kDopri5 ) ||
+                ( integrator == kRungeKuttaFehlberg78 );
+  if ( m_helper.isFrozenJacobian() && !staged )
+  {
+    throw std::invalid_argument(
+      "Motion::setIntegrator: frozen Jacobian needs a Runge-Kutta "
+      "integrator" );
+  }
+  m_integrator = integrator;
+  m_absTol = absTol;
+  m_relTol = relTol;
+  resetStepper();
+}
+
+// Hold the acceleration partials over the stages of each trial step
+void
+Motion::
+setFrozenJacobian( bool frozen )
+{
+  bool staged = ( m_integrator == kDopri5 ) ||
+                ( m_integrator == kRungeKuttaFehlberg78 );
+  if ( frozen && !staged )
+  {
+    throw std::invalid_argument(
+      "Motion::setFrozenJacobian: integrator has no stages to hold the "
+      "Jacobian over" );
+  }
+  m_helper.setFrozenJacobian( frozen );
+
+  // The derivative at m_time may have been taken with the other mode
+  m_ratesValid = false;
+}
+
+// Choose the step size error control and its tolerances
+void
+Motion::
+setErrorControl( ErrorControl control, double absTol, double relTol )
+{
+  bool ownErrorControl = ( m_integrator == kBulirschStoer ) ||
+                         ( m_integrator == kAdamsBashforthMoulton );
+  if ( ownErrorControl && ( control != kControlAll ) )
+  {
+    throw std::invalid_argument(
+      "Motion::setErrorControl: integrator controls every component" );
+  }
+  m_errorControl = control;
+  m_absTol = absTol;
+  m_relTol = relTol;
+  resetStepper();
+}
+
+// Control the step size on weighted components of the state and STM
+void
+Motion::
+setErrorWeights( const std::vector< double > &weights )
+{
+  m_errorWeights = weights;
+  setErrorControl( kControlWeighted, m_absTol, m_relTol );
+}
+
+// Number of right hand side evaluations so far
+unsigned long
+Motion::
+getRhsCount() const
+{
+  return m_helper.getNumCalls();
+}
+
+// Right hand side evaluations and steps of stepTo so far
+Motion::IntegrationStats
+Motion::
+getIntegrationStats() const
+{
+  return m_stats;
+}
+
+// Start counting the work of stepTo from zero
+void
+Motion::
+resetIntegrationStats()
+{
+  m_stats = IntegrationStats();
+}
+
+// Choose what stepTo logs. Switching between logging the STM and not
+// drops the existing history, since its layout changes.
+void
+Motion::
+setLogPolicy( LogPolicy policy )
+{
+  bool loggedStm = ( m_logPolicy != kLogStateOnly );
+  m_logPolicy = policy;
+  if ( loggedStm != ( m_logPolicy != kLogStateOnly ) )
+  {
+    resetTrajectory();
+  }
+}
+
+// Log state and STM at every k-th accepted step
+void
+Motion::
+setLogEveryKthStep( int k )
+{
+  if ( k < 1 )
+  {
+    throw std::invalid_argument( "Motion::setLogEveryKthStep: k < 1" );
+  }
+  m_logInterval = k;
+  setLogPolicy( kLogEveryKthStep );
+}
+
+// Log state and STM exactly at the given epochs, and nowhere else
+void
+Motion::
+setLogEpochs( const std::vector< double > &epochs )
+{
+  m_logEpochs = epochs;
+  std::sort( m_logEpochs.begin(), m_logEpochs.end() );
+  setLogPolicy( kLogAtEpochs );
+}
+
 // Return the current time step.
 double
 Motion::
@@ -147,86 +575,98 @@ getTime() const
   return m_time;
 }
 
-// Return the state of the motion at  time step.
+// Return the state of the motion at time t, which can be any time
+// inside the propagated span.
 std::vector< double >
 Motion::
 getState( double t ) const
 {
-  std::map< double, std::vector< double > >::const_iterator search =
-    m_pastStates.find( t );
-  if ( search != m_pastStates.end() )
-  {
-    std::vector< double > stateAndPartials = search->second;
-    std::vector< double > state( stateAndPartials.begin(),
-                            stateAndPartials.begin() + 6 );
-    return state;
-  }
-  else
+  // The current state is always available, whatever was logged
+  if ( t == m_time )
   {
-    std::cout << "No state at time " << t << "." << std::endl;
-    throw;
+    return std::vector< double >( m_stateAndPartials.begin(),
+                                  m_stateAndPartials.begin() + 6 );
   }
+  std::vector< double > state( 6 );
+  interpolate( t, 0, 6, state.data() );
+  return state;
 }
 
 // Return the state partials of the motion wrt a group of agents at
-// the current time step ( the partials are dX(t)/dX(t0) )
+// time t, which can be any time inside the propagated span ( the
+// partials are dX(t)/dX(t0) )
 std::vector< double >
 Motion::
 getStatePartials( double t ) const
 {
-  std::map< double, std::vector< double > >::const_iterator search =
-    m_pastStates.find( t );
-  if ( search != m_pastStates.end() )
+  if ( t == m_time )
   {
-    std::vector< double > stateAndPartials = search->second;
-    std::vector< double > partials( stateAndPartials.begin() + 6,
-                               stateAndPartials.end() );
-    return partials;
+    return std::vector< double >( m_stateAndPartials.begin() + 6,
+                                  m_stateAndPartials.end() );
   }
-  else
+  if ( m_trajectory.stmSize() == 0 )
   {
-    std::cout << "No state partials at time " << t << "." << std::endl;
-    throw;
+    throw std::out_of_range( "Motion: no state partials were logged" );
   }
+  std::vector< double > partials( m_stateAndPartials.size() - 6 );
+  interpolate( t, 6, m_stateAndPartials.size(), partials.data() );
+  return partials;
 }
 
-// Pretty print the state at time t ( must either be current time, or a
-// valid logged past time.
+// Return the state and partials at time t together, without
+// allocating
 void
 Motion::
-printStateAndPartials( double t ) const
+getStateAndPartials( double t, double *out ) const
 {
-  std::map< double, std::vector< double > >::const_iterator search =
-    m_pastStates.find( t );
-  if ( search != m_pastStates.end() )
+  if ( t == m_time )
   {
-    std::vector< double > state = search->second;
+    std::copy( m_stateAndPartials.begin(), m_stateAndPartials.end(), out );
+    return;
+  }
+  if ( m_trajectory.stmSize() == 0 )
+  {
+    throw std::out_of_range( "Motion: no state partials were logged" );
+  }
+  interpolate( t, 0, m_stateAndPartials.size(), out );
+}
+
+// Pretty print the state at time t, which can be any time inside the
+// propagated span.
+void
+Motion::
+printStateAndPartials( double t ) const
+{
+  std::vector< double > state = getState( t );
+  std::vector< double > partials = getStatePartials( t );
 
-    std::cout << "\n### State at time " << t << std::endl
-              << "X: " << setprecision(18) << state[0] << std::endl
-              << "Y: " << state[1] << std::endl
-              << "Z: " << state[2] << std::endl
-              << "dX: " << state[3] << std::endl
-              << "dY: " << state[4] << std::endl
-              << "dZ: " << state[5] << std::endl;
+  std::cout << "\n### State at time " << t << std::endl
+            << "X: " << std::setprecision(18) << state[0] << std::endl
+            << "Y: " << state[1] << std::endl
+            << "Z: " << state[2] << std::endl
+            << "dX: " << state[3] << std::endl
+            << "dY: " << state[4] << std::endl
+            << "dZ: " << state[5] << std::endl;
 
-    std::cout << "\n### STM at time " << t << std::endl;
-    int stmSize = state.size() - 6;
-    int numAgents = sqrt( stmSize );
-    for ( int i = 0; i < stmSize; ++i )
+  std::cout << "\n### STM at time " << t << std::endl;
+  int stmSize = partials.size();
+  int numAgents = sqrt( stmSize );
+  for ( int i = 0; i < stmSize; ++i )
+  {
+    std::cout << "   " << partials[i];
+    if ( ( i > 0 ) && (i % numAgents == 0 ) )
     {
-      std::cout << "   " << state[6 + i];
-      if ( ( i > 0 ) && (i % numAgents == 0 ) )
-      {
-        std::cout << std::endl;
-      }
+      std::cout << std::endl;
     }
   }
-  else
-  {
-    std::cout << "No state at time " << t << "." << std::endl;
-    throw;
-  }
+}
+
+// Configure when the logged history spills to memory-mapped files
+void
+Motion::
+setHistorySpill( std::size_t bytes, const std::string &directory )
+{
+  m_trajectory.setSpillLimit( bytes, directory );
 }
 
 // Pretty print all states in the log
@@ -234,27 +674,415 @@ void
 Motion::
 printAllStates() const
 {
-  for ( auto a: m_pastStates )
+  for ( std::size_t i = 0; i < m_trajectory.size(); ++i )
+  {
+    printStateAndPartials( m_trajectory.time( i ) );
+  }
+}
+
+// Step all motions to the same time in parallel
+void
+Motion::
+propagateAll(
+    std::vector< Motion > &motions,
+    double t,
+    ThreadPool &pool )
+{
+  propagateAll( motions, std::vector< double >( motions.size(), t ), pool );
+}
+
+// Step each motion to its own time in parallel. The Motions share
+// nothing mutable, since Actions are const and each Motion has its own
+// helper and workspaces.
+void
+Motion::
+propagateAll(
+    std::vector< Motion > &motions,
+    const std::vector< double > &times,
+    ThreadPool &pool )
+{
+  if ( times.size() != motions.size() )
   {
-    printStateAndPartials( a.first );
+    throw std::invalid_argument(
+      "Motion::propagateAll: need one time per Motion" );
   }
+
+  pool.run( motions.size(), [ &motions, &times ]( std::size_t i )
+  {
+    motions[i].stepTo( times[i] );
+  } );
 }
 
 //=====================================================================
 //=====================================================================
 // PRIVATE MEMBERS
+
+// Log the current state and partials at "time", an accepted integrator
+// step, with their time derivative
+void
+Motion::
+logState( double time )
+{
+  updateRates( time );
+  m_trajectory.append( time, m_stateAndPartials.data(), m_rates.data() );
+}
+
+// Rebuild the stepper of the chosen integrator with the current error
+// control, dropping the history of a multistep integrator. The step
+// size adapted so far and the derivative at m_time are kept.
+void
+Motion::
+resetStepper()
+{
+  std::vector< double > weights;
+  switch ( m_errorControl )
+  {
+    case kControlAll:
+      break;
+    case kControlStateOnly:
+      weights.assign( 6, 1.0 );
+      break;
+    case kControlWeighted:
+      weights = m_errorWeights;
+      break;
+  }
+
+  switch ( m_integrator )
+  {
+    case kDopri5:
+      m_stepper = ControlledStepper(
+        WeightedErrorChecker( m_absTol, m_relTol, weights ) );
+      break;
+    case kRungeKuttaFehlberg78:
+      m_fehlbergStepper = FehlbergStepper(
+        WeightedErrorChecker( m_absTol, m_relTol, weights ) );
+      break;
+    case kBulirschStoer:
+      m_bulirschStoer = BulirschStoerStepper( m_absTol, m_relTol );
+      break;
+    case kAdamsBashforthMoulton:
+      // No limit on the step size
+      m_adamsStepper = AdamsStepper( AdamsStepper::step_adjuster_type(
+        m_absTol, m_relTol, std::numeric_limits< double >::max() ) );
+      break;
+    case kGaussJackson:
+      m_gaussJackson = GaussJackson( m_step, m_absTol, m_relTol );
+      break;
+  }
+}
+
+// Try a step of "dt" from "time" with the chosen integrator. On success
+// the state, partials and "time" are advanced, and "dt" is the step
+// size proposed for the next step; on failure "dt" is the smaller step
+// to retry with. The Runge-Kutta and extrapolation integrators leave
+// m_rates at the derivative at the new time, Adams-Bashforth-Moulton
+// leaves it to be evaluated when needed.
+bool
+Motion::
+tryStep( double &time, double &dt )
+{
+  using namespace boost::numeric::odeint;
+
+  // The helper is passed by reference: odeint would otherwise copy it,
+  // and its workspaces, on every step
+  controlled_step_result result = fail;
+  switch ( m_integrator )
+  {
+    case kDopri5:
+      return m_stepper.try_step( std::ref( m_helper ), m_stateAndPartials,
+                                 m_rates, time, dt ) == success;
+    case kRungeKuttaFehlberg78:
+      result = m_fehlbergStepper.try_step( std::ref( m_helper ),
+                                           m_stateAndPartials, m_rates,
+                                           time, dt );
+      break;
+    case kBulirschStoer:
+      result = m_bulirschStoer.try_step( std::ref( m_helper ),
+                                         m_stateAndPartials, m_rates,
+                                         time, dt );
+      break;
+    case kGaussJackson:
+      // Stepped by stepGaussJackson
+      return false;
+    case kAdamsBashforthMoulton:
+      if ( m_adamsStepper.try_step( std::ref( m_helper ), m_stateAndPartials,
+                                    time, dt ) != success )
+      {
+        return false;
+      }
+      m_ratesValid = false;
+      return true;
+  }
+  if ( result != success )
+  {
+    return false;
+  }
+  m_helper( m_stateAndPartials, m_rates, time );
+  return true;
+}
+
+// Hold acceleration partials that vary linearly over the step of "dt"
+// from "time", from those at its start to those at the state predicted
+// at its end by a second order Taylor expansion. Over the stages, they
+// follow the exact partials to second order in the step size, and
+// dopri5 finds the end partials of one step again at the first stage
+// of the next.
+void
+Motion::
+holdJacobianTo(
+    double time,
+    double dt )
+{
+  double end[6];
+  for ( int i = 0; i < 3; ++i )
+  {
+    end[i] = m_stateAndPartials[i] +
+             dt * ( m_rates[i] + 0.5 * dt * m_rates[i + 3] );
+    end[i + 3] = m_stateAndPartials[i + 3] + dt * m_rates[i + 3];
+  }
+  m_helper.holdJacobianTo( end, time + dt );
+}
+
+// Step to t on the Gauss-Jackson grid, starting it at the current state
+// if needed. Grid points up to t are handed out in order, each once, as
+// accepted steps, and logged as such. The state at t and at output
+// epochs between grid points is interpolated.
+void
+Motion::
+stepGaussJackson(
+    double t,
+    std::vector< double >::const_iterator &nextEpoch )
+{
+  if ( !m_gaussJackson.isStarted() )
+  {
+    m_gaussJackson.start( m_helper, m_stateAndPartials, m_time );
+    m_gridPoint = 1;
+  }
+
+  bool atEpochs = ( m_logPolicy == kLogAtEpochs );
+  int numSteps = 0;
+  while ( true )
+  {
+    while ( ( m_gridPoint <= m_gaussJackson.lastPoint() ) &&
+            ( m_gaussJackson.time( m_gridPoint ) <= t ) )
+    {
+      double time = m_gaussJackson.time( m_gridPoint );
+      while ( atEpochs && ( nextEpoch != m_logEpochs.end() ) &&
+              ( *nextEpoch < time ) )
+      {
+        m_gaussJackson.interpolate( *nextEpoch, m_stateAndPartials.data() );
+        m_ratesValid = false;
+        logState( *nextEpoch );
+        ++nextEpoch;
+      }
+
+      m_stateAndPartials = m_gaussJackson.state( m_gridPoint );
+      m_rates = m_gaussJackson.rates( m_gridPoint );
+      m_ratesValid = true;
+      ++m_gridPoint;
+      ++numSteps;
+      ++m_stats.acceptedSteps;
+
+      switch ( m_logPolicy )
+      {
+        case kLogEveryStep:
+        case kLogStateOnly:
+          logState( time );
+          break;
+        case kLogEveryKthStep:
+          if ( ( numSteps % m_logInterval == 0 ) || ( time == t ) )
+          {
+            logState( time );
+          }
+          break;
+        case kLogAtEpochs:
+          if ( ( nextEpoch != m_logEpochs.end() ) && ( *nextEpoch == time ) )
+          {
+            logState( time );
+            ++nextEpoch;
+          }
+          break;
+        case kLogNothing:
+          break;
+      }
+    }
+
+    if ( m_gaussJackson.time( m_gaussJackson.lastPoint() ) >= t )
+    {
+      break;
+    }
+    m_gaussJackson.step( m_helper );
+  }
+
+  // Epochs after the last grid point handed out, and t itself unless it
+  // is that point
+  while ( atEpochs && ( nextEpoch != m_logEpochs.end() ) &&
+          ( *nextEpoch < t ) )
+  {
+    m_gaussJackson.interpolate( *nextEpoch, m_stateAndPartials.data() );
+    m_ratesValid = false;
+    logState( *nextEpoch );
+    ++nextEpoch;
+  }
+  if ( m_gaussJackson.time( m_gridPoint - 1 ) == t )
+  {
+    return;
+  }
+  m_gaussJackson.interpolate( t, m_stateAndPartials.data() );
+  m_ratesValid = false;
+  switch ( m_logPolicy )
+  {
+    case kLogEveryStep:
+    case kLogStateOnly:
+    case kLogEveryKthStep:
+      logState( t );
+      break;
+    case kLogAtEpochs:
+      if ( ( nextEpoch != m_logEpochs.end() ) && ( *nextEpoch == t ) )
+      {
+        logState( t );
+        ++nextEpoch;
+      }
+      break;
+    case kLogNothing:
+      break;
+  }
+}
+
+// Evaluate the derivative of the current state and partials at "time",
+// unless it is known already
+void
+Motion::
+updateRates( double time )
+{
+  if ( !m_ratesValid )
+  {
+    m_rates.resize( m_stateAndPartials.size() );
+    m_helper( m_stateAndPartials, m_rates, time );
+    m_ratesValid = true;
+  }
+}
+
+// Drop the logged history, and lay it out for the current agents and
+// log policy
+void
+Motion::
+resetTrajectory()
+{
+  m_trajectory.reset( m_logPolicy == kLogStateOnly ? 0 :
+                      m_stateAndPartials.size() - 6 );
+}
+
+// Evaluate elements [first, last) of the state and partials at time t,
+// by Hermite interpolation between the logged steps on either side of
+// t. The bracketing steps are found in O(log n).
+void
+Motion::
+interpolate(
+    double t,
+    int first,
+    int last,
+    double *out ) const
+{
+  std::size_t after = m_trajectory.lowerBound( t );
+  if ( ( after == m_trajectory.size() ) ||
+       ( ( after == 0 ) && ( m_trajectory.time( 0 ) != t ) ) )
+  {
+    throw std::out_of_range( "Motion: time is outside the propagated span" );
+  }
+
+  // Gather the logged values and rates of the requested elements at
+  // the steps bracketing t. The state and the STM live in separate
+  // columns of the trajectory.
+  std::size_t before = ( after == 0 ) ? 0 : after - 1;
+  const double *y0[2] = { m_trajectory.state( before ),
+                          m_trajectory.partials( before ) };
+  const double *f0[2] = { m_trajectory.stateRate( before ),
+                          m_trajectory.partialsRate( before ) };
+  const double *y1[2] = { m_trajectory.state( after ),
+                          m_trajectory.partials( after ) };
+  const double *f1[2] = { m_trajectory.stateRate( after ),
+                          m_trajectory.partialsRate( after ) };
+
+  // Exact hit on a logged step
+  if ( m_trajectory.time( after ) == t )
+  {
+    for ( int i = first; i < last; ++i )
+    {
+      out[ i - first ] = ( i < 6 ) ? y1[0][i] : y1[1][ i - 6 ];
+    }
+    return;
+  }
+
+  double t0 = m_trajectory.time( before );
+  double t1 = m_trajectory.time( after );
+
+  // Cubic Hermite basis functions on the step [t0, t1]
+  double h = t1 - t0;
+  double s = ( t - t0 ) / h;
+  double s2 = s * s;
+  double s3 = s2 * s;
+  double s4 = s3 * s;
+  double s5 = s4 * s;
+  double h00 = 2 * s3 - 3 * s2 + 1;
+  double h10 = ( s3 - 2 * s2 + s ) * h;
+  double h01 = -2 * s3 + 3 * s2;
+  double h11 = ( s3 - s2 ) * h;
+
+  // Position-like elements ( X, Y, Z and the matching STM rows ) also
+  // have their second derivative logged, as the rate of the matching
+  // velocity-like element, so they get quintic Hermite interpolation.
+  double q0 = 1 - 10 * s3 + 15 * s4 - 6 * s5;
+  double q1 = ( s - 6 * s3 + 8 * s4 - 3 * s5 ) * h;
+  double q2 = 0.5 * ( s2 - 3 * s3 + 3 * s4 - s5 ) * h * h;
+  double q3 = 0.5 * ( s3 - 2 * s4 + s5 ) * h * h;
+  double q4 = ( -4 * s3 + 7 * s4 - 3 * s5 ) * h;
+  double q5 = 10 * s3 - 15 * s4 + 6 * s5;
+
+  int numAgents = m_activeAgents.size();
+  for ( int i = first; i < last; ++i )
+  {
+    // Offset from a position-like element to its velocity-like partner
+    int partner = 0;
+    if ( i < 3 )
+    {
+      partner = 3;
+    }
+    else if ( ( i >= 6 ) && ( i < 6 + 3 * numAgents ) )
+    {
+      partner = 3 * numAgents;
+    }
+
+    // Column ( state or STM ) and index within it
+    int c = ( i >= 6 );
+    int j = c ? i - 6 : i;
+    if ( partner )
+    {
+      out[ i - first ] = q0 * y0[c][j] + q1 * f0[c][j] +
+                         q2 * f0[c][ j + partner ] +
+                         q3 * f1[c][ j + partner ] +
+                         q4 * f1[c][j] + q5 * y1[c][j];
+    }
+    else
+    {
+      out[ i - first ] = h00 * y0[c][j] + h10 * f0[c][j] +
+                         h01 * y1[c][j] + h11 * f1[c][j];
+    }
+  }
+}
+
 void
 Motion::
 initializePartials( std::vector< std::string > &activeAgents )
 {
-  // Reset the partials vector to all zeros
-  fill( m_partials.begin(), m_partials.end(), 0.0 );
+  // Reset the partials to all zeros, after the state
+  int numAgents = activeAgents.size();
+  m_stateAndPartials.resize( 6 );
+  m_stateAndPartials.resize( 6 + numAgents * numAgents, 0.0 );
 
   // Set the state partials from t0 to t0, i.e. the identity matrix
-  int numAgents = activeAgents.size();
-  m_partials.resize( numAgents * numAgents, 0.0 );
   for ( int i = 0; i < numAgents ; ++i )
   {
-    m_partials[ numAgents * i + i ] = 1;
+    m_stateAndPartials[ 6 + numAgents * i + i ] = 1;
   }
 }
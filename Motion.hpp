@@ -12,9 +12,12 @@
 #define EKF_MOTION_HEADER_GUARD
 
 // C++ Standard Library
-#include <vector>
-#include <map>
+#include <cstddef>
 #include <string>
+#include <vector>
+
+// boost Library
+#include <boost/numeric/odeint.hpp>
 
 // Eigen Library
 #include <Eigen/Dense>
@@ -22,19 +25,72 @@
 // ekf Library
 #include <Action.hpp>
 #include <AgentGroup.hpp>
+#include <ErrorChecker.hpp>
+#include <GaussJackson.hpp>
 #include <OdeintHelper.hpp>
+#include <ThreadPool.hpp>
+#include <Trajectory.hpp>
 
 /// @brief Manage the motion of an agent through space.
 ///
 /// Given a set of Actions, Motion will step the agent forward in time
 /// and allow querying the state of the agent at any time it has
-/// previously visited.
+/// previously visited. Each accepted integrator step is logged with its
+/// time derivative, and queries between steps are answered by Hermite
+/// interpolation ( quintic for positions, cubic for velocities ), so the
+/// integrator is free to take large adaptive steps.
 ///
 class Motion {
 
  public:
+  // What stepTo logs for later queries with getState / getStatePartials.
+  // Whatever the policy, the current state and partials are available.
+  enum LogPolicy
+  {
+    kLogEveryStep,    // State and STM at every accepted step ( default )
+    kLogNothing,      // Nothing
+    kLogStateOnly,    // State at every accepted step, without the STM
+    kLogEveryKthStep, // State and STM at every k-th accepted step
+    kLogAtEpochs      // State and STM exactly at caller-supplied epochs
+  };
+
+  // Which components of the state and STM control the step size
+  enum ErrorControl
+  {
+    kControlAll,       // Every state and STM component ( default )
+    kControlStateOnly, // The six state components; the STM is carried
+    kControlWeighted   // Per-component weights, see setErrorWeights
+  };
+
+  // Integrator stepTo advances the state and STM with. All but
+  // Gauss-Jackson adapt the step size to the tolerances of
+  // setIntegrator.
+  enum Integrator
+  {
+    kDopri5,                // Dormand-Prince 5(4), FSAL ( default )
+    kRungeKuttaFehlberg78,  // Runge-Kutta-Fehlberg 7(8)
+    kBulirschStoer,         // Bulirsch-Stoer extrapolation
+    kAdamsBashforthMoulton, // Variable order Adams-Bashforth-Moulton
+    kGaussJackson           // Gauss-Jackson 8th order, see below
+  };
+
+  // Work done by stepTo since construction or resetIntegrationStats()
+  struct IntegrationStats
+  {
+    unsigned long rhsCalls;      // Right hand side evaluations
+    unsigned long acceptedSteps; // Accepted steps, clipped ones included
+    unsigned long rejectedSteps; // Trial steps rejected by error control
+    unsigned long jacobianCalls; // Acceleration partials evaluations
+  };
+
   Motion();
   Motion( const std::vector< double > &ic, double step );
+  // Copies and moves rebind the integrator to the new object's actions
+  // and agents
+  Motion( const Motion &other );
+  Motion( Motion &&other );
+  Motion& operator=( const Motion &other );
+  Motion& operator=( Motion &&other );
  ~Motion();
 
   // Step to time t
@@ -44,29 +100,142 @@ class Motion {
   void addAction( std::shared_ptr<Action> a );
   // Activate agents for partials computations
   void activateAgents( const std::vector< std::string > agentNames );
+  // Names of the agents in the partials, state components first
+  const std::vector< std::string >& getActiveAgents() const;
+
+  // Replace the current state with the first six elements of "state",
+  // and restart the partials from the identity at the current time.
+  // The logged history is dropped.
+  void setState( const std::vector< double > &state );
 
   // Get current time step
   double getTime() const;
-  // Get value of state at step t ( defaults to current time )
+  // Get value of state at any time t inside the propagated span
   std::vector< double > getState( double t ) const;
-  // Get the partials of state at step t
+  // Get the partials of state at any time t inside the propagated span
   std::vector< double > getStatePartials( double t ) const;
+  // Write the state and then the row-major partials at time t to
+  // "out", which must hold 6 + n * n values for n active agents. Does
+  // not allocate, and may be called from several threads at once.
+  void getStateAndPartials( double t, double *out ) const;
+
+  // Choose the integrator and its tolerances. Bulirsch-Stoer and
+  // Adams-Bashforth-Moulton have their own error control over every
+  // component, so they throw std::invalid_argument unless the error
+  // control is kControlAll.
+  //
+  // Gauss-Jackson steps on a fixed grid, at the step given to the
+  // constructor, from the current time. Its tolerances end the corrector
+  // iterations; the error control does not apply. The grid runs up to
+  // one step past the time stepped to, and the state there, and at
+  // output epochs between grid points, is interpolated.
+  void setIntegrator( Integrator integrator, double absTol = 1.E-10,
+                      double relTol = 1.E-9 );
+  // Approximate the STM by evaluating the acceleration partials once per
+  // trial step, at the state predicted at its end, and holding them over
+  // the stages, interpolated in time from those at its start. The state
+  // is still integrated at full order, the STM only to second order in
+  // the step size, and its error is not seen by the error control. Only
+  // dopri5 and Runge-Kutta-Fehlberg 7(8) have stages to save on, so with
+  // the mode on setIntegrator throws std::invalid_argument for the
+  // others, and so does turning it on while one of them is chosen. Off
+  // by default.
+  void setFrozenJacobian( bool frozen );
+  // Choose the step size error control and its tolerances
+  void setErrorControl( ErrorControl control, double absTol = 1.E-10,
+                        double relTol = 1.E-9 );
+  // Control the step size on weighted components. Components past the
+  // end of "weights" are not controlled.
+  void setErrorWeights( const std::vector< double > &weights );
+  // Number of right hand side evaluations so far
+  unsigned long getRhsCount() const;
+  // Right hand side evaluations and accepted and rejected steps of
+  // stepTo, since construction or the last reset
+  IntegrationStats getIntegrationStats() const;
+  void resetIntegrationStats();
+
+  // Choose what stepTo logs
+  void setLogPolicy( LogPolicy policy );
+  // Log at every k-th accepted step, and at the end of each stepTo.
+  // Queries between logged steps interpolate across k steps.
+  void setLogEveryKthStep( int k );
+  // Log only at the given epochs, which the integrator steps onto
+  // exactly. Queries are meant for these epochs.
+  void setLogEpochs( const std::vector< double > &epochs );
+
+  // Move the logged history to memory-mapped files in "directory" once
+  // it grows past "bytes" bytes. Zero keeps it on the heap.
+  void setHistorySpill( std::size_t bytes, const std::string &directory );
 
   // Print the current state to cout
   void printStateAndPartials( double t ) const;
   void printAllStates() const;
 
+  // Step every Motion in "motions" to time t, or motions[i] to
+  // times[i], on the threads of "pool". Each Motion is one task, and
+  // idle threads steal tasks from busy ones, so uneven arcs balance
+  // out. Actions may be shared between the Motions. The first exception
+  // thrown by a stepTo is rethrown once all tasks are done.
+  static void propagateAll( std::vector< Motion > &motions, double t,
+                            ThreadPool &pool );
+  static void propagateAll( std::vector< Motion > &motions,
+                            const std::vector< double > &times,
+                            ThreadPool &pool );
+
  private:
+  typedef boost::numeric::odeint::controlled_runge_kutta<
+    boost::numeric::odeint::runge_kutta_dopri5< std::vector< double > >,
+    WeightedErrorChecker > ControlledStepper;
+  typedef boost::numeric::odeint::controlled_runge_kutta<
+    boost::numeric::odeint::runge_kutta_fehlberg78< std::vector< double > >,
+    WeightedErrorChecker > FehlbergStepper;
+  typedef boost::numeric::odeint::bulirsch_stoer< std::vector< double > >
+    BulirschStoerStepper;
+  // Adams-Bashforth-Moulton of order up to 8
+  typedef boost::numeric::odeint::controlled_adams_bashforth_moulton<
+    boost::numeric::odeint::adaptive_adams_bashforth_moulton<
+      8, std::vector< double > > > AdamsStepper;
 
   double m_time;
-  std::vector< double > m_state;
-  std::vector< double > m_partials;
+  // State followed by the row-major STM, as integrated
+  std::vector< double > m_stateAndPartials;
+  // Time derivative of m_stateAndPartials at m_time
+  std::vector< double > m_rates;
+  bool m_ratesValid;
   std::vector< std::string > m_activeAgents;
+  // Initial step size, and the step size adapted so far
   double m_step;
+  double m_dt;
+  Integrator m_integrator;
+  // Only the stepper of m_integrator is in use
+  ControlledStepper m_stepper;
+  FehlbergStepper m_fehlbergStepper;
+  BulirschStoerStepper m_bulirschStoer;
+  AdamsStepper m_adamsStepper;
+  GaussJackson m_gaussJackson;
+  // Next Gauss-Jackson grid point for stepTo to hand out
+  long m_gridPoint;
+  IntegrationStats m_stats;
+  ErrorControl m_errorControl;
+  double m_absTol;
+  double m_relTol;
+  std::vector< double > m_errorWeights;
   std::vector< std::shared_ptr< Action > > m_actions;
   OdeintHelper m_helper;
-  map< double, std::vector< double > > m_pastStates;
+  Trajectory m_trajectory;
+  LogPolicy m_logPolicy;
+  int m_logInterval;
+  std::vector< double > m_logEpochs;
 
+  void logState( double time );
+  void resetTrajectory();
+  void resetStepper();
+  bool tryStep( double &time, double &dt );
+  void stepGaussJackson(
+    double t, std::vector< double >::const_iterator &nextEpoch );
+  void updateRates( double time );
+  void holdJacobianTo( double time, double dt );
+  void interpolate( double t, int first, int last, double *out ) const;
   void initializePartials( std::vector< std::string >& activeAgents );
 };
 
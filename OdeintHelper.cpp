@@ -8,10 +8,13 @@
 ///
 
 // C++ Standard Library
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
-// Eigien Library
-#include <eigen/dense>
+// Eigen Library
+#include <Eigen/Dense>
 
 // ekf Library
 #include <OdeintHelper.hpp>
@@ -23,7 +26,20 @@
 OdeintHelper::
 OdeintHelper()
     : m_actions(),
-      m_activeAgents()
+      m_activeAgents(),
+      m_agentIndices(),
+      m_kinematics(),
+      m_numAgents( 0 ),
+      m_accel(),
+      m_partials(),
+      m_numCalls( 0 ),
+      m_numJacobians( 0 ),
+      m_frozenJacobian( false ),
+      m_jacobianHeld( false ),
+      m_startPartials(),
+      m_endPartials(),
+      m_startTime( 0.0 ),
+      m_endTime( 0.0 )
 {
 }
 
@@ -32,10 +48,34 @@ OdeintHelper(
     std::vector< std::shared_ptr< Action > >& actions,
     std::vector< std::string >& activeAgents )
     : m_actions( &actions ),
-      m_activeAgents( &activeAgents )
+      m_activeAgents( &activeAgents ),
+      m_agentIndices(),
+      m_kinematics(),
+      m_numAgents( 0 ),
+      m_accel(),
+      m_partials(),
+      m_numCalls( 0 ),
+      m_numJacobians( 0 ),
+      m_frozenJacobian( false ),
+      m_jacobianHeld( false ),
+      m_startPartials(),
+      m_endPartials(),
+      m_startTime( 0.0 ),
+      m_endTime( 0.0 )
 {
 }
 
+OdeintHelper::
+OdeintHelper(
+    const OdeintHelper &other,
+    std::vector< std::shared_ptr< Action > >& actions,
+    std::vector< std::string >& activeAgents )
+    : OdeintHelper( other )
+{
+  m_actions = &actions;
+  m_activeAgents = &activeAgents;
+}
+
 OdeintHelper::
 ~OdeintHelper()
 {
@@ -46,7 +86,27 @@ OdeintHelper::
 // PUBLIC MEMBERS
 
 // This method defines the equations of motion for the odeint
-// integrator.
+// integrator. It works entirely in the workspaces sized by
+// activateAgents(), and reads and writes the STM in place, so it does
+// not allocate.
+//
+// The A matrix has the block structure
+//
+//       | 0  I  0  |      rows for X, Y, Z
+//   A = | Ar Av Ap |      rows for dX, dY, dZ
+//       | 0  0  0  |      rows for constant parameters
+//
+// so only the acceleration rows [Ar Av Ap] are evaluated by the actions,
+// and the STM derivative is built block by block instead of as a dense
+// A * STM product. Since the parameter rows of A are zero, the parameter
+// rows of the STM stay at their initial value [0 I], which reduces the
+// acceleration rows of the product to [Ar Av] * STM(0:6, :) + [0 Ap].
+// The cost per call is then linear in the number of active agents, apart
+// from zeroing the constant rows.
+//
+// With a frozen Jacobian, [Ar Av Ap] are interpolated in time between
+// those held at the start and end of the step, and the actions only add
+// their acceleration.
 void
 OdeintHelper::
 operator() (
@@ -54,71 +114,70 @@ operator() (
     std::vector< double > &dxdt ,
     const double t  )
 {
-  // Accumulate accelerations from the different actions.
-  std::vector< double > accel( 3, 0.0 );
-  for ( auto ap: *m_actions )
-  {
-    ap->getAcceleration( accel, x );
-  }
+  ++m_numCalls;
 
-  // Accumulate partials from the different actions.
-  int numAgents = m_activeAgents->size();
-  int numPartials = numAgents * numAgents;
-  std::vector< double > partials( numPartials, 0.0 );
-  for ( auto ap: *m_actions )
-  {
-    ap->getPartials( partials, x, *m_activeAgents );
-  }
+  // Derive the geometry once for all actions
+  m_kinematics.update( x.data(), t );
 
-  // Write the paramter partials into a matrix
-  Eigen::MatrixXd A( numAgents, numAgents );
-  A = Eigen::MatrixXd::Zero( numAgents, numAgents );
-  for ( int i = 0; i < numAgents ; ++i )
+  // Accumulate accelerations and acceleration partials from the
+  // different actions, in one pass over each.
+  int numAgents = m_numAgents;
+  int numParams = numAgents - 6;
+  std::fill( m_accel.begin(), m_accel.end(), 0.0 );
+  if ( m_frozenJacobian )
   {
-    for ( int j = 0; j < numAgents; ++j )
+    for ( const std::shared_ptr< Action > &ap: *m_actions )
     {
-      A(i, j) = partials[ j + i * numAgents ];
+      ap->getAcceleration( m_accel.data(), m_kinematics );
     }
-  }
-
-  if ( m_debug )
-  {
-    std::cout << "\n### A at time " << t << std::endl;
-    for ( int i = 0; i < numAgents; ++i )
+    double span = m_endTime - m_startTime;
+    double weight = ( span != 0.0 ) ? ( t - m_startTime ) / span : 0.0;
+    for ( std::size_t i = 0; i < m_partials.size(); ++i )
     {
-      for ( int j = 0; j < numAgents; ++j )
-      {
-        std::cout << "   " << A( i, j );
-      }
-      std::cout << std::endl;
+      m_partials[i] = m_startPartials[i] +
+                      weight * ( m_endPartials[i] - m_startPartials[i] );
     }
   }
-
-  // Write the current STM into a matrix
-  Eigen::MatrixXd stm( numAgents, numAgents );
-  for ( int i = 0; i < numAgents ; ++i )
+  else
   {
-    for ( int j = 0; j < numAgents; ++j )
+    std::fill( m_partials.begin(), m_partials.end(), 0.0 );
+    for ( std::size_t k = 0; k < m_actions->size(); ++k )
     {
-      stm(i, j) = x[ 6 + j + i * numAgents ];
+      ( *m_actions )[k]->evaluate( m_accel.data(), m_partials.data(),
+                                   m_kinematics, m_agentIndices[k] );
     }
+    ++m_numJacobians;
   }
+  ConstMatrixMap accelPartials( m_partials.data(), 3, numAgents );
 
   if ( m_debug )
   {
-    std::cout << "\n### STM at time " << t << std::endl;
-    for ( int i = 0; i < numAgents; ++i )
+    std::cout << "\n### Acceleration rows of A at time " << t << std::endl;
+    for ( int i = 0; i < 3; ++i )
     {
       for ( int j = 0; j < numAgents; ++j )
       {
-        std::cout << "   " << stm( i, j );
+        std::cout << "   " << accelPartials( i, j );
       }
       std::cout << std::endl;
     }
   }
 
-  // Multiply the current STM times A partials to get derivative of STM
-  Eigen::MatrixXd dStm = A * stm;
+  // View the current STM and its derivative, stored row-major after
+  // the state
+  ConstMatrixMap stm( x.data() + 6, numAgents, numAgents );
+  MatrixMap dStm( dxdt.data() + 6, numAgents, numAgents );
+
+  // Position rows: d/dt dR/dX0 = dV/dX0
+  dStm.topRows< 3 >() = stm.middleRows< 3 >( 3 );
+
+  // Velocity rows: d/dt dV/dX0 = [Ar Av] * dState/dX0 + [0 Ap]
+  dStm.middleRows< 3 >( 3 ).noalias() =
+    accelPartials.leftCols< 6 >() * stm.topRows< 6 >();
+  dStm.block( 3, 6, 3, numParams ) += accelPartials.rightCols( numParams );
+
+  // Parameter rows: constant
+  dStm.bottomRows( numParams ).setZero();
 
   if ( m_debug )
   {
@@ -137,23 +196,146 @@ operator() (
   dxdt[0] = x[3]; // X_dot
   dxdt[1] = x[4]; // Y_dot
   dxdt[2] = x[5]; // Z_dot
-  dxdt[3] = accel[0]; // DX_dot
-  dxdt[4] = accel[1]; // DY_dot
-  dxdt[5] = accel[2]; // DY_dot
+  dxdt[3] = m_accel[0]; // DX_dot
+  dxdt[4] = m_accel[1]; // DY_dot
+  dxdt[5] = m_accel[2]; // DY_dot
+}
 
-  // State partials
-  for ( int i = 0; i < numAgents; ++i )
+// Resolve where each action's owned agents sit in the partials block,
+// and size the workspaces used by operator() for that many agents.
+void
+OdeintHelper::
+activateAgents()
+{
+  // The state block of the partials is laid out by operator() as X, Y, Z,
+  // dX, dY, dZ; anything else would silently mislabel the STM.
+  static const char *const kStateAgents[] = { "X", "Y", "Z",
+                                              "dX", "dY", "dZ" };
+  if ( m_activeAgents->size() < 6 )
   {
-    for (int j = 0; j < numAgents; ++j )
-    dxdt[ 6 + j + i * numAgents ] = dStm(i,j);
+    throw std::invalid_argument(
+      "The active agents must start with X, Y, Z, dX, dY, dZ" );
   }
+  for ( int i = 0; i < 6; ++i )
+  {
+    if ( ( *m_activeAgents )[i] != kStateAgents[i] )
+    {
+      throw std::invalid_argument(
+        "Active agent " + std::to_string( i ) + " is \"" +
+        ( *m_activeAgents )[i] + "\", expected \"" + kStateAgents[i] +
+        "\"" );
+    }
+  }
+
+  m_kinematics = Kinematics( Action::bodyRotationRate( *m_actions ) );
+  m_numAgents = m_activeAgents->size();
+  m_accel.assign( 3, 0.0 );
+  m_partials.assign( 3 * m_numAgents, 0.0 );
+  m_startPartials.assign( 3 * m_numAgents, 0.0 );
+  m_endPartials.assign( 3 * m_numAgents, 0.0 );
+  m_jacobianHeld = false;
+
+  m_agentIndices.clear();
+  for ( const std::shared_ptr< Action > &ap: *m_actions )
+  {
+    m_agentIndices.push_back( ap->indexAgents( *m_activeAgents ) );
+  }
+}
+
+// Number of times operator() was called
+unsigned long
+OdeintHelper::
+getNumCalls() const
+{
+  return m_numCalls;
+}
+
+// Hold the acceleration partials over the stages of a step, or not
+void
+OdeintHelper::
+setFrozenJacobian( bool frozen )
+{
+  m_frozenJacobian = frozen;
+  m_jacobianHeld = false;
+}
+
+// Whether the acceleration partials are held
+bool
+OdeintHelper::
+isFrozenJacobian() const
+{
+  return m_frozenJacobian;
+}
+
+// Hold the acceleration partials at "state" alone
+void
+OdeintHelper::
+holdJacobian(
+    const double *state,
+    double t )
+{
+  evaluatePartials( state, t, m_startPartials );
+  m_endPartials = m_startPartials;
+  m_startTime = t;
+  m_endTime = t;
+  m_jacobianHeld = true;
 }
 
-/// @todo remove this
+// Hold partials varying linearly up to those at "state"
 void
 OdeintHelper::
-howManyActions()
+holdJacobianTo(
+    const double *state,
+    double t )
 {
-  std::cout << "There are " << m_actions->size()
-       << " Actions in the helper" << std::endl;
+  evaluatePartials( state, t, m_endPartials );
+  m_endTime = t;
+}
+
+// Start the held partials from the end of the step taken
+void
+OdeintHelper::
+advanceJacobian()
+{
+  m_startPartials = m_endPartials;
+  m_startTime = m_endTime;
+}
+
+// Whether the held partials start at time t
+bool
+OdeintHelper::
+holdsJacobianAt( double t ) const
+{
+  return m_jacobianHeld && ( m_startTime == t );
+}
+
+// Number of times the acceleration partials were evaluated
+unsigned long
+OdeintHelper::
+getNumJacobians() const
+{
+  return m_numJacobians;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Evaluate the acceleration partials at "state". The acceleration found
+// along the way is dropped.
+void
+OdeintHelper::
+evaluatePartials(
+    const double *state,
+    double t,
+    std::vector< double > &partials )
+{
+  m_kinematics.update( state, t );
+  std::fill( partials.begin(), partials.end(), 0.0 );
+  for ( std::size_t k = 0; k < m_actions->size(); ++k )
+  {
+    ( *m_actions )[k]->evaluate( m_accel.data(), partials.data(),
+                                 m_kinematics, m_agentIndices[k] );
+  }
+  ++m_numJacobians;
 }
@@ -12,36 +12,110 @@
 #define EKF_ODEINTHELPER_HEADER_GUARD
 
 // C++ Standard Library
+#include <memory>
 #include <string>
 #include <vector>
 
+// Eigen Library
+#include <Eigen/Dense>
+
 // ekf Library
 #include <Action.hpp>
+#include <Kinematics.hpp>
 
 /// @brief Interface class between ekf and boost::odeint.
 ///
 /// This class implements the interface that the odeint library
 /// requires. It is used by Motion to manage the state integration.
 ///
+/// The active agents must start with the six state components X, Y, Z,
+/// dX, dY, dZ; any agents after them are treated as constant parameters
+/// when propagating the STM.
+///
 class OdeintHelper{
  public:
 
   OdeintHelper();
   OdeintHelper( std::vector< std::shared_ptr< Action > >& actions,
                 std::vector< std::string >& activeAgents );
+  // Copy of "other" working on "actions" and "activeAgents" instead,
+  // for the owner of the helper to use when it is copied or moved
+  OdeintHelper( const OdeintHelper &other,
+                std::vector< std::shared_ptr< Action > >& actions,
+                std::vector< std::string >& activeAgents );
  ~OdeintHelper();
 
   // Allows this class to be called by the odeint solver
   void operator() ( const std::vector< double >& x,
                     std::vector< double >& dxdt,
                     const double t );
-  void howManyActions();
+
+  // Resolve the agents owned by each action against the active agents,
+  // take the body rotation rate from the actions, and size the
+  // integration workspaces. Must be called whenever actions or active
+  // agents change. Throws std::invalid_argument unless the active
+  // agents start with X, Y, Z, dX, dY, dZ.
+  void activateAgents();
+
+  // Number of times operator() was called
+  unsigned long getNumCalls() const;
+
+  // With a frozen Jacobian, calls take the acceleration alone from the
+  // actions, and the STM derivative uses the acceleration partials held
+  // by holdJacobian() and holdJacobianTo(). Off by default.
+  void setFrozenJacobian( bool frozen );
+  bool isFrozenJacobian() const;
+  // Evaluate the acceleration partials at the position and velocity
+  // "state" at time t, and hold them
+  void holdJacobian( const double *state, double t );
+  // Evaluate them also at "state" at a later time t, and hold partials
+  // that vary linearly in time from the first to these
+  void holdJacobianTo( const double *state, double t );
+  // Hold the partials of the last holdJacobianTo() alone, as those of
+  // holdJacobian() at its time
+  void advanceJacobian();
+  // Whether partials are held from time t on, since the last change of
+  // mode or agents
+  bool holdsJacobianAt( double t ) const;
+  // Number of times the acceleration partials were evaluated
+  unsigned long getNumJacobians() const;
 
  private:
+  typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > RowMajorMatrix;
+  typedef Eigen::Map< RowMajorMatrix > MatrixMap;
+  typedef Eigen::Map< const RowMajorMatrix > ConstMatrixMap;
+
   std::vector< std::shared_ptr< Action > >* m_actions;
   std::vector< std::string >* m_activeAgents;
+  std::vector< AgentIndex > m_agentIndices;
+
+  // Geometry of the current stage, shared by the actions
+  Kinematics m_kinematics;
+
+  // Workspaces, sized once by activateAgents()
+  int m_numAgents;
+  std::vector< double > m_accel;
+  std::vector< double > m_partials;
+
+  unsigned long m_numCalls;
+  unsigned long m_numJacobians;
+
+  // Frozen Jacobian mode, and the acceleration partials held at the
+  // start and end times of a step
+  bool m_frozenJacobian;
+  bool m_jacobianHeld;
+  std::vector< double > m_startPartials;
+  std::vector< double > m_endPartials;
+  double m_startTime;
+  double m_endTime;
+
+  // Evaluate the acceleration partials at "state" into "partials"
+  void evaluatePartials( const double *state, double t,
+                         std::vector< double > &partials );
+
   /// @todo this needs to go eventually
-  const bool m_debug = false;
+  static const bool m_debug = false;
 };
 
 #endif // EKF_ODEINTHELPER_HEADER_GUARD
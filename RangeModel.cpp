@@ -0,0 +1,300 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    RangeModel.cpp
+/// @brief   Range and range-rate from ground stations, with partials,
+///          for blocks of observations at once.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+// ekf Library
+#include <RangeModel.hpp>
+
+//=====================================================================
+//=====================================================================
+// RangeBlock
+
+RangeBlock::
+RangeBlock()
+{
+}
+
+RangeBlock::
+RangeBlock( std::size_t size )
+{
+  resize( size );
+}
+
+void
+RangeBlock::
+resize( std::size_t size )
+{
+  time.resize( size );
+  station.resize( size );
+  range.resize( size );
+  rangeRate.resize( size );
+  cosAngle.resize( size );
+  sinAngle.resize( size );
+  inverseRange.resize( size );
+  for ( int i = 0; i < 3; ++i )
+  {
+    position[i].resize( size );
+    velocity[i].resize( size );
+    lineOfSight[i].resize( size );
+    rangeRateWrtPosition[i].resize( size );
+    rangeWrtStation[i].resize( size );
+    rangeRateWrtStation[i].resize( size );
+    stationFixed[i].resize( size );
+    relativeVelocity[i].resize( size );
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, a body that does not rotate
+RangeModel::
+RangeModel()
+    : m_rotation( 0.0 ),
+      m_theta0( 0.0 ),
+      m_known(),
+      m_numAgents( 0 )
+{
+}
+
+// Constructor with the body rotation rate and angle at time zero
+RangeModel::
+RangeModel(
+    double rotationRate,
+    double theta0 )
+    : m_rotation( rotationRate ),
+      m_theta0( theta0 ),
+      m_known(),
+      m_numAgents( 0 )
+{
+}
+
+// Default Destructor
+RangeModel::
+~RangeModel()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Set the body-fixed coordinates of a station
+void
+RangeModel::
+addStation(
+    int id,
+    double x,
+    double y,
+    double z )
+{
+  if ( id < 0 )
+  {
+    throw std::invalid_argument( "RangeModel::addStation: negative id" );
+  }
+  std::size_t size = std::max( m_known.size(), std::size_t( id + 1 ) );
+  m_known.resize( size, false );
+  double coordinates[3] = { x, y, z };
+  for ( int c = 0; c < 3; ++c )
+  {
+    m_stations[c].resize( size, 0.0 );
+    m_stations[c][id] = coordinates[c];
+  }
+  m_known[id] = true;
+}
+
+// Find the station coordinate agents X_k, Y_k, Z_k among the active
+// agents
+void
+RangeModel::
+indexAgents( const std::vector< std::string > &activeAgents )
+{
+  static const std::string kAxes = "XYZ";
+  for ( int c = 0; c < 3; ++c )
+  {
+    m_agentIndex[c].clear();
+  }
+  m_numAgents = activeAgents.size();
+
+  for ( std::size_t j = 0; j < activeAgents.size(); ++j )
+  {
+    const std::string &name = activeAgents[j];
+    std::size_t axis = kAxes.find( name[0] );
+    if ( ( name.size() < 3 ) || ( axis == std::string::npos ) ||
+         ( name[1] != '_' ) ||
+         ( name.find_first_not_of( "0123456789", 2 ) != std::string::npos ) )
+    {
+      continue;
+    }
+    std::size_t id = std::atoi( name.c_str() + 2 );
+    for ( int c = 0; c < 3; ++c )
+    {
+      if ( m_agentIndex[c].size() <= id )
+      {
+        m_agentIndex[c].resize( id + 1, -1 );
+      }
+    }
+    m_agentIndex[axis][id] = j;
+  }
+}
+
+// Range, range-rate and partials of a block of observations. With S
+// the inertial station position, rho = r - S, u = rho / |rho| and
+// dv = v - w x S:
+//
+//   range = |rho|,  range-rate = u . dv
+//   d range / d r = u,  d range-rate / d v = u
+//   d range-rate / d r = ( dv - range-rate u ) / range
+//
+// and the station partials follow from S = R( theta ) s with s the
+// body-fixed coordinates.
+void
+RangeModel::
+evaluate( RangeBlock &block ) const
+{
+  const std::size_t n = block.size();
+  const double w = m_rotation;
+
+  // Gather the body-fixed station coordinates
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    int id = block.station[i];
+    if ( ( id < 0 ) || ( std::size_t( id ) >= m_known.size() ) ||
+         !m_known[id] )
+    {
+      throw std::out_of_range( "RangeModel::evaluate: unknown station " +
+                               std::to_string( id ) );
+    }
+    for ( int c = 0; c < 3; ++c )
+    {
+      block.stationFixed[c]( i ) = m_stations[c][id];
+    }
+  }
+
+  // Body rotation at each epoch. One loop over both, so the compiler
+  // makes a single sincos call per observation; observations sharing an
+  // epoch, like the range and range-rate of one sample, share it.
+  for ( std::size_t i = 0; i < n; ++i )
+  {
+    if ( ( i > 0 ) && ( block.time( i ) == block.time( i - 1 ) ) )
+    {
+      block.cosAngle( i ) = block.cosAngle( i - 1 );
+      block.sinAngle( i ) = block.sinAngle( i - 1 );
+      continue;
+    }
+    double angle = m_theta0 + w * block.time( i );
+    block.cosAngle( i ) = std::cos( angle );
+    block.sinAngle( i ) = std::sin( angle );
+  }
+  const Eigen::ArrayXd &c = block.cosAngle;
+  const Eigen::ArrayXd &s = block.sinAngle;
+  const Eigen::ArrayXd *sf = block.stationFixed;
+
+  // Relative position, kept in lineOfSight until normalized, and
+  // relative velocity
+  Eigen::ArrayXd *u = block.lineOfSight;
+  Eigen::ArrayXd *dv = block.relativeVelocity;
+  u[0] = block.position[0] - ( c * sf[0] - s * sf[1] );
+  u[1] = block.position[1] - ( s * sf[0] + c * sf[1] );
+  u[2] = block.position[2] - sf[2];
+  dv[0] = block.velocity[0] + w * ( s * sf[0] + c * sf[1] );
+  dv[1] = block.velocity[1] - w * ( c * sf[0] - s * sf[1] );
+  dv[2] = block.velocity[2];
+
+  // One division per observation
+  block.range = ( u[0].square() + u[1].square() + u[2].square() ).sqrt();
+  Eigen::ArrayXd &inverse = block.inverseRange;
+  inverse = block.range.inverse();
+  for ( int k = 0; k < 3; ++k )
+  {
+    u[k] *= inverse;
+  }
+  block.rangeRate = u[0] * dv[0] + u[1] * dv[1] + u[2] * dv[2];
+
+  Eigen::ArrayXd *rrPos = block.rangeRateWrtPosition;
+  for ( int k = 0; k < 3; ++k )
+  {
+    rrPos[k] = ( dv[k] - block.rangeRate * u[k] ) * inverse;
+  }
+
+  // Station partials: -u and -rrPos through rho, plus the station
+  // velocity term of range-rate, rotated back to body-fixed axes
+  block.rangeWrtStation[0] = -( c * u[0] + s * u[1] );
+  block.rangeWrtStation[1] = s * u[0] - c * u[1];
+  block.rangeWrtStation[2] = -u[2];
+  block.rangeRateWrtStation[0] = c * ( -rrPos[0] - w * u[1] ) +
+                                 s * ( -rrPos[1] + w * u[0] );
+  block.rangeRateWrtStation[1] = -s * ( -rrPos[0] - w * u[1] ) +
+                                 c * ( -rrPos[1] + w * u[0] );
+  block.rangeRateWrtStation[2] = -rrPos[2];
+}
+
+// Range partials row of observation i
+void
+RangeModel::
+rangePartials(
+    const RangeBlock &block,
+    std::size_t i,
+    double *row ) const
+{
+  std::fill( row, row + m_numAgents, 0.0 );
+  for ( int k = 0; k < 3; ++k )
+  {
+    row[k] = block.lineOfSight[k]( i );
+  }
+  stationPartials( block.rangeWrtStation, block, i, row );
+}
+
+// Range-rate partials row of observation i
+void
+RangeModel::
+rangeRatePartials(
+    const RangeBlock &block,
+    std::size_t i,
+    double *row ) const
+{
+  std::fill( row, row + m_numAgents, 0.0 );
+  for ( int k = 0; k < 3; ++k )
+  {
+    row[k] = block.rangeRateWrtPosition[k]( i );
+    row[ 3 + k ] = block.lineOfSight[k]( i );
+  }
+  stationPartials( block.rangeRateWrtStation, block, i, row );
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Scatter the station partials of observation i into the columns of
+// its active station coordinate agents
+void
+RangeModel::
+stationPartials(
+    const Eigen::ArrayXd *wrtStation,
+    const RangeBlock &block,
+    std::size_t i,
+    double *row ) const
+{
+  std::size_t id = block.station[i];
+  for ( int c = 0; c < 3; ++c )
+  {
+    if ( ( id < m_agentIndex[c].size() ) && ( m_agentIndex[c][id] >= 0 ) )
+    {
+      row[ m_agentIndex[c][id] ] = wrtStation[c]( i );
+    }
+  }
+}
@@ -0,0 +1,126 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    RangeModel.hpp
+/// @brief   Range and range-rate from ground stations, with partials,
+///          for blocks of observations at once.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_RANGEMODEL_HEADER_GUARD
+#define EKF_RANGEMODEL_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+/// @brief A block of range and range-rate observations, one array
+/// element per observation.
+///
+/// The caller fills time, station and the spacecraft position and
+/// velocity; RangeModel::evaluate fills the rest. Every array is sized
+/// once by resize(), so evaluating a block does not allocate.
+///
+struct RangeBlock
+{
+  // Inputs: time, station id and inertial spacecraft state
+  Eigen::ArrayXd time;
+  std::vector< int > station;
+  Eigen::ArrayXd position[3];
+  Eigen::ArrayXd velocity[3];
+
+  // Outputs: computed range and range-rate
+  Eigen::ArrayXd range;
+  Eigen::ArrayXd rangeRate;
+
+  // Partials of range with respect to the spacecraft position, i.e.
+  // the unit line of sight. They are also the partials of range-rate
+  // with respect to the spacecraft velocity; range has none.
+  Eigen::ArrayXd lineOfSight[3];
+  // Partials of range-rate with respect to the spacecraft position
+  Eigen::ArrayXd rangeRateWrtPosition[3];
+  // Partials with respect to the body-fixed station coordinates
+  Eigen::ArrayXd rangeWrtStation[3];
+  Eigen::ArrayXd rangeRateWrtStation[3];
+
+  // Workspaces: body rotation per epoch, body-fixed station
+  // coordinates gathered per observation, the inverse range and the
+  // relative velocity
+  Eigen::ArrayXd cosAngle;
+  Eigen::ArrayXd sinAngle;
+  Eigen::ArrayXd inverseRange;
+  Eigen::ArrayXd stationFixed[3];
+  Eigen::ArrayXd relativeVelocity[3];
+
+  RangeBlock();
+  explicit RangeBlock( std::size_t size );
+
+  // Number of observations
+  std::size_t size() const { return station.size(); }
+  // Size every array for "size" observations
+  void resize( std::size_t size );
+};
+
+/// @brief Range and range-rate from ground stations, with partials.
+///
+/// Stations are fixed to a body rotating about Z at a constant rate, at
+/// angle theta0 at time zero, as in AtmosphereAction. Station k has the
+/// body-fixed coordinates set with addStation and is estimated through
+/// the agents X_k, Y_k, Z_k. Range is the instantaneous geometric
+/// distance, without light time or media corrections.
+///
+/// evaluate() works on a whole RangeBlock with Eigen array expressions,
+/// so the compiler vectorizes the work over observations. The body
+/// rotation of each epoch is computed once per observation up front,
+/// and then every quantity is a straight-line SIMD kernel over the
+/// block.
+///
+class RangeModel
+{
+ public:
+  RangeModel();
+  RangeModel( double rotationRate, double theta0 = 0.0 );
+ ~RangeModel();
+
+  // Set the body-fixed coordinates of station "id"
+  void addStation( int id, double x, double y, double z );
+
+  // Resolve station coordinate agents X_k, Y_k, Z_k against the
+  // active agents, for the partials rows
+  void indexAgents( const std::vector< std::string > &activeAgents );
+
+  // Compute range, range-rate and their partials for every observation
+  // of "block". Throws std::out_of_range for an unknown station.
+  void evaluate( RangeBlock &block ) const;
+
+  // Write the partials of observation i of an evaluated block with
+  // respect to the active agents to "row", which must hold one element
+  // per active agent. Inactive station coordinates are left out.
+  void rangePartials( const RangeBlock &block, std::size_t i,
+                      double *row ) const;
+  void rangeRatePartials( const RangeBlock &block, std::size_t i,
+                          double *row ) const;
+
+ private:
+  double m_rotation;
+  double m_theta0;
+  // Body-fixed coordinates by station id, and whether the id is set
+  std::vector< double > m_stations[3];
+  std::vector< bool > m_known;
+  // Position of the station coordinates in the active agents, by
+  // station id, or -1 if not active
+  std::vector< int > m_agentIndex[3];
+  std::size_t m_numAgents;
+
+  void stationPartials( const Eigen::ArrayXd *wrtStation,
+                        const RangeBlock &block, std::size_t i,
+                        double *row ) const;
+};
+
+#endif // EKF_RANGEMODEL_HEADER_GUARD
@@ -0,0 +1,610 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SphericalHarmonicAction.cpp
+/// @brief   Computes state accelerations and partials due to a high
+///          degree spherical harmonic gravity field.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <SphericalHarmonicAction.hpp>
+
+namespace
+{
+
+// Harmonics V and W of one evaluation, by GravityField::index( n, m )
+template< typename T >
+struct Harmonics
+{
+  std::vector< T, Eigen::aligned_allocator< T > > V;
+  std::vector< T, Eigen::aligned_allocator< T > > W;
+};
+
+// This thread's harmonics, holding at least up to "degree"
+template< typename T >
+Harmonics< T >&
+harmonicsWorkspace( int degree )
+{
+  static thread_local Harmonics< T > harmonics;
+  std::size_t size = GravityField::index( degree + 1, 0 );
+  if ( harmonics.V.size() < size )
+  {
+    harmonics.V.resize( size );
+    harmonics.W.resize( size );
+  }
+  return harmonics;
+}
+
+// a! / b! for a and b a few apart
+double
+factorialRatio( int a, int b )
+{
+  double ratio = 1.0;
+  for ( int i = b + 1; i <= a; ++i )
+  {
+    ratio *= i;
+  }
+  for ( int i = a + 1; i <= b; ++i )
+  {
+    ratio /= i;
+  }
+  return ratio;
+}
+
+// N_nm / N_kl for neighbouring degrees and orders, with
+//   N_nm = sqrt( ( 2 - delta_m0 ) ( 2n + 1 ) ( n - m )! / ( n + m )! )
+// from the few factors the factorials differ by
+double
+normalizationRatio( int n, int m, int k, int l )
+{
+  double ratio = ( ( m == 0 ) ? 1.0 : 2.0 ) * ( 2 * n + 1 ) /
+                 ( ( ( l == 0 ) ? 1.0 : 2.0 ) * ( 2 * k + 1 ) );
+  ratio *= factorialRatio( n - m, k - l ) * factorialRatio( k + l, n + m );
+  return std::sqrt( ratio );
+}
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, no field
+SphericalHarmonicAction::
+SphericalHarmonicAction()
+    : m_name(),
+      m_field(),
+      m_rotation( 0.0 ),
+      m_theta0( 0.0 ),
+      m_degree( -1 ),
+      m_tolerance( 1.E-12 )
+{
+}
+
+// Constructor with the field, and the body rotation rate and angle at
+// time zero
+SphericalHarmonicAction::
+SphericalHarmonicAction(
+    const std::string name,
+    std::shared_ptr< const GravityField > field,
+    double rotation,
+    double theta0 )
+    : m_name( name ),
+      m_field( field ),
+      m_rotation( rotation ),
+      m_theta0( theta0 ),
+      m_degree( -1 ),
+      m_tolerance( 1.E-12 )
+{
+  if ( !m_field || ( m_field->getDegree() < 0 ) )
+  {
+    throw std::invalid_argument(
+      "SphericalHarmonicAction: empty gravity field" );
+  }
+  m_degree = m_field->getDegree();
+
+  // The recursion factors of harmonics(), with the gradient needing the
+  // harmonics two degrees beyond the field
+  int degree = m_degree + 2;
+  m_recursionA.assign( GravityField::index( degree + 1, 0 ), 0.0 );
+  m_recursionB.assign( GravityField::index( degree + 1, 0 ), 0.0 );
+  for ( int n = 1; n <= degree; ++n )
+  {
+    std::size_t row = GravityField::index( n, 0 );
+    for ( int m = 0; m < n; ++m )
+    {
+      m_recursionA[ row + m ] = double( 2 * n - 1 ) / ( n - m ) *
+                                normalizationRatio( n, m, n - 1, m );
+      if ( m < n - 1 )
+      {
+        m_recursionB[ row + m ] = double( n + m - 1 ) / ( n - m ) *
+                                  normalizationRatio( n, m, n - 2, m );
+      }
+    }
+    m_recursionA[ row + n ] =
+      ( 2 * n - 1 ) * normalizationRatio( n, n, n - 1, n - 1 );
+  }
+
+  // The factors of sumAcceleration() and sumGradient(), with k = n - m
+  m_accelerationFactors.resize( GravityField::index( m_degree + 1, 0 ) );
+  m_gradientFactors.resize( GravityField::index( m_degree + 1, 0 ) );
+  for ( int n = 0; n <= m_degree; ++n )
+  {
+    for ( int m = 0; m <= n; ++m )
+    {
+      double k = n - m;
+      AccelerationFactors &a =
+        m_accelerationFactors[ GravityField::index( n, m ) ];
+      a.plus = normalizationRatio( n, m, n + 1, m + 1 );
+      a.minus = ( m > 0 ) ? ( k + 2 ) * ( k + 1 ) *
+                            normalizationRatio( n, m, n + 1, m - 1 ) : 0.0;
+      a.z = ( k + 1 ) * normalizationRatio( n, m, n + 1, m );
+
+      GradientFactors &g = m_gradientFactors[ GravityField::index( n, m ) ];
+      g.a = normalizationRatio( n, m, n + 2, m + 2 );
+      g.z = ( k + 1 ) * ( k + 2 ) * normalizationRatio( n, m, n + 2, m );
+      g.p = ( k + 1 ) * normalizationRatio( n, m, n + 2, m + 1 );
+      g.m = ( m > 0 ) ? -( k + 1 ) * ( k + 2 ) * ( k + 3 ) *
+                        normalizationRatio( n, m, n + 2, m - 1 ) : 0.0;
+      if ( m == 1 )
+      {
+        g.b = -double( n ) * ( n + 1 ) *
+              normalizationRatio( n, 1, n + 2, 1 );
+      }
+      else if ( m > 1 )
+      {
+        g.b = ( k + 1 ) * ( k + 2 ) * ( k + 3 ) * ( k + 4 ) *
+              normalizationRatio( n, m, n + 2, m - 2 );
+      }
+      else
+      {
+        g.b = 0.0;
+      }
+    }
+  }
+  updateCutoff();
+}
+
+// Default Destructor
+SphericalHarmonicAction::
+~SphericalHarmonicAction()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Computes the acceleration of the field to the degree for the
+// distance from the body center
+void
+SphericalHarmonicAction::
+getAcceleration(
+    double *acceleration,
+    const Kinematics &kinematics ) const
+{
+  if ( m_degree < 0 )
+  {
+    return;
+  }
+  double c, s;
+  bodyRotation( kinematics.time, c, s );
+  const double *x = kinematics.position;
+  double position[3] = { c * x[0] + s * x[1], c * x[1] - s * x[0], x[2] };
+
+  int degree = getDegree( kinematics.r );
+  Harmonics< double > &h = harmonicsWorkspace< double >( degree + 1 );
+  harmonics( position, degree + 1, h.V.data(), h.W.data() );
+  double a[3];
+  sumAcceleration( h.V.data(), h.W.data(), degree, a );
+
+  double R = m_field->getRadius();
+  double scale = m_field->getMu() / ( R * R );
+  acceleration[0] += scale * ( c * a[0] - s * a[1] );
+  acceleration[1] += scale * ( s * a[0] + c * a[1] );
+  acceleration[2] += scale * a[2];
+}
+
+// Computes the acceleration as in getAcceleration() and its partials:
+// the gradient from the harmonics two degrees up, rotated to inertial
+// axes as R^T G R, and the GM partial, since the acceleration is linear
+// in GM.
+void
+SphericalHarmonicAction::
+evaluate(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  if ( m_degree < 0 )
+  {
+    return;
+  }
+  double c, s;
+  bodyRotation( kinematics.time, c, s );
+  const double *x = kinematics.position;
+  double position[3] = { c * x[0] + s * x[1], c * x[1] - s * x[0], x[2] };
+
+  int degree = getDegree( kinematics.r );
+  Harmonics< double > &h = harmonicsWorkspace< double >( degree + 2 );
+  harmonics( position, degree + 2, h.V.data(), h.W.data() );
+  double a[3];
+  double g[6];
+  sumAcceleration( h.V.data(), h.W.data(), degree, a );
+  sumGradient( h.V.data(), h.W.data(), degree, g );
+
+  double mu = m_field->getMu();
+  double R = m_field->getRadius();
+  double scale = mu / ( R * R );
+  Eigen::Matrix3d rotation;
+  rotation << c, s, 0.0,
+             -s, c, 0.0,
+              0.0, 0.0, 1.0;
+  Eigen::Vector3d bodyAcceleration( a[0], a[1], a[2] );
+  Eigen::Matrix3d gradient;
+  gradient << g[0], g[1], g[2],
+              g[1], g[3], g[4],
+              g[2], g[4], g[5];
+  Eigen::Vector3d inertial =
+    scale * ( rotation.transpose() * bodyAcceleration );
+  gradient = ( scale / R ) * ( rotation.transpose() * gradient * rotation );
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += inertial( i );
+    addPartial( partials, index, i, kX, gradient( i, 0 ) );
+    addPartial( partials, index, i, kY, gradient( i, 1 ) );
+    addPartial( partials, index, i, kZ, gradient( i, 2 ) );
+    addPartial( partials, index, i, kMu, inertial( i ) / mu );
+  }
+}
+
+// Computes the acceleration as in getAcceleration() and its partials
+// by differentiating the recursion and sum with Duals seeded on the
+// inertial position and GM.
+void
+SphericalHarmonicAction::
+evaluateAutomatic(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  if ( m_degree < 0 )
+  {
+    return;
+  }
+  double c, s;
+  bodyRotation( kinematics.time, c, s );
+  Scalar x[3];
+  for ( int i = 0; i < 3; ++i )
+  {
+    x[i] = Scalar::variable( kinematics.position[i], i );
+  }
+  Scalar position[3] = { c * x[0] + s * x[1], c * x[1] - s * x[0], x[2] };
+
+  int degree = getDegree( kinematics.r );
+  Harmonics< Scalar > &h = harmonicsWorkspace< Scalar >( degree + 1 );
+  harmonics( position, degree + 1, h.V.data(), h.W.data() );
+  Scalar a[3];
+  sumAcceleration( h.V.data(), h.W.data(), degree, a );
+
+  double R = m_field->getRadius();
+  Scalar scale = Scalar::variable( m_field->getMu(), 3 ) / ( R * R );
+  Scalar inertial[3] = { scale * ( c * a[0] - s * a[1] ),
+                         scale * ( s * a[0] + c * a[1] ),
+                         scale * a[2] };
+  const OwnedAgent variables[4] = { kX, kY, kZ, kMu };
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += inertial[i].value;
+    for ( int j = 0; j < 4; ++j )
+    {
+      addPartial( partials, index, i, variables[j], inertial[i].d( j ) );
+    }
+  }
+}
+
+// Names of the agents this action owns partials for
+const std::vector< std::string >&
+SphericalHarmonicAction::
+getAgentsOwned() const
+{
+  return m_agentsOwned;
+}
+
+// Rotation rate of the body carrying the field
+double
+SphericalHarmonicAction::
+getRotationRate() const
+{
+  return m_rotation;
+}
+
+// Limit the field to a degree
+void
+SphericalHarmonicAction::
+setDegree( int degree )
+{
+  if ( !m_field || ( degree < 0 ) || ( degree > m_field->getDegree() ) )
+  {
+    throw std::invalid_argument( "SphericalHarmonicAction: degree " +
+                                 std::to_string( degree ) +
+                                 " out of range" );
+  }
+  m_degree = degree;
+  updateCutoff();
+}
+
+// Set the truncation tolerance
+void
+SphericalHarmonicAction::
+setTruncation( double tolerance )
+{
+  m_tolerance = tolerance;
+  updateCutoff();
+}
+
+// Highest degree whose cutoff lies beyond "r". The cutoffs do not
+// increase with the degree, so this is the first found from the top.
+int
+SphericalHarmonicAction::
+getDegree( double r ) const
+{
+  int degree = m_degree;
+  while ( ( degree > 0 ) && ( r >= m_cutoff[ degree ] ) )
+  {
+    --degree;
+  }
+  return degree;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Degree n matters inside the distance where
+//   ( n + 1 ) ( R / r )^n amplitude_n = tolerance,
+// and below every higher degree that does.
+void
+SphericalHarmonicAction::
+updateCutoff()
+{
+  const double kInfinity = std::numeric_limits< double >::infinity();
+  m_cutoff.assign( m_degree + 1, kInfinity );
+  if ( m_tolerance <= 0.0 )
+  {
+    return;
+  }
+  double R = m_field->getRadius();
+  for ( int n = m_degree; n > 0; --n )
+  {
+    double size = ( n + 1 ) * m_field->getDegreeAmplitude( n );
+    m_cutoff[n] = R * std::pow( size / m_tolerance, 1.0 / n );
+    if ( n < m_degree )
+    {
+      m_cutoff[n] = std::max( m_cutoff[n], m_cutoff[ n + 1 ] );
+    }
+  }
+}
+
+// Cosine and sine of the body rotation angle
+void
+SphericalHarmonicAction::
+bodyRotation(
+    double time,
+    double &cosAngle,
+    double &sinAngle ) const
+{
+  double angle = m_theta0 + m_rotation * time;
+  cosAngle = std::cos( angle );
+  sinAngle = std::sin( angle );
+}
+
+// Cunningham's recursion, one degree at a time. With
+// ( x0, y0, z0 ) = R position / r^2 and rho = R^2 / r^2:
+//
+//   V_nn = ( 2n - 1 ) ( x0 V_n-1,n-1 - y0 W_n-1,n-1 )
+//   W_nn = ( 2n - 1 ) ( x0 W_n-1,n-1 + y0 V_n-1,n-1 )
+//   V_nm = ( ( 2n - 1 ) z0 V_n-1,m - ( n + m - 1 ) rho V_n-2,m ) / ( n - m )
+//
+// and the same for W_nm, with V_n-2,m taken as zero for m = n - 1. The
+// normalized harmonics follow the same steps, each factor multiplied
+// by N_nm over the N of the harmonic it multiplies, as held in
+// m_recursionA and m_recursionB.
+template< typename T >
+void
+SphericalHarmonicAction::
+harmonics(
+    const T *position,
+    int degree,
+    T *V,
+    T *W ) const
+{
+  double R = m_field->getRadius();
+  T r2 = position[0] * position[0] + position[1] * position[1] +
+         position[2] * position[2];
+  T invR2 = 1.0 / r2;
+  T x0 = R * position[0] * invR2;
+  T y0 = R * position[1] * invR2;
+  T z0 = R * position[2] * invR2;
+  T rho = ( R * R ) * invR2;
+
+  V[0] = R * sqrt( invR2 );
+  W[0] = T( 0.0 );
+  for ( int n = 1; n <= degree; ++n )
+  {
+    std::size_t row = GravityField::index( n, 0 );
+    std::size_t previous = GravityField::index( n - 1, 0 );
+    std::size_t before = ( n > 1 ) ? GravityField::index( n - 2, 0 ) : 0;
+    const double *a = &m_recursionA[ row ];
+    const double *b = &m_recursionB[ row ];
+    for ( int m = 0; m < n - 1; ++m )
+    {
+      V[ row + m ] = a[m] * z0 * V[ previous + m ] -
+                     b[m] * rho * V[ before + m ];
+      W[ row + m ] = a[m] * z0 * W[ previous + m ] -
+                     b[m] * rho * W[ before + m ];
+    }
+    const T &Vd = V[ previous + n - 1 ];
+    const T &Wd = W[ previous + n - 1 ];
+    V[ row + n - 1 ] = a[ n - 1 ] * z0 * Vd;
+    W[ row + n - 1 ] = a[ n - 1 ] * z0 * Wd;
+    V[ row + n ] = a[n] * ( x0 * Vd - y0 * Wd );
+    W[ row + n ] = a[n] * ( x0 * Wd + y0 * Vd );
+  }
+}
+
+// Montenbruck and Gill 3.33: with f = ( n - m + 2 ) ( n - m + 1 ),
+//
+//   ax = -C V_n+1,1                                       m = 0
+//      = ( -C V_n+1,m+1 - S W_n+1,m+1
+//          + f ( C V_n+1,m-1 + S W_n+1,m-1 ) ) / 2          m > 0
+//   ay = -C W_n+1,1                                       m = 0
+//      = ( -C W_n+1,m+1 + S V_n+1,m+1
+//          + f ( -C W_n+1,m-1 + S V_n+1,m-1 ) ) / 2         m > 0
+//   az = ( n - m + 1 ) ( -C V_n+1,m - S W_n+1,m )
+//
+// S_n0 is ignored, as W_n0 is zero. With normalized coefficients and
+// harmonics, the factors of V_n+1,m+1, V_n+1,m-1 and V_n+1,m carry
+// their N ratios, as held in m_accelerationFactors.
+template< typename T >
+void
+SphericalHarmonicAction::
+sumAcceleration(
+    const T *V,
+    const T *W,
+    int degree,
+    T *acceleration ) const
+{
+  const double *C = m_field->getC().data();
+  const double *S = m_field->getS().data();
+  T zonalX( 0.0 ), zonalY( 0.0 ), tesseralX( 0.0 ), tesseralY( 0.0 );
+  T az( 0.0 );
+  for ( int n = 0; n <= degree; ++n )
+  {
+    std::size_t row = GravityField::index( n, 0 );
+    std::size_t next = GravityField::index( n + 1, 0 );
+    const AccelerationFactors *f = &m_accelerationFactors[ row ];
+    zonalX = zonalX - ( f[0].plus * C[ row ] ) * V[ next + 1 ];
+    zonalY = zonalY - ( f[0].plus * C[ row ] ) * W[ next + 1 ];
+    az = az - ( f[0].z * C[ row ] ) * V[ next ];
+    for ( int m = 1; m <= n; ++m )
+    {
+      double c = C[ row + m ];
+      double s = S[ row + m ];
+      const T &Vp = V[ next + m + 1 ];
+      const T &Wp = W[ next + m + 1 ];
+      const T &Vm = V[ next + m - 1 ];
+      const T &Wm = W[ next + m - 1 ];
+      tesseralX = tesseralX + ( f[m].minus * ( c * Vm + s * Wm ) -
+                                f[m].plus * ( c * Vp + s * Wp ) );
+      tesseralY = tesseralY + ( f[m].minus * ( s * Vm - c * Wm ) +
+                                f[m].plus * ( s * Vp - c * Wp ) );
+      az = az - f[m].z * ( c * V[ next + m ] + s * W[ next + m ] );
+    }
+  }
+  acceleration[0] = zonalX + 0.5 * tesseralX;
+  acceleration[1] = zonalY + 0.5 * tesseralY;
+  acceleration[2] = az;
+}
+
+// The derivatives of Y_nm = V_nm + i W_nm are simplest through
+// D+ = d/dx + i d/dy, D- = d/dx - i d/dy and d/dz. With k = n - m and
+// lengths in units of R:
+//
+//   D+ Y_nm = -Y_n+1,m+1
+//   D- Y_nm = ( k + 2 ) ( k + 1 ) Y_n+1,m-1,  D- Y_n0 = -conj( Y_n+1,1 )
+//   Dz Y_nm = -( k + 1 ) Y_n+1,m
+//
+// Applying them twice gives, for the terms of degree n + 2,
+//
+//   A = D+ D+ Y = Y_n+2,m+2
+//   B = D- D- Y = ( k + 1 ) ( k + 2 ) ( k + 3 ) ( k + 4 ) Y_n+2,m-2
+//       ( -n ( n + 1 ) conj( Y_n+2,1 ) for m = 1, conj( Y_n+2,2 ) for m = 0 )
+//   Z = Dz Dz Y = ( k + 1 ) ( k + 2 ) Y_n+2,m = -D+ D- Y
+//   P = D+ Dz Y = ( k + 1 ) Y_n+2,m+1
+//   M = D- Dz Y = -( k + 1 ) ( k + 2 ) ( k + 3 ) Y_n+2,m-1
+//       ( ( n + 1 ) conj( Y_n+2,1 ) for m = 0 )
+//
+// and, term by term, with re( Y ) = Re( ( C - i S ) Y ) and
+// im( Y ) = Re( -i ( C - i S ) Y ):
+//
+//   XX = re( A + B - 2 Z ) / 4,  YY = -re( A + B + 2 Z ) / 4,  ZZ = re( Z )
+//   XY = im( A - B ) / 4,  XZ = re( P + M ) / 2,  YZ = im( P - M ) / 2
+//
+// With normalized coefficients and harmonics, the factors of A, B, Z, P
+// and M carry their N ratios, as held in m_gradientFactors.
+void
+SphericalHarmonicAction::
+sumGradient(
+    const double *V,
+    const double *W,
+    int degree,
+    double *gradient ) const
+{
+  const double *C = m_field->getC().data();
+  const double *S = m_field->getS().data();
+  double sumAB = 0.0, sumZ = 0.0, sumXY = 0.0, sumXZ = 0.0, sumYZ = 0.0;
+  for ( int n = 0; n <= degree; ++n )
+  {
+    std::size_t row = GravityField::index( n, 0 );
+    const double *V2 = V + GravityField::index( n + 2, 0 );
+    const double *W2 = W + GravityField::index( n + 2, 0 );
+    const GradientFactors *f = &m_gradientFactors[ row ];
+
+    // m = 0, where B and M are the conjugates of A and P
+    double c = C[ row ];
+    sumAB += 2 * f[0].a * c * V2[2];
+    sumXY += 2 * f[0].a * c * W2[2];
+    sumZ += f[0].z * c * V2[0];
+    sumXZ += 2 * f[0].p * c * V2[1];
+    sumYZ += 2 * f[0].p * c * W2[1];
+
+    for ( int m = 1; m <= n; ++m )
+    {
+      c = C[ row + m ];
+      double s = S[ row + m ];
+      const GradientFactors &g = f[m];
+
+      double reB, imB;
+      if ( m == 1 )
+      {
+        reB = g.b * ( c * V2[1] - s * W2[1] );
+        imB = g.b * ( -c * W2[1] - s * V2[1] );
+      }
+      else
+      {
+        reB = g.b * ( c * V2[ m - 2 ] + s * W2[ m - 2 ] );
+        imB = g.b * ( c * W2[ m - 2 ] - s * V2[ m - 2 ] );
+      }
+
+      sumAB += g.a * ( c * V2[ m + 2 ] + s * W2[ m + 2 ] ) + reB;
+      sumXY += g.a * ( c * W2[ m + 2 ] - s * V2[ m + 2 ] ) - imB;
+      sumZ += g.z * ( c * V2[m] + s * W2[m] );
+      sumXZ += g.p * ( c * V2[ m + 1 ] + s * W2[ m + 1 ] ) +
+               g.m * ( c * V2[ m - 1 ] + s * W2[ m - 1 ] );
+      sumYZ += g.p * ( c * W2[ m + 1 ] - s * V2[ m + 1 ] ) -
+               g.m * ( c * W2[ m - 1 ] - s * V2[ m - 1 ] );
+    }
+  }
+
+  gradient[0] = 0.25 * ( sumAB - 2 * sumZ );
+  gradient[1] = 0.25 * sumXY;
+  gradient[2] = 0.5 * sumXZ;
+  gradient[3] = -0.25 * ( sumAB + 2 * sumZ );
+  gradient[4] = 0.5 * sumYZ;
+  gradient[5] = sumZ;
+}
@@ -0,0 +1,192 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    SphericalHarmonicAction.hpp
+/// @brief   Computes state accelerations and partials due to a high
+///          degree spherical harmonic gravity field.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_SPHERICALHARMONICACTION_HEADER_GUARD
+#define EKF_SPHERICALHARMONICACTION_HEADER_GUARD
+
+// C++ Standard Library
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Dual.hpp>
+#include <GravityField.hpp>
+
+/// @brief Compute state accelerations and partial derivates due to
+/// the full spherical harmonic gravity field of a body.
+///
+/// The field is a GravityField fixed to a body rotating about Z at a
+/// constant rate, at angle theta0 at time zero, as in RangeModel. The
+/// position is rotated to body-fixed axes at the Kinematics time, and
+/// the acceleration and its gradient are rotated back. The central
+/// term is the degree 0 coefficient, so this replaces GravityAction
+/// rather than adding to it.
+///
+/// The potential is summed over Cunningham's harmonics
+///
+///   V_nm + i W_nm = ( R / r )^( n + 1 ) P_nm( sin lat ) exp( i m lon )
+///
+/// built from V_00 = R / r by recurrences in the Cartesian coordinates
+/// ( Montenbruck and Gill, Satellite Orbits, 3.2.4 ), with no
+/// trigonometric functions and no singularity at the poles. Every
+/// derivative of a harmonic is a combination of harmonics of one degree
+/// more, so the acceleration to degree n uses them to degree n + 1 and
+/// the gradient, the position partials of the STM, to degree n + 2, all
+/// from the same recursion.
+///
+/// The un-normalized harmonics and coefficients span factorials of
+/// twice the degree and leave the range of a double past degree 150 or
+/// so. harmonics() therefore builds the normalized harmonics N_nm V_nm,
+/// N_nm W_nm, the same size as the fully normalized coefficients of the
+/// GravityField, and every factor of the recurrences and sums is folded
+/// with the ratio of the N_nm it spans into tables made once per field.
+/// The degree is then limited only by the memory of the tables and the
+/// time of the sums.
+///
+/// The degree summed falls with distance from the body center. Degree
+/// n is dropped where ( n + 1 ) ( R / r )^n times its degree amplitude,
+/// the size of its acceleration relative to the central term, is below
+/// the truncation tolerance, so high degrees only cost time close to
+/// the body.
+///
+/// This class is responsible for computing partial derivatives of the
+/// following paramters:
+///   - Cartesian state X, Y, Z, dX, dY, dZ components
+///   - Gravitational body GM
+///
+/// Actions are shared between threads, so the harmonics are kept in a
+/// per-thread workspace, grown once to the largest degree used.
+///
+class SphericalHarmonicAction : public Action
+{
+ public:
+  SphericalHarmonicAction();
+  SphericalHarmonicAction( const std::string name,
+                           std::shared_ptr< const GravityField > field,
+                           double rotation, double theta0 = 0.0 );
+
+ ~SphericalHarmonicAction() override;
+
+  // Computes the acceleration due to this action and adds it to the
+  // passed in array "acceleration".
+  void getAcceleration( double *acceleration,
+                        const Kinematics &kinematics ) const override;
+
+  // Computes the acceleration and the partial derivative of the
+  // acceleration terms wrt the owned agents
+  void evaluate( double *acceleration,
+                 double *partials,
+                 const Kinematics &kinematics,
+                 const AgentIndex &index ) const override;
+
+  // Computes the same as evaluate, differentiating the acceleration
+  // with Duals
+  void evaluateAutomatic( double *acceleration,
+                          double *partials,
+                          const Kinematics &kinematics,
+                          const AgentIndex &index ) const override;
+
+  // Names of the agents this action owns partials for
+  const std::vector< std::string >& getAgentsOwned() const override;
+
+  // Rotation rate of the body carrying the field
+  double getRotationRate() const override;
+
+  // Limit the field to "degree", at most the degree of the field.
+  // Throws std::invalid_argument if it is out of range.
+  void setDegree( int degree );
+
+  // Drop the degrees whose relative acceleration is below "tolerance",
+  // 1.E-12 by default. Zero sums every degree everywhere.
+  void setTruncation( double tolerance );
+
+  // Degree summed at distance "r" from the body center
+  int getDegree( double r ) const;
+
+ private:
+  // Position of each agent in m_agentsOwned
+  enum OwnedAgent { kX, kY, kZ, kDX, kDY, kDZ, kMu };
+
+  // Dual variables of evaluateAutomatic(): X, Y, Z and GM
+  typedef Dual< 4 > Scalar;
+
+  std::string m_name;
+  std::shared_ptr< const GravityField > m_field;
+  double m_rotation;
+  double m_theta0;
+  int m_degree;
+  double m_tolerance;
+
+  // Distance below which each degree is summed, non-increasing in the
+  // degree
+  std::vector< double > m_cutoff;
+
+  // Factors of the normalized harmonics of degree n + 1 in the
+  // acceleration of degree n, order m: those of order m + 1, m - 1 and
+  // m
+  struct AccelerationFactors
+  {
+    double plus;
+    double minus;
+    double z;
+  };
+
+  // Factors of the normalized harmonics of degree n + 2 in the gradient
+  // of degree n, order m: the A, B, Z, P and M terms of sumGradient()
+  struct GradientFactors
+  {
+    double a;
+    double b;
+    double z;
+    double p;
+    double m;
+  };
+
+  // Normalized recursion factors, by GravityField::index( n, m ): of
+  // V_n-1,m and V_n-2,m for m < n, and of the sectorial step in
+  // m_recursionA for m = n
+  std::vector< double > m_recursionA;
+  std::vector< double > m_recursionB;
+
+  // Sum factors to the degree of the field, by GravityField::index( n, m )
+  std::vector< AccelerationFactors > m_accelerationFactors;
+  std::vector< GradientFactors > m_gradientFactors;
+
+  std::vector< std::string > m_agentsOwned = { "X", "Y", "Z", "dX", "dY", "dZ",
+                                               "mu" };
+
+  // Recompute m_cutoff from the degree and tolerance
+  void updateCutoff();
+
+  // Cosine and sine of the body rotation angle at "time"
+  void bodyRotation( double time, double &cosAngle, double &sinAngle ) const;
+
+  // Normalized harmonics V and W up to "degree" at the body-fixed
+  // "position", by GravityField::index( n, m ), for any scalar type T
+  template< typename T >
+  void harmonics( const T *position, int degree, T *V, T *W ) const;
+
+  // Body-fixed acceleration of degrees 0 .. "degree", in units of
+  // GM / R^2, from harmonics up to degree + 1
+  template< typename T >
+  void sumAcceleration( const T *V, const T *W, int degree,
+                        T *acceleration ) const;
+
+  // Body-fixed gradient of the acceleration of degrees 0 .. "degree",
+  // XX, XY, XZ, YY, YZ, ZZ, in units of GM / R^3, from harmonics up to
+  // degree + 2
+  void sumGradient( const double *V, const double *W, int degree,
+                    double *gradient ) const;
+};
+
+#endif // EKF_SPHERICALHARMONICACTION_HEADER_GUARD
@@ -0,0 +1,438 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TabulatedAtmosphereAction.cpp
+/// @brief   Computes state accelerations and partials due to drag in a
+///          tabulated, piecewise exponential atmosphere.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+// ekf Library
+#include <TabulatedAtmosphereAction.hpp>
+
+namespace
+{
+
+// Vallado table 8-4: base altitude km, density kg/m^3, scale height km
+const double kStandardTable[][3] = {
+  {    0., 1.225,     7.249 }, {   25., 3.899E-2,  6.349 },
+  {   30., 1.774E-2,  6.682 }, {   40., 3.972E-3,  7.554 },
+  {   50., 1.057E-3,  8.382 }, {   60., 3.206E-4,  7.714 },
+  {   70., 8.770E-5,  6.549 }, {   80., 1.905E-5,  5.799 },
+  {   90., 3.396E-6,  5.382 }, {  100., 5.297E-7,  5.877 },
+  {  110., 9.661E-8,  7.263 }, {  120., 2.438E-8,  9.473 },
+  {  130., 8.484E-9, 12.636 }, {  140., 3.845E-9, 16.149 },
+  {  150., 2.070E-9, 22.523 }, {  180., 5.464E-10, 29.740 },
+  {  200., 2.789E-10, 37.105 }, {  250., 7.248E-11, 45.546 },
+  {  300., 2.418E-11, 53.628 }, {  350., 9.518E-12, 53.298 },
+  {  400., 3.725E-12, 58.515 }, {  450., 1.585E-12, 60.828 },
+  {  500., 6.967E-13, 63.822 }, {  600., 1.454E-13, 71.835 },
+  {  700., 3.614E-14, 88.667 }, {  800., 1.170E-14, 124.64 },
+  {  900., 5.245E-15, 181.05 }, { 1000., 3.019E-15, 268.00 } };
+
+// More cells than this means band boundaries that share no useful
+// spacing
+const long long kMaxCells = 100000;
+
+long long
+greatestCommonDivisor( long long a, long long b )
+{
+  while ( b != 0 )
+  {
+    long long t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+TabulatedAtmosphereAction::
+TabulatedAtmosphereAction()
+    : m_name(),
+      m_rotation(),
+      m_bodyDragTerm(),
+      m_baseRadius(),
+      m_cellSize(),
+      m_inverseCellSize(),
+      m_lastCell(),
+      m_cells()
+{
+}
+
+// Constructor for the default table
+TabulatedAtmosphereAction::
+TabulatedAtmosphereAction(
+    const std::string name,
+    double bodyRadius,
+    double rotation,
+    double bodyDragTerm )
+    : TabulatedAtmosphereAction( name, bodyRadius, rotation, bodyDragTerm,
+                                 standardBands() )
+{
+}
+
+// Constructor for a table of bands
+TabulatedAtmosphereAction::
+TabulatedAtmosphereAction(
+    const std::string name,
+    double bodyRadius,
+    double rotation,
+    double bodyDragTerm,
+    const std::vector< AtmosphereBand > &bands )
+    : m_name( name ),
+      m_rotation( rotation ),
+      m_bodyDragTerm( bodyDragTerm ),
+      m_baseRadius(),
+      m_cellSize(),
+      m_inverseCellSize(),
+      m_lastCell(),
+      m_cells()
+{
+  buildCells( bodyRadius, bands );
+}
+
+// Default Destructor
+TabulatedAtmosphereAction::
+~TabulatedAtmosphereAction()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Computes the acceleration due to drag from the tabulated atmosphere
+void
+TabulatedAtmosphereAction::
+getAcceleration(
+    double *acceleration,
+    const Kinematics &kinematics ) const
+{
+  int c = cellIndex( kinematics.r );
+  double a[3];
+  drag( kinematics.bodyVelocity, kinematics.bodySpeed, kinematics.r,
+        m_baseRadius + c * m_cellSize, m_cells[c].density,
+        m_cells[c].inverseScaleHeight, m_bodyDragTerm, a );
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += a[i];
+  }
+}
+
+// Computes the accelerations as in getAcceleration() for every lane,
+// gathering the cell of each lane first
+void
+TabulatedAtmosphereAction::
+getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const
+{
+  typedef BatchKinematics::Lanes Lanes;
+  Lanes cellRadius, cellDensity, inverseScaleHeight;
+  for ( int l = 0; l < BatchKinematics::kLanes; ++l )
+  {
+    int c = cellIndex( kinematics.r( l ) );
+    cellRadius( l ) = m_baseRadius + c * m_cellSize;
+    cellDensity( l ) = m_cells[c].density;
+    inverseScaleHeight( l ) = m_cells[c].inverseScaleHeight;
+  }
+  Lanes a[3];
+  drag( kinematics.bodyVelocity, kinematics.bodySpeed, kinematics.r,
+        cellRadius, cellDensity, inverseScaleHeight,
+        Lanes( Lanes::Constant( m_bodyDragTerm ) ), a );
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += a[i];
+  }
+}
+
+// Computes the acceleration as in getAcceleration() and the partial
+// derivative of the acceleration terms and owned parameters. These are
+// the partials of AtmosphereAction with the inverse scale height of
+// the cell in place of 1 / step.
+void
+TabulatedAtmosphereAction::
+evaluate(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  // Condense variable names to make following equations more legible
+  double X = kinematics.position[0];
+  double Y = kinematics.position[1];
+  double Z = kinematics.position[2];
+  double rot = m_rotation;
+  double Cd = m_bodyDragTerm;
+  int c = cellIndex( kinematics.r );
+  double invH = m_cells[c].inverseScaleHeight;
+  double rho = m_cells[c].density *
+    std::exp( -( kinematics.r - ( m_baseRadius + c * m_cellSize ) ) * invH );
+
+  // Velocity relative to the rotating atmosphere
+  double vX = kinematics.bodyVelocity[0];
+  double vY = kinematics.bodyVelocity[1];
+  double vZ = kinematics.bodyVelocity[2];
+  double vel = kinematics.bodySpeed;
+
+  // Acceleration
+  double CdRhoVel = Cd * rho * vel;
+  acceleration[0] += -CdRhoVel * vX;
+  acceleration[1] += -CdRhoVel * vY;
+  acceleration[2] += -CdRhoVel * vZ;
+
+  // Factors shared by the partials: the density gradient term, the
+  // relative speed gradient term, and vel * d(vel)/dX, vel * d(vel)/dY.
+  double densityTerm = CdRhoVel * kinematics.invR * invH;
+  double speedTerm = Cd * rho / vel;
+  double velX = -rot * vY;
+  double velY = rot * vX;
+
+  // Partials of acceleration X component wrt state.
+  addPartial( partials, index, kAccX, kX,
+    densityTerm * X * vX - speedTerm * velX * vX );
+  addPartial( partials, index, kAccX, kY,
+    densityTerm * Y * vX - speedTerm * velY * vX - CdRhoVel * rot );
+  addPartial( partials, index, kAccX, kZ, densityTerm * Z * vX );
+  addPartial( partials, index, kAccX, kDX, -speedTerm * vX * vX - CdRhoVel );
+  addPartial( partials, index, kAccX, kDY, -speedTerm * vY * vX );
+  addPartial( partials, index, kAccX, kDZ, -speedTerm * vZ * vX );
+
+  // Partials of acceleration Y component wrt state.
+  addPartial( partials, index, kAccY, kX,
+    densityTerm * X * vY - speedTerm * velX * vY + CdRhoVel * rot );
+  addPartial( partials, index, kAccY, kY,
+    densityTerm * Y * vY - speedTerm * velY * vY );
+  addPartial( partials, index, kAccY, kZ, densityTerm * Z * vY );
+  addPartial( partials, index, kAccY, kDX, -speedTerm * vX * vY );
+  addPartial( partials, index, kAccY, kDY, -speedTerm * vY * vY - CdRhoVel );
+  addPartial( partials, index, kAccY, kDZ, -speedTerm * vZ * vY );
+
+  // Partials of acceleration Z component wrt state.
+  addPartial( partials, index, kAccZ, kX,
+    densityTerm * X * vZ - speedTerm * velX * vZ );
+  addPartial( partials, index, kAccZ, kY,
+    densityTerm * Y * vZ - speedTerm * velY * vZ );
+  addPartial( partials, index, kAccZ, kZ, densityTerm * Z * vZ );
+  addPartial( partials, index, kAccZ, kDX, -speedTerm * vX * vZ );
+  addPartial( partials, index, kAccZ, kDY, -speedTerm * vY * vZ );
+  addPartial( partials, index, kAccZ, kDZ, -speedTerm * vZ * vZ - CdRhoVel );
+
+  // Partials wrt Cd, in which the acceleration is linear, and the
+  // rotation rate, through the relative velocity, whose derivative is
+  // ( Y, -X, 0 )
+  double v[3] = { vX, vY, vZ };
+  for ( int i = 0; i < 3; ++i )
+  {
+    addPartial( partials, index, i, kCd, -rho * vel * v[i] );
+  }
+  double velRot = vX * Y - vY * X;
+  addPartial( partials, index, kAccX, kRotation,
+    -speedTerm * velRot * vX - CdRhoVel * Y );
+  addPartial( partials, index, kAccY, kRotation,
+    -speedTerm * velRot * vY + CdRhoVel * X );
+  addPartial( partials, index, kAccZ, kRotation, -speedTerm * velRot * vZ );
+}
+
+// Computes the acceleration as in getAcceleration() and its partials
+// by differentiating drag() with Duals. The cell is constant around
+// the state, so its values enter as constants.
+void
+TabulatedAtmosphereAction::
+evaluateAutomatic(
+    double *acceleration,
+    double *partials,
+    const Kinematics &kinematics,
+    const AgentIndex &index ) const
+{
+  Scalar position[3];
+  Scalar velocity[3];
+  for ( int i = 0; i < 3; ++i )
+  {
+    position[i] = Scalar::variable( kinematics.position[i], i );
+    velocity[i] = Scalar::variable( kinematics.velocity[i], 3 + i );
+  }
+  Scalar rotation = Scalar::variable( m_rotation, kRotation );
+
+  Scalar r = sqrt( position[0] * position[0] + position[1] * position[1] +
+                   position[2] * position[2] );
+  Scalar bodyVelocity[3] = { velocity[0] + rotation * position[1],
+                             velocity[1] - rotation * position[0],
+                             velocity[2] };
+  Scalar bodySpeed = sqrt( bodyVelocity[0] * bodyVelocity[0] +
+                           bodyVelocity[1] * bodyVelocity[1] +
+                           bodyVelocity[2] * bodyVelocity[2] );
+
+  int c = cellIndex( kinematics.r );
+  Scalar a[3];
+  drag( bodyVelocity, bodySpeed, r,
+        Scalar( m_baseRadius + c * m_cellSize ),
+        Scalar( m_cells[c].density ),
+        Scalar( m_cells[c].inverseScaleHeight ),
+        Scalar::variable( m_bodyDragTerm, kCd ), a );
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] += a[i].value;
+    for ( int j = 0; j <= kCd; ++j )
+    {
+      addPartial( partials, index, i, j, a[i].d( j ) );
+    }
+  }
+}
+
+// Names of the agents this action owns partials for
+const std::vector< std::string >&
+TabulatedAtmosphereAction::
+getAgentsOwned() const
+{
+  return m_agentsOwned;
+}
+
+// Rotation rate of the planet carrying the atmosphere
+double
+TabulatedAtmosphereAction::
+getRotationRate() const
+{
+  return m_rotation;
+}
+
+// Density at a distance from the body center
+double
+TabulatedAtmosphereAction::
+getDensity( double r ) const
+{
+  int c = cellIndex( r );
+  return m_cells[c].density *
+    std::exp( -( r - ( m_baseRadius + c * m_cellSize ) ) *
+              m_cells[c].inverseScaleHeight );
+}
+
+// The default table, in meters
+const std::vector< AtmosphereBand >&
+TabulatedAtmosphereAction::
+standardBands()
+{
+  static const std::vector< AtmosphereBand > bands = []()
+  {
+    std::vector< AtmosphereBand > table;
+    for ( const double *row: kStandardTable )
+    {
+      table.push_back( { 1000. * row[0], row[1], 1000. * row[2] } );
+    }
+    return table;
+  }();
+  return bands;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// The cell size is the largest whole number of meters dividing every
+// band boundary, so each cell lies in one band. Cell k starts at the
+// base of the first band plus k cells; the last starts at the base of
+// the last band and has no top.
+void
+TabulatedAtmosphereAction::
+buildCells(
+    double bodyRadius,
+    const std::vector< AtmosphereBand > &bands )
+{
+  if ( bands.empty() )
+  {
+    throw std::invalid_argument(
+      "TabulatedAtmosphereAction: no atmosphere bands" );
+  }
+  long long spacing = 0;
+  for ( std::size_t i = 0; i < bands.size(); ++i )
+  {
+    double offset = bands[i].height - bands[0].height;
+    long long meters = std::llround( offset );
+    if ( ( bands[i].density <= 0.0 ) || ( bands[i].scaleHeight <= 0.0 ) ||
+         ( ( i > 0 ) && ( bands[i].height <= bands[ i - 1 ].height ) ) ||
+         ( std::abs( offset - meters ) > 1.E-6 ) )
+    {
+      throw std::invalid_argument(
+        "TabulatedAtmosphereAction: bad band at height " +
+        std::to_string( bands[i].height ) );
+    }
+    spacing = greatestCommonDivisor( meters, spacing );
+  }
+  long long lastCell = ( spacing > 0 ) ?
+    std::llround( bands.back().height - bands[0].height ) / spacing : 0;
+  if ( lastCell >= kMaxCells )
+  {
+    throw std::invalid_argument(
+      "TabulatedAtmosphereAction: band boundaries too finely spaced" );
+  }
+
+  m_baseRadius = bodyRadius + bands[0].height;
+  m_cellSize = ( spacing > 0 ) ? double( spacing ) : 1.0;
+  m_inverseCellSize = 1.0 / m_cellSize;
+  m_lastCell = double( lastCell );
+  m_cells.resize( lastCell + 1 );
+  std::size_t band = 0;
+  for ( long long c = 0; c <= lastCell; ++c )
+  {
+    double height = bands[0].height + c * m_cellSize;
+    while ( ( band + 1 < bands.size() ) &&
+            ( bands[ band + 1 ].height <= height ) )
+    {
+      ++band;
+    }
+    const AtmosphereBand &b = bands[ band ];
+    m_cells[c].density = b.density *
+      std::exp( -( height - b.height ) / b.scaleHeight );
+    m_cells[c].inverseScaleHeight = 1.0 / b.scaleHeight;
+  }
+}
+
+// The index is truncated from the clamped, non-negative cell position,
+// and max( 0, NaN ) is 0, so every input lands in the table
+int
+TabulatedAtmosphereAction::
+cellIndex( double r ) const
+{
+  double position = ( r - m_baseRadius ) * m_inverseCellSize;
+  return int( std::min( std::max( 0.0, position ), m_lastCell ) );
+}
+
+// Drag on the body-relative velocity, with the density decaying
+// exponentially from the base of the cell
+template< typename T >
+void
+TabulatedAtmosphereAction::
+drag(
+    const T *bodyVelocity,
+    const T &bodySpeed,
+    const T &r,
+    const T &cellRadius,
+    const T &cellDensity,
+    const T &inverseScaleHeight,
+    const T &bodyDragTerm,
+    T *acceleration )
+{
+  using std::exp;
+  T density = cellDensity * exp( -( r - cellRadius ) * inverseScaleHeight );
+  T dragPrefix = -bodyDragTerm * density * bodySpeed;
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    acceleration[i] = dragPrefix * bodyVelocity[i];
+  }
+}
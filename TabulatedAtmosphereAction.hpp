@@ -0,0 +1,160 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TabulatedAtmosphereAction.hpp
+/// @brief   Computes state accelerations and partials due to drag in a
+///          tabulated, piecewise exponential atmosphere.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_TABULATEDATMOSPHEREACTION_HEADER_GUARD
+#define EKF_TABULATEDATMOSPHEREACTION_HEADER_GUARD
+
+// C++ Standard Library
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Dual.hpp>
+
+/// @brief One altitude band of a piecewise exponential atmosphere: the
+/// density at its base and its scale height.
+///
+struct AtmosphereBand
+{
+  double height;       // m above the body radius
+  double density;      // kg/m^3
+  double scaleHeight;  // m
+};
+
+/// @brief Compute state accelerations and partial derivates due to
+/// drag in an atmosphere tabulated by altitude band.
+///
+/// Within a band the density falls exponentially with its own scale
+/// height, from the density at the band base; the last band extends
+/// upwards without limit. The default table is the 0 - 1000 km
+/// exponential model of Vallado, Fundamentals of Astrodynamics and
+/// Applications, table 8-4. Altitude is above a spherical body of the
+/// given radius, and the atmosphere rotates with the body, as in
+/// AtmosphereAction.
+///
+/// The bands are resampled at construction onto uniform cells whose
+/// size divides every band boundary, 5 km for the default table. Each
+/// cell holds the density at its base and the inverse scale height of
+/// its band, so the lookup is an index computed from the altitude and
+/// clamped to the table with min and max, with no search and no branch,
+/// and the density one exp(). Its gradient is -density / scale height
+/// along the radius.
+///
+/// This class is responsible for computing partial derivatives of the
+/// following paramters:
+///   - Cartesian state X, Y, Z, dX, dY, dZ components
+///   - Planetary rotation
+///   - Agent body drag term
+///
+class TabulatedAtmosphereAction : public Action
+{
+ public:
+  TabulatedAtmosphereAction();
+  // Atmosphere of the default table
+  TabulatedAtmosphereAction( const std::string name, double bodyRadius,
+                             double rotation, double bodyDragTerm );
+  // Atmosphere of "bands", in increasing height. Throws
+  // std::invalid_argument if they are empty, out of order, not
+  // positive, or their heights are not whole meters apart.
+  TabulatedAtmosphereAction( const std::string name, double bodyRadius,
+                             double rotation, double bodyDragTerm,
+                             const std::vector< AtmosphereBand > &bands );
+
+ ~TabulatedAtmosphereAction() override;
+
+  // Computes the acceleration due to this action and adds it to
+  // the passed in array "acceleration".
+  void getAcceleration( double *acceleration,
+                        const Kinematics &kinematics ) const override;
+
+  // Computes the accelerations of a group of agents, one per lane
+  void getBatchAcceleration(
+    BatchKinematics::Lanes *acceleration,
+    const BatchKinematics &kinematics ) const override;
+
+  // Computes the acceleration and the partial derivative of the
+  // acceleration terms wrt the owned agents
+  void evaluate( double *acceleration,
+                 double *partials,
+                 const Kinematics &kinematics,
+                 const AgentIndex &index ) const override;
+
+  // Computes the same as evaluate, differentiating the acceleration
+  // with Duals
+  void evaluateAutomatic( double *acceleration,
+                          double *partials,
+                          const Kinematics &kinematics,
+                          const AgentIndex &index ) const override;
+
+  // Names of the agents this action owns partials for
+  const std::vector< std::string >& getAgentsOwned() const override;
+
+  // Rotation rate of the planet carrying the atmosphere
+  double getRotationRate() const override;
+
+  // Density at distance "r" from the body center
+  double getDensity( double r ) const;
+
+  // The default table
+  static const std::vector< AtmosphereBand >& standardBands();
+
+ private:
+  // Position of each agent in m_agentsOwned
+  enum OwnedAgent { kX, kY, kZ, kDX, kDY, kDZ, kRotation, kCd };
+
+  // Dual variables of evaluateAutomatic(), one per owned agent
+  typedef Dual< 8 > Scalar;
+
+  // Density at the base of a cell and the inverse scale height of its
+  // band
+  struct Cell
+  {
+    double density;
+    double inverseScaleHeight;
+  };
+
+  std::string m_name;
+  double m_rotation;
+  double m_bodyDragTerm;
+
+  // Distance from the body center of the base of cell 0, cell size,
+  // its inverse, and the index of the last cell as a double for the
+  // clamp
+  double m_baseRadius;
+  double m_cellSize;
+  double m_inverseCellSize;
+  double m_lastCell;
+  std::vector< Cell > m_cells;
+
+  std::vector< std::string > m_agentsOwned = { "X", "Y", "Z", "dX", "dY", "dZ",
+                                             "rot", "Cd" };
+
+  // Resample "bands" onto uniform cells
+  void buildCells( double bodyRadius,
+                   const std::vector< AtmosphereBand > &bands );
+
+  // Cell holding distance "r" from the body center, the first or last
+  // one outside the table
+  int cellIndex( double r ) const;
+
+  // Drag acceleration for the velocity relative to the atmosphere
+  // "bodyVelocity", its magnitude, distance "r" from the body center,
+  // the base radius, density and inverse scale height of its cell and
+  // the body drag term, for any scalar type T
+  template< typename T >
+  static void drag( const T *bodyVelocity, const T &bodySpeed, const T &r,
+                    const T &cellRadius, const T &cellDensity,
+                    const T &inverseScaleHeight, const T &bodyDragTerm,
+                    T *acceleration );
+};
+
+#endif // EKF_TABULATEDATMOSPHEREACTION_HEADER_GUARD
@@ -0,0 +1,185 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ThreadPool.cpp
+/// @brief   Work-stealing pool of threads for independent tasks.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+
+// ekf Library
+#include <ThreadPool.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+ThreadPool::
+ThreadPool( unsigned numThreads )
+    : m_threads(),
+      m_queues(),
+      m_mutex(),
+      m_wake(),
+      m_done(),
+      m_task( nullptr ),
+      m_remaining( 0 ),
+      m_generation( 0 ),
+      m_stop( false ),
+      m_error()
+{
+  if ( numThreads == 0 )
+  {
+    numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+  }
+  for ( unsigned i = 0; i < numThreads; ++i )
+  {
+    m_queues.push_back( std::unique_ptr< Queue >( new Queue() ) );
+  }
+  for ( unsigned i = 0; i < numThreads; ++i )
+  {
+    m_threads.push_back( std::thread( &ThreadPool::work, this, i ) );
+  }
+}
+
+ThreadPool::
+~ThreadPool()
+{
+  {
+    std::lock_guard< std::mutex > lock( m_mutex );
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for ( std::thread &thread: m_threads )
+  {
+    thread.join();
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Number of threads
+unsigned
+ThreadPool::
+size() const
+{
+  return m_threads.size();
+}
+
+// Queue the tasks, wake the threads and wait for the last task
+void
+ThreadPool::
+run(
+    std::size_t count,
+    const std::function< void( std::size_t ) > &task )
+{
+  if ( count == 0 )
+  {
+    return;
+  }
+
+  std::unique_lock< std::mutex > lock( m_mutex );
+  m_task = &task;
+  m_remaining = count;
+  m_error = std::exception_ptr();
+  for ( std::size_t i = 0; i < count; ++i )
+  {
+    Queue &queue = *m_queues[ i % m_queues.size() ];
+    std::lock_guard< std::mutex > queueLock( queue.mutex );
+    queue.tasks.push_back( i );
+  }
+  ++m_generation;
+  m_wake.notify_all();
+
+  m_done.wait( lock, [ this ]{ return m_remaining == 0; } );
+  m_task = nullptr;
+  if ( m_error )
+  {
+    std::rethrow_exception( m_error );
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Thread body: sleep until run() queues tasks, then drain own and
+// other queues until none are left
+void
+ThreadPool::
+work( unsigned self )
+{
+  unsigned long seen = 0;
+  while ( true )
+  {
+    {
+      std::unique_lock< std::mutex > lock( m_mutex );
+      m_wake.wait( lock, [ this, seen ]{
+        return m_stop || m_generation != seen; } );
+      if ( m_stop )
+      {
+        return;
+      }
+      seen = m_generation;
+    }
+
+    // m_task is read only once a task is taken: run() sets it before
+    // queueing, and the queue lock orders the two. A thread still
+    // draining the previous run can thus pick up tasks of the next one.
+    std::size_t i;
+    while ( nextTask( self, i ) )
+    {
+      try
+      {
+        ( *m_task )( i );
+      }
+      catch ( ... )
+      {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        if ( !m_error )
+        {
+          m_error = std::current_exception();
+        }
+      }
+
+      std::lock_guard< std::mutex > lock( m_mutex );
+      if ( --m_remaining == 0 )
+      {
+        m_done.notify_one();
+      }
+    }
+  }
+}
+
+// Take the newest task of our own queue, or else steal the oldest task
+// of another
+bool
+ThreadPool::
+nextTask( unsigned self, std::size_t &task )
+{
+  std::size_t numQueues = m_queues.size();
+  for ( std::size_t k = 0; k < numQueues; ++k )
+  {
+    Queue &queue = *m_queues[ ( self + k ) % numQueues ];
+    std::lock_guard< std::mutex > lock( queue.mutex );
+    if ( !queue.tasks.empty() )
+    {
+      if ( k == 0 )
+      {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+      }
+      else
+      {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+      }
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,78 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    ThreadPool.hpp
+/// @brief   Work-stealing pool of threads for independent tasks.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_THREADPOOL_HEADER_GUARD
+#define EKF_THREADPOOL_HEADER_GUARD
+
+// C++ Standard Library
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// @brief Work-stealing pool of threads for independent tasks.
+///
+/// run() hands out tasks 0 .. count - 1 round-robin to per-thread
+/// queues. Each thread works from the back of its own queue, and once
+/// it is empty steals from the front of the others, so a thread that
+/// drew cheap tasks helps those that drew expensive ones. The threads
+/// live as long as the pool and sleep between runs.
+///
+class ThreadPool
+{
+ public:
+  // Start "numThreads" threads, or one per hardware thread if zero
+  explicit ThreadPool( unsigned numThreads = 0 );
+ ~ThreadPool();
+
+  ThreadPool( const ThreadPool & ) = delete;
+  ThreadPool& operator=( const ThreadPool & ) = delete;
+
+  // Number of threads
+  unsigned size() const;
+
+  // Call task( i ) for every i in [ 0, count ) on the pool threads and
+  // wait for all of them. The first exception thrown by a task is
+  // rethrown here once all tasks are done. Not reentrant: one run at a
+  // time per pool.
+  void run( std::size_t count,
+            const std::function< void( std::size_t ) > &task );
+
+ private:
+  // Queue of task numbers owned by one thread
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque< std::size_t > tasks;
+  };
+
+  std::vector< std::thread > m_threads;
+  std::vector< std::unique_ptr< Queue > > m_queues;
+
+  // Shared by run() and the threads, guarded by m_mutex
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+  const std::function< void( std::size_t ) > *m_task;
+  std::size_t m_remaining;
+  unsigned long m_generation;
+  bool m_stop;
+  std::exception_ptr m_error;
+
+  void work( unsigned self );
+  bool nextTask( unsigned self, std::size_t &task );
+};
+
+#endif // EKF_THREADPOOL_HEADER_GUARD
@@ -0,0 +1,332 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TrackingData.cpp
+/// @brief   Binary tracking data files: record layout, memory-mapped
+///          reader, writer and CSV converter.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ekf Library
+#include <TrackingData.hpp>
+
+namespace
+{
+
+// File header. The record size guards against reading a file written
+// with a different TrackingRecord layout.
+struct TrackingHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t recordSize;
+  std::uint64_t count;
+};
+
+const char kMagic[8] = { 'E', 'K', 'F', 'T', 'R', 'A', 'C', 'K' };
+const std::uint32_t kVersion = 1;
+
+// Parse the six comma or blank separated numbers of a CSV line into
+// "record". Returns false if the line does not hold exactly them, or
+// the station is not an integer in the range of std::int32_t.
+bool
+parseCsvLine( const char *line, TrackingRecord &record )
+{
+  double values[6];
+  long station = 0;
+  const char *p = line;
+  for ( int i = 0; i < 6; ++i )
+  {
+    while ( ( *p == ' ' ) || ( *p == '\t' ) || ( ( i > 0 ) && ( *p == ',' ) ) )
+    {
+      ++p;
+    }
+    char *end;
+    if ( i == 1 )
+    {
+      errno = 0;
+      station = std::strtol( p, &end, 10 );
+      if ( ( errno == ERANGE ) || ( station < INT32_MIN ) ||
+           ( station > INT32_MAX ) )
+      {
+        return false;
+      }
+    }
+    else
+    {
+      values[i] = std::strtod( p, &end );
+    }
+    // A station such as "1.5" stops short of the separator and fails
+    // here or on the next field
+    if ( ( end == p ) ||
+         ( ( *end != '\0' ) && ( *end != ',' ) &&
+           !std::isspace( static_cast< unsigned char >( *end ) ) ) )
+    {
+      return false;
+    }
+    p = end;
+  }
+  while ( std::isspace( static_cast< unsigned char >( *p ) ) )
+  {
+    ++p;
+  }
+  if ( *p != '\0' )
+  {
+    return false;
+  }
+
+  record.time = values[0];
+  record.station = static_cast< std::int32_t >( station );
+  record.reserved = 0;
+  record.range = values[2];
+  record.rangeRate = values[3];
+  record.rangeSigma = values[4];
+  record.rangeRateSigma = values[5];
+  return true;
+}
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor, no file
+TrackingFile::
+TrackingFile()
+    : m_map( nullptr ),
+      m_mapSize( 0 ),
+      m_records( nullptr ),
+      m_size( 0 )
+{
+}
+
+// Map a tracking data file
+TrackingFile::
+TrackingFile( const std::string &path )
+    : m_map( nullptr ),
+      m_mapSize( 0 ),
+      m_records( nullptr ),
+      m_size( 0 )
+{
+  int fd = open( path.c_str(), O_RDONLY );
+  if ( fd < 0 )
+  {
+    throw std::runtime_error( "TrackingFile: cannot open " + path );
+  }
+  struct stat info;
+  if ( ( fstat( fd, &info ) != 0 ) ||
+       ( std::size_t( info.st_size ) < sizeof( TrackingHeader ) ) )
+  {
+    close( fd );
+    throw std::runtime_error( "TrackingFile: " + path +
+                              " is not a tracking data file" );
+  }
+
+  // The mapping keeps the file open, so the descriptor can go
+  m_mapSize = info.st_size;
+  m_map = mmap( nullptr, m_mapSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+  close( fd );
+  if ( m_map == MAP_FAILED )
+  {
+    m_map = nullptr;
+    throw std::runtime_error( "TrackingFile: cannot map " + path );
+  }
+
+  // The count is bounded by the mapping before it is multiplied, so a
+  // corrupt count cannot wrap around to a matching size
+  const TrackingHeader *header = static_cast< const TrackingHeader* >( m_map );
+  std::size_t maxCount =
+    ( m_mapSize - sizeof( TrackingHeader ) ) / sizeof( TrackingRecord );
+  if ( ( std::memcmp( header->magic, kMagic, sizeof( kMagic ) ) != 0 ) ||
+       ( header->version != kVersion ) ||
+       ( header->recordSize != sizeof( TrackingRecord ) ) ||
+       ( header->count > maxCount ) ||
+       ( sizeof( TrackingHeader ) + header->count * sizeof( TrackingRecord )
+         != m_mapSize ) )
+  {
+    unmap();
+    throw std::runtime_error( "TrackingFile: " + path +
+                              " is not a tracking data file" );
+  }
+  m_records = reinterpret_cast< const TrackingRecord* >( header + 1 );
+  m_size = header->count;
+
+  // Read ahead aggressively and drop pages behind the reader
+  madvise( m_map, m_mapSize, MADV_SEQUENTIAL );
+
+  // lowerBound() and the readers rely on the time order, so a file not
+  // written by write() is checked once. NaN times fail too.
+  for ( std::size_t i = 1; i < m_size; ++i )
+  {
+    if ( !( m_records[i].time >= m_records[ i - 1 ].time ) )
+    {
+      unmap();
+      throw std::runtime_error( "TrackingFile: " + path +
+                                " is not in time order at record " +
+                                std::to_string( i ) );
+    }
+  }
+}
+
+// Move Constructor
+TrackingFile::
+TrackingFile( TrackingFile &&other )
+    : m_map( other.m_map ),
+      m_mapSize( other.m_mapSize ),
+      m_records( other.m_records ),
+      m_size( other.m_size )
+{
+  other.m_map = nullptr;
+  other.m_mapSize = 0;
+  other.m_records = nullptr;
+  other.m_size = 0;
+}
+
+// Move Assignment
+TrackingFile&
+TrackingFile::
+operator=( TrackingFile &&other )
+{
+  if ( this != &other )
+  {
+    unmap();
+    std::swap( m_map, other.m_map );
+    std::swap( m_mapSize, other.m_mapSize );
+    std::swap( m_records, other.m_records );
+    std::swap( m_size, other.m_size );
+  }
+  return *this;
+}
+
+// Default Destructor
+TrackingFile::
+~TrackingFile()
+{
+  unmap();
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// First record at or after time t
+TrackingFile::const_iterator
+TrackingFile::
+lowerBound( double t ) const
+{
+  return std::lower_bound( begin(), end(), t,
+    []( const TrackingRecord &record, double time )
+    {
+      return record.time < time;
+    } );
+}
+
+// Write records to a tracking data file, in time order. Records at the
+// same time keep their order.
+void
+TrackingFile::
+write(
+    const std::string &path,
+    std::vector< TrackingRecord > records )
+{
+  std::stable_sort( records.begin(), records.end(),
+    []( const TrackingRecord &a, const TrackingRecord &b )
+    {
+      return a.time < b.time;
+    } );
+
+  TrackingHeader header;
+  std::memcpy( header.magic, kMagic, sizeof( kMagic ) );
+  header.version = kVersion;
+  header.recordSize = sizeof( TrackingRecord );
+  header.count = records.size();
+
+  std::ofstream file( path.c_str(), std::ios::binary | std::ios::trunc );
+  file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+  file.write( reinterpret_cast< const char* >( records.data() ),
+              records.size() * sizeof( TrackingRecord ) );
+  if ( !file )
+  {
+    throw std::runtime_error( "TrackingFile: cannot write " + path );
+  }
+}
+
+// Convert a CSV file to a tracking data file
+std::size_t
+TrackingFile::
+convertCsv(
+    const std::string &csvPath,
+    const std::string &path )
+{
+  std::ifstream csv( csvPath.c_str() );
+  if ( !csv )
+  {
+    throw std::runtime_error( "TrackingFile: cannot open " + csvPath );
+  }
+
+  std::vector< TrackingRecord > records;
+  std::string line;
+  std::size_t lineNumber = 0;
+  bool headerAllowed = true;
+  while ( std::getline( csv, line ) )
+  {
+    ++lineNumber;
+    std::size_t first = line.find_first_not_of( " \t\r" );
+    if ( ( first == std::string::npos ) || ( line[first] == '#' ) )
+    {
+      continue;
+    }
+
+    TrackingRecord record;
+    if ( parseCsvLine( line.c_str() + first, record ) )
+    {
+      records.push_back( record );
+    }
+    else if ( !headerAllowed )
+    {
+      throw std::runtime_error( "TrackingFile: bad record on line " +
+                                std::to_string( lineNumber ) + " of " +
+                                csvPath );
+    }
+    headerAllowed = false;
+  }
+
+  write( path, records );
+  return records.size();
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+void
+TrackingFile::
+unmap()
+{
+  if ( m_map )
+  {
+    munmap( m_map, m_mapSize );
+  }
+  m_map = nullptr;
+  m_mapSize = 0;
+  m_records = nullptr;
+  m_size = 0;
+}
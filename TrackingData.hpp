@@ -0,0 +1,102 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    TrackingData.hpp
+/// @brief   Binary tracking data files: record layout, memory-mapped
+///          reader, writer and CSV converter.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_TRACKINGDATA_HEADER_GUARD
+#define EKF_TRACKINGDATA_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @brief One tracking pass sample: range and range-rate from a ground
+/// station at a time.
+///
+/// Station k is the station whose coordinates are the agents X_k, Y_k,
+/// Z_k. A sigma of zero marks the matching measurement as absent, so
+/// range-only and range-rate-only samples fit the same record.
+///
+struct TrackingRecord
+{
+  double time;            // s
+  std::int32_t station;
+  std::int32_t reserved;  // zero, keeps the doubles 8 byte aligned
+  double range;           // m
+  double rangeRate;       // m/s
+  double rangeSigma;      // m
+  double rangeRateSigma;  // m/s
+};
+
+/// @brief A binary tracking data file, memory-mapped for reading.
+///
+/// The file is a fixed header followed by TrackingRecords sorted by
+/// time, in the native byte order. Opening it maps it and checks once
+/// that the times do not decrease. Records are then read straight from
+/// the page cache with no parsing or copying, and the kernel is told
+/// the access is sequential, so streaming through millions of records
+/// costs little more than touching the memory.
+///
+/// write() and convertCsv() produce such files, sorting the records by
+/// time.
+///
+class TrackingFile
+{
+ public:
+  typedef const TrackingRecord* const_iterator;
+
+  TrackingFile();
+  // Map the file at "path". Throws std::runtime_error if it cannot be
+  // opened, is not a tracking data file or is not in time order.
+  explicit TrackingFile( const std::string &path );
+  // A mapping cannot be shared, only handed over
+  TrackingFile( const TrackingFile &other ) = delete;
+  TrackingFile( TrackingFile &&other );
+  TrackingFile& operator=( const TrackingFile &other ) = delete;
+  TrackingFile& operator=( TrackingFile &&other );
+ ~TrackingFile();
+
+  // Number of records
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  // Records in time order
+  const TrackingRecord& operator[]( std::size_t i ) const
+    { return m_records[i]; }
+  const_iterator begin() const { return m_records; }
+  const_iterator end() const { return m_records + m_size; }
+
+  // First record at or after time t, or end() if none
+  const_iterator lowerBound( double t ) const;
+
+  // Write "records", sorted by time, to a tracking data file at "path"
+  static void write( const std::string &path,
+                     std::vector< TrackingRecord > records );
+
+  // Convert the CSV file at "csvPath" to a tracking data file at
+  // "path", and return the number of records. Each line holds time,
+  // station, range, range-rate, range sigma and range-rate sigma, and
+  // nothing else; the station must be an integer.
+  // Blank lines, lines starting with '#' and a header line are
+  // skipped.
+  static std::size_t convertCsv( const std::string &csvPath,
+                                 const std::string &path );
+
+ private:
+  void *m_map;
+  std::size_t m_mapSize;
+  const TrackingRecord *m_records;
+  std::size_t m_size;
+
+  void unmap();
+};
+
+#endif // EKF_TRACKINGDATA_HEADER_GUARD
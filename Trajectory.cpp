@@ -0,0 +1,386 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Trajectory.cpp
+/// @brief   Contiguous store of the logged states and STMs of a Motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+// POSIX
+#include <sys/mman.h>
+#include <unistd.h>
+
+// ekf Library
+#include <Trajectory.hpp>
+
+//=====================================================================
+//=====================================================================
+// TrajectoryColumn
+
+TrajectoryColumn::
+TrajectoryColumn()
+    : m_memory(),
+      m_fd( -1 ),
+      m_map( nullptr ),
+      m_capacity( 0 ),
+      m_data( nullptr ),
+      m_size( 0 )
+{
+}
+
+// Copies always live on the heap; the owning Trajectory spills them
+// again if needed.
+TrajectoryColumn::
+TrajectoryColumn( const TrajectoryColumn &other )
+    : m_memory( other.m_data, other.m_data + other.m_size ),
+      m_fd( -1 ),
+      m_map( nullptr ),
+      m_capacity( 0 ),
+      m_data( m_memory.data() ),
+      m_size( other.m_size )
+{
+}
+
+TrajectoryColumn::
+TrajectoryColumn( TrajectoryColumn &&other ) noexcept
+    : m_memory( std::move( other.m_memory ) ),
+      m_fd( other.m_fd ),
+      m_map( other.m_map ),
+      m_capacity( other.m_capacity ),
+      m_data( m_map ? m_map : m_memory.data() ),
+      m_size( other.m_size )
+{
+  other.m_fd = -1;
+  other.m_map = nullptr;
+  other.m_capacity = 0;
+  other.m_data = nullptr;
+  other.m_size = 0;
+}
+
+TrajectoryColumn&
+TrajectoryColumn::
+operator=( const TrajectoryColumn &other )
+{
+  if ( this != &other )
+  {
+    std::vector< double > values( other.m_data, other.m_data + other.m_size );
+    clear();
+    m_memory.swap( values );
+    m_data = m_memory.data();
+    m_size = m_memory.size();
+  }
+  return *this;
+}
+
+TrajectoryColumn&
+TrajectoryColumn::
+operator=( TrajectoryColumn &&other ) noexcept
+{
+  if ( this != &other )
+  {
+    clear();
+    m_memory = std::move( other.m_memory );
+    m_fd = other.m_fd;
+    m_map = other.m_map;
+    m_capacity = other.m_capacity;
+    m_data = m_map ? m_map : m_memory.data();
+    m_size = other.m_size;
+
+    other.m_fd = -1;
+    other.m_map = nullptr;
+    other.m_capacity = 0;
+    other.m_data = nullptr;
+    other.m_size = 0;
+  }
+  return *this;
+}
+
+TrajectoryColumn::
+~TrajectoryColumn()
+{
+  clear();
+}
+
+void
+TrajectoryColumn::
+append( const double *values, std::size_t count )
+{
+  if ( isSpilled() )
+  {
+    if ( m_size + count > m_capacity )
+    {
+      remap( std::max( 2 * m_capacity, m_size + count ) );
+    }
+    std::copy( values, values + count, m_map + m_size );
+    m_size += count;
+  }
+  else
+  {
+    m_memory.insert( m_memory.end(), values, values + count );
+    m_data = m_memory.data();
+    m_size = m_memory.size();
+  }
+}
+
+void
+TrajectoryColumn::
+replaceLast( const double *values, std::size_t count )
+{
+  double *last = isSpilled() ? m_map + m_size - count
+                             : m_memory.data() + m_size - count;
+  std::copy( values, values + count, last );
+}
+
+void
+TrajectoryColumn::
+clear()
+{
+  if ( m_map )
+  {
+    munmap( m_map, m_capacity * sizeof( double ) );
+  }
+  if ( m_fd >= 0 )
+  {
+    close( m_fd );
+  }
+  std::vector< double >().swap( m_memory );
+  m_fd = -1;
+  m_map = nullptr;
+  m_capacity = 0;
+  m_data = nullptr;
+  m_size = 0;
+}
+
+void
+TrajectoryColumn::
+spill( const std::string &directory )
+{
+  if ( isSpilled() )
+  {
+    return;
+  }
+
+  // The file is unlinked straight away, so it goes away with the
+  // descriptor however the process ends.
+  std::string path = directory + "/ekf_trajectory_XXXXXX";
+  std::vector< char > name( path.begin(), path.end() );
+  name.push_back( '\0' );
+  m_fd = mkstemp( name.data() );
+  if ( m_fd < 0 )
+  {
+    throw std::runtime_error( "TrajectoryColumn: cannot create " + path );
+  }
+  unlink( name.data() );
+
+  remap( std::max< std::size_t >( 2 * m_size, 4096 ) );
+  std::copy( m_memory.begin(), m_memory.end(), m_map );
+  std::vector< double >().swap( m_memory );
+}
+
+// Resize the backing file and map all of it
+void
+TrajectoryColumn::
+remap( std::size_t capacity )
+{
+  if ( m_map )
+  {
+    munmap( m_map, m_capacity * sizeof( double ) );
+    m_map = nullptr;
+  }
+  if ( ftruncate( m_fd, capacity * sizeof( double ) ) != 0 )
+  {
+    throw std::runtime_error( "TrajectoryColumn: cannot grow spill file" );
+  }
+  void *map = mmap( nullptr, capacity * sizeof( double ),
+                    PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0 );
+  if ( map == MAP_FAILED )
+  {
+    throw std::runtime_error( "TrajectoryColumn: cannot map spill file" );
+  }
+  m_map = static_cast< double* >( map );
+  m_capacity = capacity;
+  m_data = m_map;
+}
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+Trajectory::
+Trajectory()
+    : m_stmSize( 0 ),
+      m_spillLimit( 0 ),
+      m_spillDirectory(),
+      m_times(),
+      m_states(),
+      m_stateRates(),
+      m_partials(),
+      m_partialsRates()
+{
+}
+
+Trajectory::
+Trajectory( int stmSize )
+    : m_stmSize( stmSize ),
+      m_spillLimit( 0 ),
+      m_spillDirectory(),
+      m_times(),
+      m_states(),
+      m_stateRates(),
+      m_partials(),
+      m_partialsRates()
+{
+}
+
+// Copy Constructor
+Trajectory::
+Trajectory( const Trajectory &other )
+    : m_stmSize( other.m_stmSize ),
+      m_spillLimit( other.m_spillLimit ),
+      m_spillDirectory( other.m_spillDirectory ),
+      m_times( other.m_times ),
+      m_states( other.m_states ),
+      m_stateRates( other.m_stateRates ),
+      m_partials( other.m_partials ),
+      m_partialsRates( other.m_partialsRates )
+{
+}
+
+// Move Constructor
+Trajectory::
+Trajectory( Trajectory &&other ) noexcept
+    : m_stmSize( other.m_stmSize ),
+      m_spillLimit( other.m_spillLimit ),
+      m_spillDirectory( std::move( other.m_spillDirectory ) ),
+      m_times( std::move( other.m_times ) ),
+      m_states( std::move( other.m_states ) ),
+      m_stateRates( std::move( other.m_stateRates ) ),
+      m_partials( std::move( other.m_partials ) ),
+      m_partialsRates( std::move( other.m_partialsRates ) )
+{
+}
+
+// Copy Assignment
+Trajectory&
+Trajectory::
+operator=( const Trajectory &other )
+{
+  if ( this != &other )
+  {
+    Trajectory copy( other );
+    *this = std::move( copy );
+  }
+  return *this;
+}
+
+// Move Assignment
+Trajectory&
+Trajectory::
+operator=( Trajectory &&other ) noexcept
+{
+  if ( this != &other )
+  {
+    m_stmSize = other.m_stmSize;
+    m_spillLimit = other.m_spillLimit;
+    m_spillDirectory = std::move( other.m_spillDirectory );
+    m_times = std::move( other.m_times );
+    m_states = std::move( other.m_states );
+    m_stateRates = std::move( other.m_stateRates );
+    m_partials = std::move( other.m_partials );
+    m_partialsRates = std::move( other.m_partialsRates );
+  }
+  return *this;
+}
+
+Trajectory::
+~Trajectory()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+void
+Trajectory::
+reset( int stmSize )
+{
+  m_stmSize = stmSize;
+  m_times.clear();
+  m_states.clear();
+  m_stateRates.clear();
+  m_partials.clear();
+  m_partialsRates.clear();
+}
+
+void
+Trajectory::
+setSpillLimit( std::size_t bytes, const std::string &directory )
+{
+  m_spillLimit = bytes;
+  m_spillDirectory = directory;
+}
+
+void
+Trajectory::
+append(
+    double t,
+    const double *stateAndPartials,
+    const double *rates )
+{
+  if ( !empty() && ( t <= time( size() - 1 ) ) )
+  {
+    if ( t < time( size() - 1 ) )
+    {
+      throw std::invalid_argument(
+        "Trajectory: steps must be logged in increasing time order" );
+    }
+    m_states.replaceLast( stateAndPartials, 6 );
+    m_stateRates.replaceLast( rates, 6 );
+    m_partials.replaceLast( stateAndPartials + 6, m_stmSize );
+    m_partialsRates.replaceLast( rates + 6, m_stmSize );
+    return;
+  }
+
+  m_times.append( &t, 1 );
+  m_states.append( stateAndPartials, 6 );
+  m_stateRates.append( rates, 6 );
+  m_partials.append( stateAndPartials + 6, m_stmSize );
+  m_partialsRates.append( rates + 6, m_stmSize );
+
+  if ( m_spillLimit && !isSpilled() && ( bytes() > m_spillLimit ) )
+  {
+    m_times.spill( m_spillDirectory );
+    m_states.spill( m_spillDirectory );
+    m_stateRates.spill( m_spillDirectory );
+    m_partials.spill( m_spillDirectory );
+    m_partialsRates.spill( m_spillDirectory );
+  }
+}
+
+std::size_t
+Trajectory::
+lowerBound( double t ) const
+{
+  const double *times = m_times.data();
+  return std::lower_bound( times, times + size(), t ) - times;
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+std::size_t
+Trajectory::
+bytes() const
+{
+  return sizeof( double ) * ( m_times.size() + m_states.size() +
+                              m_stateRates.size() + m_partials.size() +
+                              m_partialsRates.size() );
+}
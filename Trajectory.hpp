@@ -0,0 +1,127 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    Trajectory.hpp
+/// @brief   Contiguous store of the logged states and STMs of a Motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_TRAJECTORY_HEADER_GUARD
+#define EKF_TRAJECTORY_HEADER_GUARD
+
+// C++ Standard Library
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief A growable array of doubles that can move itself out of the
+/// heap and into a memory-mapped temporary file.
+///
+class TrajectoryColumn
+{
+ public:
+  TrajectoryColumn();
+  TrajectoryColumn( const TrajectoryColumn &other );
+  // Moves hand over the buffer or mapped file, and leave "other" empty
+  TrajectoryColumn( TrajectoryColumn &&other ) noexcept;
+  TrajectoryColumn& operator=( const TrajectoryColumn &other );
+  TrajectoryColumn& operator=( TrajectoryColumn &&other ) noexcept;
+ ~TrajectoryColumn();
+
+  // Append "count" values
+  void append( const double *values, std::size_t count );
+  // Overwrite the last "count" values
+  void replaceLast( const double *values, std::size_t count );
+  // Drop all values, and release any mapped file
+  void clear();
+
+  // Move the values into a memory-mapped, unlinked temporary file in
+  // "directory". Later appends grow the file.
+  void spill( const std::string &directory );
+
+  const double* data() const { return m_data; }
+  std::size_t size() const { return m_size; }
+  bool isSpilled() const { return m_fd >= 0; }
+
+ private:
+  std::vector< double > m_memory;
+  int m_fd;
+  double *m_map;
+  std::size_t m_capacity;
+  double *m_data;
+  std::size_t m_size;
+
+  void remap( std::size_t capacity );
+};
+
+/// @brief Contiguous store of the logged states and STMs of a Motion.
+///
+/// Each logged step is a time, the six state components, the STM ( if
+/// any ), and the time derivatives of both. Every quantity lives in its
+/// own contiguous column, and the times column doubles as a sorted
+/// index since steps are logged in increasing time order.
+///
+/// Once the store passes a configurable size, all columns are moved to
+/// memory-mapped temporary files so that long arcs do not have to fit
+/// in the heap.
+///
+class Trajectory
+{
+ public:
+  Trajectory();
+  explicit Trajectory( int stmSize );
+  // Copies live on the heap. Moves hand over the columns, spilled ones
+  // included, and leave "other" without steps.
+  Trajectory( const Trajectory &other );
+  Trajectory( Trajectory &&other ) noexcept;
+  Trajectory& operator=( const Trajectory &other );
+  Trajectory& operator=( Trajectory &&other ) noexcept;
+ ~Trajectory();
+
+  // Drop all steps, and set the number of STM elements per step
+  void reset( int stmSize );
+
+  // Spill to memory-mapped files in "directory" once the store holds
+  // more than "bytes" bytes. Zero disables spilling.
+  void setSpillLimit( std::size_t bytes, const std::string &directory );
+
+  // Log a step. "stateAndPartials" and "rates" hold the six state
+  // components followed by the STM. Logging the time of the last step
+  // again replaces it; earlier times are an error.
+  void append( double t, const double *stateAndPartials,
+               const double *rates );
+
+  std::size_t size() const { return m_times.size(); }
+  bool empty() const { return m_times.size() == 0; }
+  int stmSize() const { return m_stmSize; }
+  bool isSpilled() const { return m_times.isSpilled(); }
+
+  // Index of the first step at or after time t, or size() if none
+  std::size_t lowerBound( double t ) const;
+
+  double time( std::size_t i ) const { return m_times.data()[i]; }
+  const double* state( std::size_t i ) const
+    { return m_states.data() + 6 * i; }
+  const double* stateRate( std::size_t i ) const
+    { return m_stateRates.data() + 6 * i; }
+  const double* partials( std::size_t i ) const
+    { return m_partials.data() + m_stmSize * i; }
+  const double* partialsRate( std::size_t i ) const
+    { return m_partialsRates.data() + m_stmSize * i; }
+
+ private:
+  int m_stmSize;
+  std::size_t m_spillLimit;
+  std::string m_spillDirectory;
+  TrajectoryColumn m_times;
+  TrajectoryColumn m_states;
+  TrajectoryColumn m_stateRates;
+  TrajectoryColumn m_partials;
+  TrajectoryColumn m_partialsRates;
+
+  std::size_t bytes() const;
+};
+
+#endif // EKF_TRAJECTORY_HEADER_GUARD
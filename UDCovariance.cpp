@@ -0,0 +1,248 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    UDCovariance.cpp
+/// @brief   Covariance matrix held as U D U^T factors, with Bierman
+///          measurement updates and Thornton time updates.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <stdexcept>
+
+// ekf Library
+#include <UDCovariance.hpp>
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Default Constructor
+UDCovariance::
+UDCovariance()
+    : m_size( 0 ),
+      m_U(),
+      m_D(),
+      m_rows(),
+      m_weights(),
+      m_f(),
+      m_v()
+{
+}
+
+// Constructor from a row-major covariance
+UDCovariance::
+UDCovariance(
+    int size,
+    const std::vector< double > &covariance )
+    : m_size( size ),
+      m_U( Eigen::MatrixXd::Identity( size, size ) ),
+      m_D( Eigen::VectorXd::Zero( size ) ),
+      m_rows( size, 2 * size ),
+      m_weights( 2 * size ),
+      m_f( size ),
+      m_v( size )
+{
+  if ( covariance.size() != std::size_t( size * size ) )
+  {
+    throw std::invalid_argument(
+      "UDCovariance: need a size x size covariance" );
+  }
+  setCovariance( covariance.data() );
+}
+
+// Default Destructor
+UDCovariance::
+~UDCovariance()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Number of rows and columns of the covariance
+int
+UDCovariance::
+size() const
+{
+  return m_size;
+}
+
+// Factor the covariance as U D U^T, from the last column back. Only
+// the upper triangle of "covariance" is read.
+void
+UDCovariance::
+setCovariance( const double *covariance )
+{
+  const int n = m_size;
+  Eigen::Block< RowMatrix > work = m_rows.leftCols( n );
+  work = Eigen::Map< const RowMatrix >( covariance, n, n );
+  m_U.setIdentity();
+
+  for ( int j = n - 1; j >= 0; --j )
+  {
+    double d = work( j, j );
+    if ( !( d > 0.0 ) )
+    {
+      throw std::invalid_argument(
+        "UDCovariance: covariance is not positive definite" );
+    }
+    m_D( j ) = d;
+    for ( int i = 0; i < j; ++i )
+    {
+      m_U( i, j ) = work( i, j ) / d;
+    }
+    for ( int i = 0; i < j; ++i )
+    {
+      for ( int k = 0; k <= i; ++k )
+      {
+        work( k, i ) -= m_U( k, j ) * d * m_U( i, j );
+      }
+    }
+  }
+}
+
+// Write U D U^T, row-major
+void
+UDCovariance::
+getCovariance( double *covariance ) const
+{
+  Eigen::Map< RowMatrix > P( covariance, m_size, m_size );
+  P.noalias() = m_U * m_D.asDiagonal() * m_U.transpose();
+}
+
+// The unit upper triangular factor
+const Eigen::MatrixXd&
+UDCovariance::
+getU() const
+{
+  return m_U;
+}
+
+// The diagonal factor
+const Eigen::VectorXd&
+UDCovariance::
+getD() const
+{
+  return m_D;
+}
+
+// Bierman's scalar measurement update. With f = U^T h and v = D f, the
+// innovation variance is accumulated one component at a time, and
+// each column of U and element of D is updated in the same sweep that
+// builds the gain.
+double
+UDCovariance::
+update(
+    const double *partials,
+    double variance,
+    double *gain )
+{
+  if ( !( variance > 0.0 ) )
+  {
+    throw std::invalid_argument(
+      "UDCovariance::update: measurement variance must be positive" );
+  }
+
+  const int n = m_size;
+  m_f.noalias() = m_U.transpose() * Eigen::Map< const Eigen::VectorXd >(
+    partials, n );
+  m_v = m_D.cwiseProduct( m_f );
+
+  double alpha = variance + m_f( 0 ) * m_v( 0 );
+  m_D( 0 ) *= variance / alpha;
+  gain[0] = m_v( 0 );
+  for ( int j = 1; j < n; ++j )
+  {
+    double beta = alpha;
+    alpha += m_f( j ) * m_v( j );
+    double lambda = -m_f( j ) / beta;
+    m_D( j ) *= beta / alpha;
+    for ( int i = 0; i < j; ++i )
+    {
+      double u = m_U( i, j );
+      m_U( i, j ) = u + gain[i] * lambda;
+      gain[i] += u * m_v( j );
+    }
+    gain[j] = m_v( j );
+  }
+
+  for ( int i = 0; i < n; ++i )
+  {
+    gain[i] /= alpha;
+  }
+  return alpha;
+}
+
+// Thornton's time update. The rows of W = [ Phi U | I ] are
+// orthogonalized from the last one up, in the inner product weighted
+// by diag( D, Q ): the weighted norms are the new D, and the
+// projection coefficients the new U.
+void
+UDCovariance::
+propagate(
+    const double *stm,
+    const double *noise )
+{
+  const int n = m_size;
+  m_rows.leftCols( n ).noalias() =
+    Eigen::Map< const RowMatrix >( stm, n, n ) * m_U;
+  m_weights.head( n ) = m_D;
+  if ( noise )
+  {
+    m_rows.rightCols( n ).setIdentity();
+    m_weights.tail( n ) = Eigen::Map< const Eigen::VectorXd >( noise, n );
+  }
+
+  // Row j of the noise block only has non-zeros in columns j and up:
+  // it starts as e_j and only ever has later rows subtracted from it
+  for ( int j = n - 1; j >= 0; --j )
+  {
+    const int noiseCols = noise ? n - j : 0;
+    double d = weightedDot( j, j, n, noiseCols );
+    m_D( j ) = d;
+    for ( int i = 0; i < j; ++i )
+    {
+      if ( d > 0.0 )
+      {
+        double u = weightedDot( i, j, n, noiseCols ) / d;
+        m_U( i, j ) = u;
+        m_rows.row( i ).head( n ) -= u * m_rows.row( j ).head( n );
+        m_rows.row( i ).tail( noiseCols ) -=
+          u * m_rows.row( j ).tail( noiseCols );
+      }
+      else
+      {
+        m_U( i, j ) = 0.0;
+      }
+    }
+  }
+}
+
+//=====================================================================
+//=====================================================================
+// PRIVATE MEMBERS
+
+// Weighted inner product of rows i and j of the time update workspace,
+// over the first "n" columns and the last "noiseCols" columns
+double
+UDCovariance::
+weightedDot(
+    int i,
+    int j,
+    int n,
+    int noiseCols ) const
+{
+  double dot = ( m_rows.row( i ).head( n ).transpose().cwiseProduct(
+                   m_weights.head( n ) ) ).dot(
+                 m_rows.row( j ).head( n ).transpose() );
+  if ( noiseCols > 0 )
+  {
+    dot += ( m_rows.row( i ).tail( noiseCols ).transpose().cwiseProduct(
+               m_weights.tail( noiseCols ) ) ).dot(
+             m_rows.row( j ).tail( noiseCols ).transpose() );
+  }
+  return dot;
+}
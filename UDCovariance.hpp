@@ -0,0 +1,83 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    UDCovariance.hpp
+/// @brief   Covariance matrix held as U D U^T factors, with Bierman
+///          measurement updates and Thornton time updates.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_UDCOVARIANCE_HEADER_GUARD
+#define EKF_UDCOVARIANCE_HEADER_GUARD
+
+// C++ Standard Library
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+/// @brief Covariance matrix held as P = U D U^T, with U unit upper
+/// triangular and D diagonal.
+///
+/// Measurements are processed one scalar at a time with Bierman's
+/// update, so no innovation matrix is ever formed or inverted, and the
+/// time update P = Phi P Phi^T + Q is done with Thornton's modified
+/// weighted Gram-Schmidt on [ Phi U | I ]. Both work on the factors
+/// directly: D stays non-negative and P stays symmetric positive
+/// semi-definite by construction, for about the cost of the
+/// conventional update and much less than the Joseph form.
+///
+/// All workspaces are sized by the constructor, so updates and time
+/// updates do not allocate.
+///
+class UDCovariance
+{
+ public:
+  UDCovariance();
+  // Factor the row-major size x size "covariance"
+  UDCovariance( int size, const std::vector< double > &covariance );
+ ~UDCovariance();
+
+  // Number of rows and columns of the covariance
+  int size() const;
+
+  // Replace the covariance with the row-major "covariance". Throws
+  // std::invalid_argument if it is not positive definite.
+  void setCovariance( const double *covariance );
+  // Write U D U^T, row-major, to "covariance"
+  void getCovariance( double *covariance ) const;
+  // The factors
+  const Eigen::MatrixXd& getU() const;
+  const Eigen::VectorXd& getD() const;
+
+  // Scalar measurement update with measurement partials "partials" and
+  // measurement noise variance "variance". Writes the Kalman gain to
+  // "gain" and returns the innovation variance h P h^T + variance.
+  double update( const double *partials, double variance, double *gain );
+
+  // Time update P = Phi P Phi^T + Q with the row-major transition
+  // matrix "stm" and a diagonal Q of variances "noise", which may be
+  // null for no process noise.
+  void propagate( const double *stm, const double *noise );
+
+ private:
+  typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                         Eigen::RowMajor > RowMatrix;
+
+  int m_size;
+  Eigen::MatrixXd m_U;
+  Eigen::VectorXd m_D;
+
+  // Workspaces: the rows of [ Phi U | I ] and their weights for the
+  // time update, U^T h and D U^T h for updates
+  RowMatrix m_rows;
+  Eigen::VectorXd m_weights;
+  Eigen::VectorXd m_f;
+  Eigen::VectorXd m_v;
+
+  double weightedDot( int i, int j, int n, int noiseCols ) const;
+};
+
+#endif // EKF_UDCOVARIANCE_HEADER_GUARD
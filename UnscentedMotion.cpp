@@ -0,0 +1,172 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    UnscentedMotion.cpp
+/// @brief   Propagate the mean and covariance of an agent's state with
+///          the unscented transform.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <stdexcept>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <UnscentedMotion.hpp>
+
+namespace
+{
+
+typedef Eigen::Matrix< double, UnscentedMotion::kSize,
+                       UnscentedMotion::kSize, Eigen::RowMajor > StateMatrix;
+typedef Eigen::Matrix< double, UnscentedMotion::kSize, 1 > StateVector;
+
+} // namespace
+
+//=====================================================================
+//=====================================================================
+// CONSTRUCTORS / DESCTRUCTOR
+
+// Constructor from the initial mean and covariance. Draws the sigma
+// points mean and mean +/- the columns of sqrt( ( n + lambda ) P ).
+UnscentedMotion::
+UnscentedMotion(
+    const std::vector< double > &mean,
+    const std::vector< double > &covariance,
+    double step,
+    double alpha,
+    double beta,
+    double kappa )
+    : m_meanWeights(),
+      m_covarianceWeights(),
+      m_points( step )
+{
+  const int n = kSize;
+  if ( mean.size() < std::size_t( n ) ||
+       covariance.size() != std::size_t( n * n ) )
+  {
+    throw std::invalid_argument(
+      "UnscentedMotion: need a 6 state mean and a 6 x 6 covariance" );
+  }
+
+  double lambda = alpha * alpha * ( n + kappa ) - n;
+  m_meanWeights.assign( 2 * n + 1, 0.5 / ( n + lambda ) );
+  m_covarianceWeights = m_meanWeights;
+  m_meanWeights[0] = lambda / ( n + lambda );
+  m_covarianceWeights[0] = m_meanWeights[0] + 1 - alpha * alpha + beta;
+
+  Eigen::LLT< StateMatrix > cholesky(
+    ( n + lambda ) * Eigen::Map< const StateMatrix >( covariance.data() ) );
+  if ( cholesky.info() != Eigen::Success )
+  {
+    throw std::invalid_argument(
+      "UnscentedMotion: covariance is not positive definite" );
+  }
+  StateMatrix root = cholesky.matrixL();
+
+  StateVector center = Eigen::Map< const StateVector >( mean.data() );
+  std::vector< double > point( n );
+  Eigen::Map< StateVector > pointMap( point.data() );
+
+  pointMap = center;
+  m_points.addAgent( point );
+  for ( int sign: { 1, -1 } )
+  {
+    for ( int i = 0; i < n; ++i )
+    {
+      pointMap = center + sign * root.col( i );
+      m_points.addAgent( point );
+    }
+  }
+}
+
+// Default Destructor
+UnscentedMotion::
+~UnscentedMotion()
+{
+}
+
+//=====================================================================
+//=====================================================================
+// PUBLIC MEMBERS
+
+// Add an Action
+void
+UnscentedMotion::
+addAction( std::shared_ptr< Action > a )
+{
+  m_points.addAction( a );
+}
+
+// Step all sigma points to time t
+void
+UnscentedMotion::
+stepTo( double t )
+{
+  m_points.stepTo( t );
+}
+
+// Return the current time step.
+double
+UnscentedMotion::
+getTime() const
+{
+  return m_points.getTime();
+}
+
+// Weighted mean of the sigma points
+std::vector< double >
+UnscentedMotion::
+getMean() const
+{
+  std::vector< double > mean( kSize, 0.0 );
+  for ( std::size_t k = 0; k < m_points.size(); ++k )
+  {
+    std::vector< double > point = m_points.getState( k );
+    for ( int i = 0; i < kSize; ++i )
+    {
+      mean[i] += m_meanWeights[k] * point[i];
+    }
+  }
+  return mean;
+}
+
+// Weighted scatter of the sigma points about their mean
+std::vector< double >
+UnscentedMotion::
+getCovariance() const
+{
+  std::vector< double > mean = getMean();
+  StateVector center = Eigen::Map< const StateVector >( mean.data() );
+
+  StateMatrix covariance = StateMatrix::Zero();
+  for ( std::size_t k = 0; k < m_points.size(); ++k )
+  {
+    std::vector< double > point = m_points.getState( k );
+    StateVector deviation =
+      Eigen::Map< const StateVector >( point.data() ) - center;
+    covariance.noalias() +=
+      m_covarianceWeights[k] * deviation * deviation.transpose();
+  }
+  return std::vector< double >( covariance.data(),
+                                covariance.data() + kSize * kSize );
+}
+
+// Set the step size error tolerances
+void
+UnscentedMotion::
+setTolerances( double absTol, double relTol )
+{
+  m_points.setTolerances( absTol, relTol );
+}
+
+// Number of right hand side evaluations so far
+unsigned long
+UnscentedMotion::
+getRhsCount() const
+{
+  return m_points.getRhsCount();
+}
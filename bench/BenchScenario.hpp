@@ -0,0 +1,89 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    BenchScenario.hpp
+/// @brief   Shared set up and timing for the ekf benchmarks.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+#pragma once
+#ifndef EKF_BENCHSCENARIO_HEADER_GUARD
+#define EKF_BENCHSCENARIO_HEADER_GUARD
+
+// C++ Standard Library
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <AtmosphereAction.hpp>
+#include <GravityAction.hpp>
+
+namespace bench
+{
+
+// Initial conditions used by ekf_main.cpp
+inline std::vector< double >
+initialState()
+{
+  return { 757700., 5222607., 4851500., 2213.21, 4678.34, -5371.30 };
+}
+
+// The Earth gravity field used by ekf_main.cpp
+inline GravityAction
+earthGravityModel()
+{
+  return GravityAction(
+    "Earth", 6378136.3, 3.986004415E+14, 1.082626925638815E-3 );
+}
+
+inline std::shared_ptr< Action >
+earthGravity()
+{
+  return std::make_shared< GravityAction >( earthGravityModel() );
+}
+
+// The Earth atmosphere and spacecraft used by ekf_main.cpp
+inline AtmosphereAction
+earthAtmosphereModel()
+{
+  double bodyDragTerm = ( 1.0 / 2.0 ) * 2.0 * ( 3.0 / 970.0 );
+  return AtmosphereAction(
+    "Earth Atmosphere", 7078136.3, 3.614E-13, 88667.0, 7.29211585530066E-5,
+    bodyDragTerm );
+}
+
+inline std::shared_ptr< Action >
+earthAtmosphere()
+{
+  return std::make_shared< AtmosphereAction >( earthAtmosphereModel() );
+}
+
+// The first "numAgents" agents of the ekf_main.cpp agent list, state
+// components included.
+inline std::vector< std::string >
+activeAgents( int numAgents )
+{
+  std::vector< std::string > all = {
+    "X", "Y", "Z", "dX", "dY", "dZ",
+    "mu", "J2", "Cd",
+    "X_1", "Y_1", "Z_1",
+    "X_2", "Y_2", "Z_2",
+    "X_3", "Y_3", "Z_3" };
+  return std::vector< std::string >( all.begin(), all.begin() + numAgents );
+}
+
+// Wall clock seconds since an arbitrary epoch
+inline double
+seconds()
+{
+  return std::chrono::duration< double >(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+} // namespace bench
+
+#endif // EKF_BENCHSCENARIO_HEADER_GUARD
@@ -0,0 +1,163 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_action_set.cpp
+/// @brief   Compare the run time ActionList force model with the
+///          compile time ActionSet.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Both force models hold the ekf_main.cpp gravity and atmosphere. The
+/// right hand side of FixedOdeintHelper is timed with each, next to the
+/// dynamically sized OdeintHelper, and FixedMotion is run over a day
+/// with each. The ActionSet results must match the ActionList ones.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <ActionList.hpp>
+#include <ActionSet.hpp>
+#include <AtmosphereAction.hpp>
+#include <FixedMotion.hpp>
+#include <FixedOdeintHelper.hpp>
+#include <GravityAction.hpp>
+#include <OdeintHelper.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+typedef ActionSet< GravityAction, AtmosphereAction > EarthForces;
+
+const int kNumCalls = 500000;
+const double kArcLength = 86400.0;
+
+EarthForces
+earthForces()
+{
+  return EarthForces( bench::earthGravityModel(),
+                      bench::earthAtmosphereModel() );
+}
+
+// Time "numCalls" calls of "helper"
+template< class Helper, class State >
+double
+timeRhs( Helper &helper, const State &x, State &dxdt )
+{
+  double start = bench::seconds();
+  for ( int i = 0; i < kNumCalls; ++i )
+  {
+    helper( x, dxdt, 0.0 );
+  }
+  return bench::seconds() - start;
+}
+
+// Time one right hand side call with each force model for N agents
+template< int N >
+bool
+benchRhs()
+{
+  std::vector< std::string > agents = bench::activeAgents( N );
+  std::vector< std::shared_ptr< Action > > actions = {
+    bench::earthGravity(), bench::earthAtmosphere() };
+
+  typename FixedOdeintHelper< N >::state_type x, listDxdt, setDxdt;
+  std::vector< double > ic = bench::initialState();
+  x.fill( 0.0 );
+  std::copy( ic.begin(), ic.end(), x.begin() );
+  for ( int i = 0; i < N; ++i )
+  {
+    x[ 6 + i * N + i ] = 1.0;
+  }
+
+  OdeintHelper dynamicHelper( actions, agents );
+  dynamicHelper.activateAgents();
+  std::vector< double > dx( x.begin(), x.end() ), ddxdt( x.size() );
+  double dynamicTime = timeRhs( dynamicHelper, dx, ddxdt );
+
+  ActionList list( actions );
+  FixedOdeintHelper< N > listHelper( list, agents );
+  listHelper.activateAgents();
+  double listTime = timeRhs( listHelper, x, listDxdt );
+
+  EarthForces set = earthForces();
+  FixedOdeintHelper< N, EarthForces > setHelper( set, agents );
+  setHelper.activateAgents();
+  double setTime = timeRhs( setHelper, x, setDxdt );
+
+  double maxDiff = 0.0;
+  for ( std::size_t i = 0; i < x.size(); ++i )
+  {
+    maxDiff = std::max( maxDiff, std::abs( listDxdt[i] - setDxdt[i] ) );
+  }
+
+  std::cout << "N = " << N << " right hand side ns/call" << std::endl
+            << "   OdeintHelper:             "
+            << 1.E9 * dynamicTime / kNumCalls << std::endl
+            << "   FixedOdeintHelper, list:  "
+            << 1.E9 * listTime / kNumCalls << std::endl
+            << "   FixedOdeintHelper, set:   "
+            << 1.E9 * setTime / kNumCalls << std::endl
+            << "   max |difference|: " << maxDiff << std::endl;
+  return maxDiff == 0.0;
+}
+
+// Time a propagation of FixedMotion with each force model for N agents
+template< int N >
+bool
+benchPropagation()
+{
+  std::vector< std::string > agents = bench::activeAgents( N );
+  std::vector< std::string > params( agents.begin() + 6, agents.end() );
+
+  FixedMotion< N > listMotion( bench::initialState(), 10. );
+  listMotion.addAction( bench::earthGravity() );
+  listMotion.addAction( bench::earthAtmosphere() );
+  listMotion.activateAgents( params );
+
+  double start = bench::seconds();
+  listMotion.stepTo( kArcLength );
+  double listTime = bench::seconds() - start;
+
+  FixedMotion< N, EarthForces > setMotion( bench::initialState(), 10.,
+                                           earthForces() );
+  setMotion.activateAgents( params );
+
+  start = bench::seconds();
+  setMotion.stepTo( kArcLength );
+  double setTime = bench::seconds() - start;
+
+  std::vector< double > listState = listMotion.getState();
+  std::vector< double > setState = setMotion.getState();
+  double maxDiff = 0.0;
+  for ( int i = 0; i < 6; ++i )
+  {
+    maxDiff = std::max( maxDiff, std::abs( listState[i] - setState[i] ) );
+  }
+
+  std::cout << "N = " << N << " propagation over " << kArcLength << " s"
+            << std::endl
+            << "   FixedMotion, list ms: " << 1.E3 * listTime << std::endl
+            << "   FixedMotion, set ms:  " << 1.E3 * setTime << std::endl
+            << "   max |state difference|: " << maxDiff << std::endl;
+  return maxDiff == 0.0;
+}
+
+} // namespace
+
+int
+main()
+{
+  bool same = benchRhs< 6 >() && benchRhs< 9 >() &&
+              benchPropagation< 6 >() && benchPropagation< 9 >();
+  if ( !same )
+  {
+    std::cout << "ERROR: ActionSet and ActionList disagree" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,234 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_automatic_partials.cpp
+/// @brief   Check the hand-written Action partials against automatic
+///          differentiation and central differences, and time both.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// For every agent owned by the gravity and atmosphere actions of
+/// ekf_main.cpp and by the tabulated atmosphere, at points along the
+/// ekf_main.cpp orbit, the partials from Action::evaluate are compared
+/// with those from Action::evaluateAutomatic ( Dual numbers ) and with
+/// central differences of getAcceleration. Parameters are perturbed by
+/// rebuilding the action. Fails if any column disagrees.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <AtmosphereAction.hpp>
+#include <GravityAction.hpp>
+#include <Kinematics.hpp>
+#include <Motion.hpp>
+#include <TabulatedAtmosphereAction.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const int kNumCalls = 1000000;
+
+// An action rebuilt from its parameter values, in getAgentsOwned order
+// after the six state components
+typedef std::function< std::shared_ptr< Action >(
+  const std::vector< double > & ) > ActionFactory;
+
+struct NamedAction
+{
+  std::string name;
+  std::vector< double > parameters;
+  ActionFactory make;
+};
+
+// Acceleration of "action" at "state"
+std::vector< double >
+accelerationAt( const Action &action, const std::vector< double > &state )
+{
+  Kinematics kinematics( action.getRotationRate() );
+  kinematics.update( state.data(), 0.0 );
+  std::vector< double > a( 3, 0.0 );
+  action.getAcceleration( a.data(), kinematics );
+  return a;
+}
+
+// Central difference partials of the acceleration wrt the state and
+// the parameters, 3 x numAgents row-major
+std::vector< double >
+centralDifferences( const NamedAction &named,
+                    const std::vector< double > &state )
+{
+  int numAgents = 6 + named.parameters.size();
+  std::vector< double > partials( 3 * numAgents );
+  for ( int j = 0; j < numAgents; ++j )
+  {
+    std::vector< double > x = state;
+    std::vector< double > p = named.parameters;
+    double &value = ( j < 6 ) ? x[j] : p[ j - 6 ];
+    double h = 1.E-6 * std::max( std::abs( value ), 1.0 );
+    double nominal = value;
+
+    value = nominal + h;
+    std::vector< double > plus = accelerationAt( *named.make( p ), x );
+    value = nominal - h;
+    std::vector< double > minus = accelerationAt( *named.make( p ), x );
+    for ( int i = 0; i < 3; ++i )
+    {
+      partials[ i * numAgents + j ] = ( plus[i] - minus[i] ) / ( 2 * h );
+    }
+  }
+  return partials;
+}
+
+// Largest difference between two partials blocks, relative to the
+// largest element of each column
+double
+worstColumnError( const std::vector< double > &a,
+                  const std::vector< double > &b, int numAgents )
+{
+  double worst = 0.0;
+  for ( int j = 0; j < numAgents; ++j )
+  {
+    double scale = 0.0;
+    double error = 0.0;
+    for ( int i = 0; i < 3; ++i )
+    {
+      scale = std::max( scale, std::abs( b[ i * numAgents + j ] ) );
+      error = std::max( error, std::abs( a[ i * numAgents + j ] -
+                                         b[ i * numAgents + j ] ) );
+    }
+    if ( scale > 0.0 )
+    {
+      worst = std::max( worst, error / scale );
+    }
+  }
+  return worst;
+}
+
+} // namespace
+
+int
+main()
+{
+  int status = 0;
+
+  std::vector< NamedAction > actions = {
+    { "gravity", { 6378136.3, 3.986004415E+14, 1.082626925638815E-3 },
+      []( const std::vector< double > &p ) -> std::shared_ptr< Action >
+      {
+        return std::make_shared< GravityAction >( "Earth", p[0], p[1],
+                                                  p[2] );
+      } },
+    { "atmosphere",
+      { 7078136.3, 3.614E-13, 88667.0, 7.29211585530066E-5,
+        ( 1.0 / 2.0 ) * 2.0 * ( 3.0 / 970.0 ) },
+      []( const std::vector< double > &p ) -> std::shared_ptr< Action >
+      {
+        return std::make_shared< AtmosphereAction >( "Earth Atmosphere",
+                                                     p[0], p[1], p[2], p[3],
+                                                     p[4] );
+      } },
+    { "tabulated atmosphere",
+      { 7.29211585530066E-5, ( 1.0 / 2.0 ) * 2.0 * ( 3.0 / 970.0 ) },
+      []( const std::vector< double > &p ) -> std::shared_ptr< Action >
+      {
+        return std::make_shared< TabulatedAtmosphereAction >(
+          "Earth Atmosphere", 6378136.3, p[0], p[1] );
+      } } };
+
+  // States along one revolution of the ekf_main.cpp orbit
+  Motion motion( bench::initialState(), 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  motion.setLogPolicy( Motion::kLogStateOnly );
+  motion.stepTo( 6000.0 );
+  std::vector< std::vector< double > > states;
+  for ( double t = 0.0; t <= 6000.0; t += 1000.0 )
+  {
+    states.push_back( motion.getState( t ) );
+  }
+
+  for ( const NamedAction &named: actions )
+  {
+    std::shared_ptr< Action > action = named.make( named.parameters );
+    std::vector< std::string > agents = action->getAgentsOwned();
+    int numAgents = agents.size();
+    AgentIndex index = action->indexAgents( agents );
+
+    double handVsDual = 0.0;
+    double dualVsDifferences = 0.0;
+    for ( const std::vector< double > &state: states )
+    {
+      Kinematics kinematics( action->getRotationRate() );
+      kinematics.update( state.data(), 0.0 );
+      std::vector< double > a( 3, 0.0 ), aDual( 3, 0.0 );
+      std::vector< double > hand( 3 * numAgents, 0.0 );
+      std::vector< double > dual( 3 * numAgents, 0.0 );
+      action->evaluate( a.data(), hand.data(), kinematics, index );
+      action->evaluateAutomatic( aDual.data(), dual.data(), kinematics,
+                                 index );
+      double accelerationError = 0.0;
+      for ( int i = 0; i < 3; ++i )
+      {
+        accelerationError = std::max( accelerationError,
+                                      std::abs( a[i] - aDual[i] ) /
+                                        std::abs( a[i] ) );
+      }
+      if ( accelerationError > 1.E-12 )
+      {
+        std::cout << "ERROR: evaluate and evaluateAutomatic accelerations "
+                  << "differ for " << named.name << std::endl;
+        status = 1;
+      }
+      handVsDual = std::max( handVsDual,
+                             worstColumnError( hand, dual, numAgents ) );
+      dualVsDifferences = std::max(
+        dualVsDifferences,
+        worstColumnError( dual, centralDifferences( named, state ),
+                          numAgents ) );
+    }
+
+    // Cost of each
+    Kinematics kinematics( action->getRotationRate() );
+    kinematics.update( bench::initialState().data(), 0.0 );
+    std::vector< double > a( 3, 0.0 );
+    std::vector< double > partials( 3 * numAgents, 0.0 );
+    double start = bench::seconds();
+    for ( int i = 0; i < kNumCalls; ++i )
+    {
+      action->evaluate( a.data(), partials.data(), kinematics, index );
+    }
+    double handTime = bench::seconds() - start;
+    start = bench::seconds();
+    for ( int i = 0; i < kNumCalls; ++i )
+    {
+      action->evaluateAutomatic( a.data(), partials.data(), kinematics,
+                                 index );
+    }
+    double dualTime = bench::seconds() - start;
+
+    std::cout << named.name << ", " << numAgents << " agents" << std::endl
+              << "   worst column error,  hand vs dual: " << handVsDual
+              << "  dual vs central differences: " << dualVsDifferences
+              << std::endl
+              << "   ns/call,  evaluate: " << 1.E9 * handTime / kNumCalls
+              << "  evaluateAutomatic: " << 1.E9 * dualTime / kNumCalls
+              << std::endl;
+    if ( ( handVsDual > 1.E-12 ) || ( dualVsDifferences > 1.E-6 ) )
+    {
+      std::cout << "ERROR: partials disagree for " << named.name
+                << std::endl;
+      status = 1;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,250 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_batch_least_squares.cpp
+/// @brief   Throughput and convergence of BatchLeastSquares on a
+///          multi-day arc.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Noisy X, Y, Z position observations of the ekf_main.cpp orbit every
+/// few seconds over three days are accumulated into the normal
+/// equations for the epoch state with mu, J2 and Cd: with a
+/// straightforward serial loop ( one getState and getStatePartials
+/// call and one rank-1 update per observation ), and with
+/// BatchLeastSquares on 1 thread and on every hardware thread, which
+/// must agree exactly. The epoch state is then fit by Gauss-Newton
+/// iterations on a shorter arc, from a reference that starts off the
+/// truth. An argument overrides the number of threads.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <BatchLeastSquares.hpp>
+#include <Motion.hpp>
+#include <ThreadPool.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kArcLength = 3 * 86400.0;
+const double kFitArcLength = 6 * 3600.0;
+const double kInterval = 3.0;
+const double kSigma = 5.0;
+const int kNumAgents = 9;
+const int kNumIterations = 4;
+
+typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                       Eigen::RowMajor > RowMatrix;
+
+// The reference trajectory over "arcLength" from epoch state "ic",
+// logged with its STM
+Motion
+propagateReference( const std::vector< double > &ic, double arcLength )
+{
+  Motion motion( ic, 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  motion.activateAgents( { "mu", "J2", "Cd" } );
+  motion.stepTo( arcLength );
+  return motion;
+}
+
+// Position observations of the truth every kInterval over "arcLength":
+// component k % 3 at times[k]
+void
+observe( double arcLength, std::vector< double > &times,
+         std::vector< double > &observed )
+{
+  Motion truth( bench::initialState(), 10. );
+  truth.addAction( bench::earthGravity() );
+  truth.addAction( bench::earthAtmosphere() );
+  truth.setLogPolicy( Motion::kLogStateOnly );
+  truth.stepTo( arcLength );
+
+  std::mt19937 generator( 2015 );
+  std::normal_distribution< double > normal;
+  times.clear();
+  observed.clear();
+  for ( double t = 0.0; t <= arcLength; t += kInterval )
+  {
+    std::vector< double > x = truth.getState( t );
+    for ( int i = 0; i < 3; ++i )
+    {
+      times.push_back( t );
+      observed.push_back( x[i] + kSigma * normal( generator ) );
+    }
+  }
+}
+
+// The measurement model of the observations
+BatchLeastSquares::Measurement
+positionMeasurement( const std::vector< double > &observed )
+{
+  return [ &observed ]( std::size_t k, double, const double *state,
+                        double *partials, double &residual, double &weight )
+  {
+    for ( int i = 0; i < kNumAgents; ++i )
+    {
+      partials[i] = ( i == int( k % 3 ) );
+    }
+    residual = observed[k] - state[ k % 3 ];
+    weight = 1.0 / ( kSigma * kSigma );
+    return true;
+  };
+}
+
+// Loose a priori sigmas: 1 km, 1 m/s and the parameters
+std::vector< double >
+aprioriCovariance()
+{
+  const int n = kNumAgents;
+  std::vector< double > P0( n * n, 0.0 );
+  double sigmas[] = { 1.E3, 1.E3, 1.E3, 1., 1., 1., 1.E8, 1.E-6, 1.E-2 };
+  for ( int i = 0; i < n; ++i )
+  {
+    P0[ i * n + i ] = sigmas[i] * sigmas[i];
+  }
+  return P0;
+}
+
+// Time the accumulation of the normal equations over the long arc
+bool
+benchThroughput( unsigned numThreads )
+{
+  const int n = kNumAgents;
+  std::vector< double > times, observed;
+  observe( kArcLength, times, observed );
+  BatchLeastSquares::Measurement measurement =
+    positionMeasurement( observed );
+
+  double start = bench::seconds();
+  Motion motion = propagateReference( bench::initialState(), kArcLength );
+  double propagateTime = bench::seconds() - start;
+
+  // Straightforward serial accumulation
+  start = bench::seconds();
+  Eigen::MatrixXd information = Eigen::MatrixXd::Zero( n, n );
+  Eigen::VectorXd normalVector = Eigen::VectorXd::Zero( n );
+  Eigen::RowVectorXd partials( n );
+  for ( std::size_t k = 0; k < times.size(); ++k )
+  {
+    std::vector< double > state = motion.getState( times[k] );
+    std::vector< double > phi = motion.getStatePartials( times[k] );
+    double residual, weight;
+    measurement( k, times[k], state.data(), partials.data(), residual,
+                 weight );
+    Eigen::RowVectorXd h =
+      partials * Eigen::Map< const RowMatrix >( phi.data(), n, n );
+    information.noalias() += weight * h.transpose() * h;
+    normalVector.noalias() += weight * residual * h.transpose();
+  }
+  double naiveTime = bench::seconds() - start;
+
+  ThreadPool serialPool( 1 );
+  BatchLeastSquares serial( n );
+  serial.setApriori( aprioriCovariance(), std::vector< double >( n, 0.0 ) );
+  start = bench::seconds();
+  serial.accumulate( motion, times, measurement, serialPool );
+  double serialTime = bench::seconds() - start;
+
+  ThreadPool pool( numThreads );
+  BatchLeastSquares parallel( n );
+  parallel.setApriori( aprioriCovariance(), std::vector< double >( n, 0.0 ) );
+  start = bench::seconds();
+  parallel.accumulate( motion, times, measurement, pool );
+  double parallelTime = bench::seconds() - start;
+
+  bool same = ( parallel.solve() == serial.solve() );
+  std::cout << times.size() << " observations over " << kArcLength
+            << " s, " << n << " estimated agents" << std::endl
+            << "   reference propagation ms: " << 1.E3 * propagateTime
+            << std::endl
+            << "   accumulate ms,  naive serial: " << 1.E3 * naiveTime
+            << "  1 thread: " << 1.E3 * serialTime << "  " << numThreads
+            << " threads: " << 1.E3 * parallelTime << std::endl
+            << "   M observations/s: " << times.size() / parallelTime / 1.E6
+            << "  same result on 1 and " << numThreads << " threads: "
+            << ( same ? "yes" : "NO" ) << std::endl;
+  return same;
+}
+
+// Fit the epoch state by Gauss-Newton iterations on the short arc
+void
+benchFit( unsigned numThreads )
+{
+  const int n = kNumAgents;
+  std::vector< double > times, observed;
+  observe( kFitArcLength, times, observed );
+  BatchLeastSquares::Measurement measurement =
+    positionMeasurement( observed );
+
+  // A priori: 100 m and 0.1 m/s off the truth, parameters at their
+  // nominal values
+  std::vector< double > apriori = bench::initialState();
+  for ( int i = 0; i < 6; ++i )
+  {
+    apriori[i] += ( i < 3 ) ? 100. : 0.1;
+  }
+
+  std::cout << "Gauss-Newton fit, " << times.size()
+            << " observations over " << kFitArcLength << " s" << std::endl;
+  ThreadPool pool( numThreads );
+  std::vector< double > reference = apriori;
+  for ( int iteration = 0; iteration < kNumIterations; ++iteration )
+  {
+    Motion motion = propagateReference( reference, kFitArcLength );
+    std::vector< double > deviation( n, 0.0 );
+    for ( int i = 0; i < 6; ++i )
+    {
+      deviation[i] = apriori[i] - reference[i];
+    }
+
+    BatchLeastSquares estimator( n );
+    estimator.setApriori( aprioriCovariance(), deviation );
+    estimator.accumulate( motion, times, measurement, pool );
+    std::vector< double > correction = estimator.solve();
+    double rms = std::sqrt( estimator.getResidualSquares() /
+                            estimator.getNumObservations() );
+    for ( int i = 0; i < 6; ++i )
+    {
+      reference[i] += correction[i];
+    }
+    double error = 0.0;
+    for ( int i = 0; i < 3; ++i )
+    {
+      double d = reference[i] - bench::initialState()[i];
+      error += d * d;
+    }
+    std::cout << "   iteration " << iteration + 1
+              << "  rms residual / sigma: " << rms
+              << "  epoch position error ( m ): " << std::sqrt( error )
+              << std::endl;
+  }
+}
+
+} // namespace
+
+int
+main( int argc, char **argv )
+{
+  unsigned numThreads = ( argc > 1 ) ? std::atoi( argv[1] ) :
+                        std::thread::hardware_concurrency();
+  numThreads = std::max( numThreads, 1u );
+
+  bool same = benchThroughput( numThreads );
+  benchFit( numThreads );
+  return same ? 0 : 1;
+}
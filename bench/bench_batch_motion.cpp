@@ -0,0 +1,166 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_batch_motion.cpp
+/// @brief   Compare catalog propagation with one Motion per object and
+///          with BatchMotion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The catalog is the ekf_main.cpp orbit rotated and scaled into many
+/// different orbits under the same gravity and atmosphere. Every object
+/// is propagated over one orbit with a Motion, as done today, with a
+/// state-only error controlled Motion, and with BatchMotion. The
+/// BatchMotion states are compared with the scalar ones and with a
+/// tight tolerance reference.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// ekf Library
+#include <BatchMotion.hpp>
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const int kNumObjects = 256;
+const double kArcLength = 6000.0;
+
+// Object k of the catalog: the ekf_main.cpp state rotated about X and Z,
+// with its radius scaled and its velocity scaled to match
+std::vector< double >
+catalogState( int k )
+{
+  std::vector< double > ic = bench::initialState();
+  double a = 0.61 * k;
+  double b = 0.23 * ( k % 7 );
+  double scale = 1.0 + 0.01 * ( k % 11 );
+
+  std::vector< double > state( 6 );
+  for ( int v = 0; v < 2; ++v )
+  {
+    double f = ( v == 0 ) ? scale : 1.0 / std::sqrt( scale );
+    double x = f * ic[ 3 * v ];
+    double y = f * ic[ 3 * v + 1 ];
+    double z = f * ic[ 3 * v + 2 ];
+    double y1 = std::cos( b ) * y - std::sin( b ) * z;
+    double z1 = std::sin( b ) * y + std::cos( b ) * z;
+    state[ 3 * v ] = std::cos( a ) * x - std::sin( a ) * y1;
+    state[ 3 * v + 1 ] = std::sin( a ) * x + std::cos( a ) * y1;
+    state[ 3 * v + 2 ] = z1;
+  }
+  return state;
+}
+
+// Propagate object k with a Motion
+std::vector< double >
+propagateMotion( int k, Motion::ErrorControl control, double absTol,
+                 double relTol, unsigned long &rhsCount )
+{
+  Motion motion( catalogState( k ), 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  motion.setLogPolicy( Motion::kLogNothing );
+  motion.setErrorControl( control, absTol, relTol );
+  motion.stepTo( kArcLength );
+  rhsCount += motion.getRhsCount();
+  return motion.getState( kArcLength );
+}
+
+double
+positionDifference( const std::vector< double > &a,
+                    const std::vector< double > &b )
+{
+  double diff = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    diff = std::max( diff, std::abs( a[i] - b[i] ) );
+  }
+  return diff;
+}
+
+} // namespace
+
+int
+main()
+{
+  std::cout << kNumObjects << " objects over " << kArcLength << " s, "
+            << BatchKinematics::kLanes << " lanes per group" << std::endl;
+
+  // One Motion per object, as today
+  std::vector< std::vector< double > > motionStates, stateOnlyStates;
+  unsigned long motionRhs = 0;
+  double start = bench::seconds();
+  for ( int k = 0; k < kNumObjects; ++k )
+  {
+    motionStates.push_back(
+      propagateMotion( k, Motion::kControlAll, 1.E-10, 1.E-9, motionRhs ) );
+  }
+  double motionTime = bench::seconds() - start;
+
+  unsigned long stateOnlyRhs = 0;
+  start = bench::seconds();
+  for ( int k = 0; k < kNumObjects; ++k )
+  {
+    stateOnlyStates.push_back(
+      propagateMotion( k, Motion::kControlStateOnly, 1.E-10, 1.E-9,
+                       stateOnlyRhs ) );
+  }
+  double stateOnlyTime = bench::seconds() - start;
+
+  // All objects in one BatchMotion
+  BatchMotion batch( 10. );
+  batch.addAction( bench::earthGravity() );
+  batch.addAction( bench::earthAtmosphere() );
+  for ( int k = 0; k < kNumObjects; ++k )
+  {
+    batch.addAgent( catalogState( k ) );
+  }
+  start = bench::seconds();
+  batch.stepTo( kArcLength );
+  double batchTime = bench::seconds() - start;
+
+  // Compare with the scalar path, and with a tight tolerance reference
+  // on a few objects
+  double maxDiff = 0.0;
+  for ( int k = 0; k < kNumObjects; ++k )
+  {
+    maxDiff = std::max( maxDiff, positionDifference( batch.getState( k ),
+                                                     stateOnlyStates[k] ) );
+  }
+  double batchError = 0.0;
+  double motionError = 0.0;
+  unsigned long truthRhs = 0;
+  for ( int k = 0; k < kNumObjects; k += 32 )
+  {
+    std::vector< double > truth = propagateMotion(
+      k, Motion::kControlStateOnly, 1.E-14, 1.E-14, truthRhs );
+    batchError = std::max( batchError,
+                           positionDifference( batch.getState( k ), truth ) );
+    motionError = std::max( motionError,
+                            positionDifference( stateOnlyStates[k], truth ) );
+  }
+
+  std::cout << "   Motion, full control      ms: " << 1.E3 * motionTime
+            << "  rhs calls: " << motionRhs << std::endl
+            << "   Motion, state-only        ms: " << 1.E3 * stateOnlyTime
+            << "  rhs calls: " << stateOnlyRhs << std::endl
+            << "   BatchMotion               ms: " << 1.E3 * batchTime
+            << "  group rhs calls: " << batch.getRhsCount() << std::endl
+            << "   objects per second, Motion: "
+            << kNumObjects / motionTime
+            << "  BatchMotion: " << kNumObjects / batchTime << std::endl
+            << "   max |BatchMotion - state-only Motion| position ( m ): "
+            << maxDiff << std::endl
+            << "   max position error vs 1e-14 reference ( m ), "
+            << "Motion: " << motionError
+            << "  BatchMotion: " << batchError << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_dense_output.cpp
+/// @brief   Time state and STM queries at arbitrary epochs of a
+///          propagated Motion, and check them against direct
+///          integration to those epochs.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+void
+setUp( Motion &motion )
+{
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  std::vector< std::string > agents = bench::activeAgents( 9 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+}
+
+} // namespace
+
+int
+main()
+{
+  const double arcLength = 86400.0;
+  const int numQueries = 100000;
+
+  Motion motion( bench::initialState(), 60. );
+  setUp( motion );
+  motion.stepTo( arcLength );
+
+  // Query state and STM at many epochs that are not integrator steps
+  double start = bench::seconds();
+  double checksum = 0.0;
+  for ( int i = 0; i < numQueries; ++i )
+  {
+    double t = arcLength * ( i + 0.5 ) / numQueries;
+    checksum += motion.getState( t )[0] + motion.getStatePartials( t )[0];
+  }
+  double elapsed = bench::seconds() - start;
+
+  std::cout << "state + STM query: " << 1.E9 * elapsed / numQueries
+            << " ns ( checksum " << checksum << " )" << std::endl;
+
+  // Compare interpolated values against integrating straight to a few
+  // of the epochs
+  double maxPosError = 0.0;
+  double maxVelError = 0.0;
+  double maxStmError = 0.0;
+  for ( double t: { 1234.5, 20000.25, 43210.125, 86399.5 } )
+  {
+    Motion direct( bench::initialState(), 60. );
+    setUp( direct );
+    direct.stepTo( t );
+
+    std::vector< double > a = motion.getState( t );
+    std::vector< double > b = direct.getState( t );
+    for ( int i = 0; i < 3; ++i )
+    {
+      maxPosError = std::max( maxPosError, std::abs( a[i] - b[i] ) );
+      maxVelError = std::max( maxVelError,
+                              std::abs( a[i + 3] - b[i + 3] ) );
+    }
+    std::vector< double > pa = motion.getStatePartials( t );
+    std::vector< double > pb = direct.getStatePartials( t );
+    for ( std::size_t i = 0; i < pa.size(); ++i )
+    {
+      maxStmError = std::max( maxStmError, std::abs( pa[i] - pb[i] ) /
+                              std::max( 1.0, std::abs( pb[i] ) ) );
+    }
+  }
+
+  std::cout << "max position error vs direct integration ( m ): "
+            << maxPosError << std::endl
+            << "max velocity error vs direct integration ( m/s ): "
+            << maxVelError << std::endl
+            << "max relative STM error vs direct integration: "
+            << maxStmError << std::endl;
+
+  return 0;
+}
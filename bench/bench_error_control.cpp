@@ -0,0 +1,98 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_error_control.cpp
+/// @brief   Compare step size control on the full state+STM with control
+///          on the state alone, on the ekf_main.cpp scenario.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+struct Result
+{
+  std::vector< double > state;
+  std::vector< double > partials;
+  unsigned long rhsCount;
+  double seconds;
+};
+
+// Propagate the ekf_main.cpp set up to t with the given error control
+Result
+propagate( double t, Motion::ErrorControl control, double absTol,
+           double relTol )
+{
+  Motion motion( bench::initialState(), 1 );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  std::vector< std::string > agents = bench::activeAgents( 18 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+  motion.setLogPolicy( Motion::kLogNothing );
+  motion.setErrorControl( control, absTol, relTol );
+
+  Result result;
+  double start = bench::seconds();
+  motion.stepTo( t );
+  result.seconds = bench::seconds() - start;
+  result.state = motion.getState( t );
+  result.partials = motion.getStatePartials( t );
+  result.rhsCount = motion.getRhsCount();
+  return result;
+}
+
+void
+report( const char *label, const Result &result, const Result &truth )
+{
+  double posError = 0.0;
+  double velError = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    posError = std::max( posError,
+                         std::abs( result.state[i] - truth.state[i] ) );
+    velError = std::max( velError,
+                         std::abs( result.state[i + 3] - truth.state[i + 3] ) );
+  }
+  double stmError = 0.0;
+  for ( std::size_t i = 0; i < truth.partials.size(); ++i )
+  {
+    stmError = std::max( stmError,
+                         std::abs( result.partials[i] - truth.partials[i] ) /
+                         std::max( 1.0, std::abs( truth.partials[i] ) ) );
+  }
+
+  std::cout << "   " << label
+            << "  rhs calls: " << result.rhsCount
+            << "  ms: " << 1.E3 * result.seconds
+            << "  position error ( m ): " << posError
+            << "  velocity error ( m/s ): " << velError
+            << "  relative STM error: " << stmError << std::endl;
+}
+
+} // namespace
+
+int
+main()
+{
+  for ( double t: { 10., 6000., 86400. } )
+  {
+    Result truth = propagate( t, Motion::kControlAll, 1.E-14, 1.E-14 );
+    std::cout << "t = " << t << " s" << std::endl;
+    report( "full state+STM", propagate( t, Motion::kControlAll,
+                                         1.E-10, 1.E-9 ), truth );
+    report( "state only    ", propagate( t, Motion::kControlStateOnly,
+                                         1.E-10, 1.E-9 ), truth );
+  }
+  return 0;
+}
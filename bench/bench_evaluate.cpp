@@ -0,0 +1,101 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_evaluate.cpp
+/// @brief   Time the per-stage cost of each Action, acceleration alone
+///          and fused with its partials.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Every right hand side evaluation fills in the Kinematics once and
+/// then calls Action::evaluate once per action. This benchmark times
+/// the Kinematics update on its own, and each action's evaluate next to
+/// its getAcceleration, so the difference is the marginal cost of the
+/// partials. It also checks that both return the same acceleration.
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Action.hpp>
+#include <Kinematics.hpp>
+#include <bench/BenchScenario.hpp>
+
+int
+main()
+{
+  const int numCalls = 1000000;
+  int status = 0;
+
+  // Every agent owned by either action, so all partials are written
+  std::vector< std::string > agents = {
+    "X", "Y", "Z", "dX", "dY", "dZ", "radius", "mu", "J2",
+    "h_ref", "rho_ref", "step", "rot", "Cd" };
+
+  std::vector< std::pair< std::string, std::shared_ptr< Action > > > actions = {
+    { "gravity", bench::earthGravity() },
+    { "atmosphere", bench::earthAtmosphere() } };
+
+  // Shared geometry, prepared once per stage whatever the actions
+  std::vector< double > state = bench::initialState();
+  Kinematics kinematics( 7.29211585530066E-5 );
+  double start = bench::seconds();
+  for ( int i = 0; i < numCalls; ++i )
+  {
+    state[0] += 1.E-6;
+    kinematics.update( state.data(), 0.0 );
+  }
+  std::cout << "kinematics   update ns/call: "
+            << 1.E9 * ( bench::seconds() - start ) / numCalls << std::endl;
+
+  for ( auto &named: actions )
+  {
+    const Action &action = *named.second;
+    AgentIndex index = action.indexAgents( agents );
+    kinematics = Kinematics( action.getRotationRate() );
+    kinematics.update( bench::initialState().data(), 0.0 );
+    std::vector< double > accel( 3, 0.0 );
+    std::vector< double > fusedAccel( 3, 0.0 );
+    std::vector< double > partials( 3 * agents.size(), 0.0 );
+
+    // The actions are virtual calls into another translation unit, so
+    // the loops below cannot be hoisted
+    start = bench::seconds();
+    for ( int i = 0; i < numCalls; ++i )
+    {
+      action.getAcceleration( accel.data(), kinematics );
+    }
+    double accelTime = bench::seconds() - start;
+
+    start = bench::seconds();
+    for ( int i = 0; i < numCalls; ++i )
+    {
+      action.evaluate( fusedAccel.data(), partials.data(), kinematics,
+                       index );
+    }
+    double evaluateTime = bench::seconds() - start;
+
+    std::cout << named.first
+              << "   getAcceleration ns/call: " << 1.E9 * accelTime / numCalls
+              << "   evaluate ns/call: " << 1.E9 * evaluateTime / numCalls
+              << std::endl;
+
+    for ( int i = 0; i < 3; ++i )
+    {
+      if ( std::abs( accel[i] - fusedAccel[i] ) >
+           1.E-12 * std::abs( accel[i] ) )
+      {
+        std::cout << "ERROR: evaluate and getAcceleration disagree for "
+                  << named.first << std::endl;
+        status = 1;
+      }
+    }
+  }
+
+  return status;
+}
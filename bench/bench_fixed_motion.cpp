@@ -0,0 +1,141 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_fixed_motion.cpp
+/// @brief   Compare the dynamically sized Motion / OdeintHelper with the
+///          compile-time sized FixedMotion / FixedOdeintHelper.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <ActionList.hpp>
+#include <FixedMotion.hpp>
+#include <Motion.hpp>
+#include <OdeintHelper.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const int kNumCalls = 200000;
+const double kArcLength = 86400.0;
+
+// Time one right hand side call of each helper for N agents
+template< int N >
+void
+benchRhs( std::vector< std::shared_ptr< Action > > &actions )
+{
+  std::vector< std::string > agents = bench::activeAgents( N );
+  std::vector< double > ic = bench::initialState();
+
+  OdeintHelper dynamicHelper( actions, agents );
+  dynamicHelper.activateAgents();
+  std::vector< double > x( 6 + N * N, 0.0 );
+  std::copy( ic.begin(), ic.end(), x.begin() );
+  for ( int i = 0; i < N; ++i )
+  {
+    x[ 6 + i * N + i ] = 1.0;
+  }
+  std::vector< double > dxdt( x.size(), 0.0 );
+
+  double start = bench::seconds();
+  for ( int i = 0; i < kNumCalls; ++i )
+  {
+    dynamicHelper( x, dxdt, 0.0 );
+  }
+  double dynamicTime = bench::seconds() - start;
+
+  ActionList forces( actions );
+  FixedOdeintHelper< N > fixedHelper( forces, agents );
+  fixedHelper.activateAgents();
+  typename FixedOdeintHelper< N >::state_type fx, fdxdt;
+  std::copy( x.begin(), x.end(), fx.begin() );
+
+  start = bench::seconds();
+  for ( int i = 0; i < kNumCalls; ++i )
+  {
+    fixedHelper( fx, fdxdt, 0.0 );
+  }
+  double fixedTime = bench::seconds() - start;
+
+  double maxDiff = 0.0;
+  for ( std::size_t i = 0; i < x.size(); ++i )
+  {
+    maxDiff = std::max( maxDiff, std::abs( dxdt[i] - fdxdt[i] ) );
+  }
+
+  std::cout << "N = " << N << " right hand side" << std::endl
+            << "   dynamic ns/call: " << 1.E9 * dynamicTime / kNumCalls
+            << std::endl
+            << "   fixed ns/call:   " << 1.E9 * fixedTime / kNumCalls
+            << std::endl
+            << "   max |difference|: " << maxDiff << std::endl;
+}
+
+// Time a propagation of each Motion for N agents
+template< int N >
+void
+benchPropagation()
+{
+  std::vector< std::string > agents = bench::activeAgents( N );
+  std::vector< std::string > params( agents.begin() + 6, agents.end() );
+
+  Motion dynamicMotion( bench::initialState(), 10. );
+  dynamicMotion.addAction( bench::earthGravity() );
+  dynamicMotion.addAction( bench::earthAtmosphere() );
+  dynamicMotion.activateAgents( params );
+  // FixedMotion only keeps the current state
+  dynamicMotion.setLogPolicy( Motion::kLogNothing );
+
+  double start = bench::seconds();
+  dynamicMotion.stepTo( kArcLength );
+  double dynamicTime = bench::seconds() - start;
+
+  FixedMotion< N > fixedMotion( bench::initialState(), 10. );
+  fixedMotion.addAction( bench::earthGravity() );
+  fixedMotion.addAction( bench::earthAtmosphere() );
+  fixedMotion.activateAgents( params );
+
+  start = bench::seconds();
+  fixedMotion.stepTo( kArcLength );
+  double fixedTime = bench::seconds() - start;
+
+  std::vector< double > dynamicState = dynamicMotion.getState( kArcLength );
+  std::vector< double > fixedState = fixedMotion.getState();
+  double maxDiff = 0.0;
+  for ( int i = 0; i < 6; ++i )
+  {
+    maxDiff = std::max( maxDiff, std::abs( dynamicState[i] - fixedState[i] ) );
+  }
+
+  std::cout << "N = " << N << " propagation over " << kArcLength << " s"
+            << std::endl
+            << "   Motion ms:      " << 1.E3 * dynamicTime << std::endl
+            << "   FixedMotion ms: " << 1.E3 * fixedTime << std::endl
+            << "   max |state difference|: " << maxDiff << std::endl;
+}
+
+} // namespace
+
+int
+main()
+{
+  std::vector< std::shared_ptr< Action > > actions = {
+    bench::earthGravity(), bench::earthAtmosphere() };
+
+  benchRhs< 6 >( actions );
+  benchRhs< 9 >( actions );
+  benchRhs< 12 >( actions );
+
+  benchPropagation< 6 >();
+  benchPropagation< 9 >();
+  benchPropagation< 12 >();
+
+  return 0;
+}
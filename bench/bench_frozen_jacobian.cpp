@@ -0,0 +1,242 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_frozen_jacobian.cpp
+/// @brief   Accuracy and speed of the frozen Jacobian STM approximation
+///          of Motion.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The ekf_main.cpp case, gravity to J2 and drag with all 18 agents
+/// active, is flown to 10 s as ekf_main.cpp does, for one revolution
+/// and for a day. dopri5 controlling every component, dopri5
+/// controlling the state only and Runge-Kutta-Fehlberg 7(8) are each run
+/// with the partials evaluated at every stage and frozen over each
+/// step, and compared with Runge-Kutta-Fehlberg 7(8) at 1e-14 for the
+/// final position and STM. The STM of each frozen run is also compared
+/// with its exact twin. The same orbit is then flown to 10 s and for a
+/// revolution in a degree 30 field, written to $TMPDIR ( or /tmp ),
+/// where the partials cost more than the STM product. Fails if freezing
+/// the Jacobian moves the final position by more than a micrometre when
+/// the STM is not under error control.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <GravityField.hpp>
+#include <Motion.hpp>
+#include <SphericalHarmonicAction.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kRadius = 6378136.3;
+const double kMu = 3.986004415E+14;
+const double kJ2 = 1.082626925638815E-3;
+const double kRotation = 7.29211585530066E-5;
+const int kDegree = 30;
+
+struct Setup
+{
+  const char *name;
+  Motion::Integrator integrator;
+  Motion::ErrorControl control;
+  double absTol;
+  double relTol;
+};
+
+struct Result
+{
+  std::vector< double > state;
+  std::vector< double > partials;
+  Motion::IntegrationStats stats;
+  double seconds;
+};
+
+// Write a field of degree "degree": the J2 of ekf_main.cpp and Kaula's
+// rule coefficients 1.E-5 / n^2 for the rest
+void
+writeField( const std::string &path, int degree )
+{
+  std::size_t size = GravityField::index( degree + 1, 0 );
+  std::vector< double > C( size, 0.0 ), S( size, 0.0 );
+  std::mt19937 generator( 42 );
+  std::normal_distribution< double > normal;
+  for ( int n = 2; n <= degree; ++n )
+  {
+    for ( int m = 0; m <= n; ++m )
+    {
+      C[ GravityField::index( n, m ) ] = 1.E-5 / ( n * n ) *
+                                         normal( generator );
+      S[ GravityField::index( n, m ) ] = ( m > 0 ) ?
+        1.E-5 / ( n * n ) * normal( generator ) : 0.0;
+    }
+  }
+  C[0] = 1.0;
+  C[ GravityField::index( 2, 0 ) ] = -kJ2 / std::sqrt( 5.0 );
+  GravityField::write( path, kMu, kRadius, degree, C, S );
+}
+
+// Fly the ekf_main.cpp orbit and agents in "gravity" and the ekf_main.cpp
+// atmosphere to "arc", "repeats" times; the time is per run
+Result
+propagate( std::shared_ptr< Action > gravity, const Setup &setup,
+           bool frozen, double arc, int repeats )
+{
+  Result result;
+  double start = bench::seconds();
+  for ( int r = 0; r < repeats; ++r )
+  {
+    Motion motion( bench::initialState(), 1. );
+    motion.addAction( gravity );
+    motion.addAction( bench::earthAtmosphere() );
+    std::vector< std::string > agents = bench::activeAgents( 18 );
+    motion.activateAgents(
+      std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+    motion.setLogPolicy( Motion::kLogNothing );
+    motion.setIntegrator( setup.integrator, setup.absTol, setup.relTol );
+    motion.setErrorControl( setup.control, setup.absTol, setup.relTol );
+    motion.setFrozenJacobian( frozen );
+    motion.stepTo( arc );
+    if ( r == 0 )
+    {
+      result.state = motion.getState( arc );
+      result.partials = motion.getStatePartials( arc );
+      result.stats = motion.getIntegrationStats();
+    }
+  }
+  result.seconds = ( bench::seconds() - start ) / repeats;
+  return result;
+}
+
+double
+distance( const std::vector< double > &a, const std::vector< double > &b )
+{
+  double sum = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    sum += ( a[i] - b[i] ) * ( a[i] - b[i] );
+  }
+  return std::sqrt( sum );
+}
+
+// Largest STM error of "a" wrt "b", relative to the largest element of
+// its column in "b"
+double
+stmDistance( const std::vector< double > &a, const std::vector< double > &b )
+{
+  int n = int( std::sqrt( double( b.size() ) ) + 0.5 );
+  double worst = 0.0;
+  for ( int c = 0; c < n; ++c )
+  {
+    double scale = 0.0;
+    double error = 0.0;
+    for ( int r = 0; r < n; ++r )
+    {
+      scale = std::max( scale, std::abs( b[ r * n + c ] ) );
+      error = std::max( error, std::abs( a[ r * n + c ] - b[ r * n + c ] ) );
+    }
+    if ( scale > 0.0 )
+    {
+      worst = std::max( worst, error / scale );
+    }
+  }
+  return worst;
+}
+
+void
+report( const std::string &label, const Result &result, const Result &exact,
+        const Result &truth )
+{
+  std::cout << "   " << std::setw( 19 ) << label << "  " << std::setw( 9 )
+            << result.stats.rhsCalls << "  " << std::setw( 9 )
+            << result.stats.jacobianCalls << "  " << std::setw( 9 )
+            << 1.E3 * result.seconds << "  " << std::setw( 12 )
+            << distance( result.state, truth.state ) << "  "
+            << std::setw( 11 ) << stmDistance( result.partials, truth.partials )
+            << "  " << stmDistance( result.partials, exact.partials )
+            << std::endl;
+}
+
+// Report every setup on "arc", returning false if freezing moved the
+// position under state only error control
+bool
+compare( const std::string &name, std::shared_ptr< Action > gravity,
+         double arc, int repeats )
+{
+  const Setup kSetups[] = {
+    { "dopri5 all", Motion::kDopri5, Motion::kControlAll, 1.E-10, 1.E-9 },
+    { "dopri5 state", Motion::kDopri5, Motion::kControlStateOnly, 1.E-10,
+      1.E-9 },
+    { "rkf78 all", Motion::kRungeKuttaFehlberg78, Motion::kControlAll,
+      1.E-10, 1.E-9 } };
+  const Setup kTruth = { "rkf78", Motion::kRungeKuttaFehlberg78,
+                         Motion::kControlAll, 1.E-14, 1.E-14 };
+
+  bool same = true;
+  Result truth = propagate( gravity, kTruth, false, arc, 1 );
+  std::cout << name << " to " << arc << " s" << std::endl
+            << "                   run  rhs calls  jacobians         ms"
+            << "   position m  rel STM err  vs exact STM" << std::endl;
+  for ( const Setup &setup: kSetups )
+  {
+    Result exact = propagate( gravity, setup, false, arc, repeats );
+    Result frozen = propagate( gravity, setup, true, arc, repeats );
+    report( std::string( setup.name ) + " exact", exact, exact, truth );
+    report( std::string( setup.name ) + " frozen", frozen, exact, truth );
+    if ( ( setup.control == Motion::kControlStateOnly ) &&
+         ( distance( frozen.state, exact.state ) > 1.E-6 ) )
+    {
+      same = false;
+    }
+  }
+  return same;
+}
+
+} // namespace
+
+int
+main()
+{
+  int status = 0;
+  const char *tmp = std::getenv( "TMPDIR" );
+  std::string directory = tmp ? tmp : "/tmp";
+  std::string fieldPath = directory + "/bench_frozen_jacobian.grv";
+  writeField( fieldPath, kDegree );
+  std::shared_ptr< Action > field =
+    std::make_shared< SphericalHarmonicAction >(
+      "Earth", std::make_shared< GravityField >( fieldPath ), kRotation );
+  std::remove( fieldPath.c_str() );
+
+  // Period of the ekf_main.cpp orbit
+  std::vector< double > ic = bench::initialState();
+  double r = std::sqrt( ic[0] * ic[0] + ic[1] * ic[1] + ic[2] * ic[2] );
+  double v2 = ic[3] * ic[3] + ic[4] * ic[4] + ic[5] * ic[5];
+  double a = 1.0 / ( 2.0 / r - v2 / kMu );
+  double revolution = std::floor( 2.0 * M_PI * std::sqrt( a * a * a / kMu ) );
+
+  std::shared_ptr< Action > j2 = bench::earthGravity();
+  bool same = compare( "ekf_main.cpp case", j2, 10., 2000 );
+  same = compare( "ekf_main.cpp case", j2, revolution, 20 ) && same;
+  same = compare( "ekf_main.cpp case", j2, 86400., 2 ) && same;
+  same = compare( "degree 30 field", field, 10., 200 ) && same;
+  same = compare( "degree 30 field", field, revolution, 2 ) && same;
+  if ( !same )
+  {
+    std::cout << "ERROR: frozen Jacobian moved the state" << std::endl;
+    status = 1;
+  }
+  return status;
+}
@@ -0,0 +1,162 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_gauss_jackson.cpp
+/// @brief   Compare the Gauss-Jackson integrator of Motion with dopri5
+///          over multi-day arcs.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The ekf_main.cpp low orbit with drag and a geostationary orbit are
+/// flown with the state and the STM wrt mu, J2 and Cd for 1, 3 and 7
+/// days, with Gauss-Jackson at three fixed steps, its corrector at
+/// 1e-10, and with dopri5 at two tolerances, stepping to the end one
+/// hour at a time. Each run is compared with Runge-Kutta-Fehlberg 7(8)
+/// at 1e-14 for the final position and STM, and for the position
+/// interpolated half way. Fails if Gauss-Jackson at its smallest step
+/// is worse than 1 m.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kMu = 3.986004415E+14;
+const double kDay = 86400.;
+
+struct Result
+{
+  std::vector< double > state;
+  std::vector< double > partials;
+  std::vector< double > middle;
+  Motion::IntegrationStats stats;
+  double seconds;
+};
+
+Result
+propagate( const std::vector< double > &ic, bool drag, double arc,
+           Motion::Integrator integrator, double step, double tolerance )
+{
+  Motion motion( ic, step );
+  motion.addAction( bench::earthGravity() );
+  if ( drag )
+  {
+    motion.addAction( bench::earthAtmosphere() );
+  }
+  std::vector< std::string > agents = bench::activeAgents( 9 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+  motion.setLogPolicy( Motion::kLogStateOnly );
+  motion.setIntegrator( integrator, tolerance, tolerance );
+
+  Result result;
+  double start = bench::seconds();
+  for ( double t = 3600.; t < arc; t += 3600. )
+  {
+    motion.stepTo( t );
+  }
+  motion.stepTo( arc );
+  result.seconds = bench::seconds() - start;
+  result.state = motion.getState( arc );
+  result.partials = motion.getStatePartials( arc );
+  result.middle = motion.getState( 0.5 * arc + 17.3 );
+  result.stats = motion.getIntegrationStats();
+  return result;
+}
+
+double
+distance( const std::vector< double > &a, const std::vector< double > &b )
+{
+  double sum = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    sum += ( a[i] - b[i] ) * ( a[i] - b[i] );
+  }
+  return std::sqrt( sum );
+}
+
+// Prints the comparison with "truth", and returns the position error
+double
+report( const std::string &label, const Result &result,
+        const Result &truth )
+{
+  double stmError = 0.0;
+  for ( std::size_t i = 0; i < truth.partials.size(); ++i )
+  {
+    stmError = std::max( stmError,
+                         std::abs( result.partials[i] - truth.partials[i] ) /
+                         std::max( 1.0, std::abs( truth.partials[i] ) ) );
+  }
+  double error = distance( result.state, truth.state );
+  std::cout << "   " << std::setw( 18 ) << label << "  " << std::setw( 9 )
+            << result.stats.rhsCalls << "  " << std::setw( 8 )
+            << result.stats.acceptedSteps << "  " << std::setw( 8 )
+            << 1.E3 * result.seconds << "  " << std::setw( 12 ) << error
+            << "  " << std::setw( 12 )
+            << distance( result.middle, truth.middle ) << "  " << stmError
+            << std::endl;
+  return error;
+}
+
+} // namespace
+
+int
+main()
+{
+  int status = 0;
+  double geostationary = 42164000.;
+  double speed = std::sqrt( kMu / geostationary );
+  std::vector< double > geo = { geostationary, 0.0, 0.0, 0.0, speed, 0.0 };
+
+  const double kArcs[] = { 1., 3., 7. };
+  for ( int regime = 0; regime < 2; ++regime )
+  {
+    bool low = ( regime == 0 );
+    std::vector< double > ic = low ? bench::initialState() : geo;
+    const double kLowSteps[] = { 30., 60., 120. };
+    const double kHighSteps[] = { 300., 600., 1200. };
+    const double *steps = low ? kLowSteps : kHighSteps;
+    for ( double days: kArcs )
+    {
+      double arc = days * kDay;
+      Result truth = propagate( ic, low, arc, Motion::kRungeKuttaFehlberg78,
+                                10., 1.E-14 );
+      std::cout << ( low ? "ekf_main.cpp low orbit with drag, "
+                         : "geostationary orbit, " )
+                << days << " days" << std::endl
+                << "               run  rhs calls     steps        ms"
+                << "  final err m  middle err m  relative STM err"
+                << std::endl;
+      for ( int i = 0; i < 3; ++i )
+      {
+        double error = report(
+          "gauss-jackson " + std::to_string( int( steps[i] ) ) + "s",
+          propagate( ic, low, arc, Motion::kGaussJackson, steps[i],
+                     1.E-10 ),
+          truth );
+        if ( ( i == 0 ) && ( error > 1.0 ) )
+        {
+          std::cout << "ERROR: Gauss-Jackson is off by " << error << " m"
+                    << std::endl;
+          status = 1;
+        }
+      }
+      report( "dopri5 1e-10", propagate( ic, low, arc, Motion::kDopri5, 10.,
+                                         1.E-10 ), truth );
+      report( "dopri5 1e-12", propagate( ic, low, arc, Motion::kDopri5, 10.,
+                                         1.E-12 ), truth );
+    }
+  }
+  return status;
+}
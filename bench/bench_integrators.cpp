@@ -0,0 +1,152 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_integrators.cpp
+/// @brief   Compare the integrators of Motion by right hand side
+///          evaluations, steps, time and accuracy, per orbit regime.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Three regimes are flown with the state and the STM wrt mu, J2 and Cd:
+/// the ekf_main.cpp low orbit with drag for a day, a geostationary
+/// transfer orbit and a geostationary orbit for three days each. Every
+/// integrator is run at three tolerances, and compared with
+/// Runge-Kutta-Fehlberg 7(8) at 1e-14 for the final position and STM.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kMu = 3.986004415E+14;
+
+struct Regime
+{
+  const char *name;
+  std::vector< double > state;
+  bool drag;
+  double arc;
+};
+
+struct Result
+{
+  std::vector< double > state;
+  std::vector< double > partials;
+  Motion::IntegrationStats stats;
+  double seconds;
+};
+
+// Initial state of an orbit with the given perigee and apogee radii,
+// starting at perigee on a 28.5 degree inclination
+std::vector< double >
+orbitAtPerigee( double perigee, double apogee )
+{
+  double a = 0.5 * ( perigee + apogee );
+  double v = std::sqrt( kMu * ( 2.0 / perigee - 1.0 / a ) );
+  double inclination = 28.5 * M_PI / 180.0;
+  return { perigee, 0.0, 0.0, 0.0, v * std::cos( inclination ),
+           v * std::sin( inclination ) };
+}
+
+Result
+propagate( const Regime &regime, Motion::Integrator integrator,
+           double absTol, double relTol )
+{
+  Motion motion( regime.state, 10. );
+  motion.addAction( bench::earthGravity() );
+  if ( regime.drag )
+  {
+    motion.addAction( bench::earthAtmosphere() );
+  }
+  std::vector< std::string > agents = bench::activeAgents( 9 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+  motion.setLogPolicy( Motion::kLogNothing );
+  motion.setIntegrator( integrator, absTol, relTol );
+
+  Result result;
+  double start = bench::seconds();
+  motion.stepTo( regime.arc );
+  result.seconds = bench::seconds() - start;
+  result.state = motion.getState( regime.arc );
+  result.partials = motion.getStatePartials( regime.arc );
+  result.stats = motion.getIntegrationStats();
+  return result;
+}
+
+void
+report( const char *label, double tolerance, const Result &result,
+        const Result &truth )
+{
+  double posError = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    posError += ( result.state[i] - truth.state[i] ) *
+                ( result.state[i] - truth.state[i] );
+  }
+  double stmError = 0.0;
+  for ( std::size_t i = 0; i < truth.partials.size(); ++i )
+  {
+    stmError = std::max( stmError,
+                         std::abs( result.partials[i] - truth.partials[i] ) /
+                         std::max( 1.0, std::abs( truth.partials[i] ) ) );
+  }
+  std::cout << "   " << std::setw( 10 ) << label << "  " << std::setw( 5 )
+            << tolerance << "  " << std::setw( 9 ) << result.stats.rhsCalls
+            << "  " << std::setw( 8 ) << result.stats.acceptedSteps << "  "
+            << std::setw( 8 ) << result.stats.rejectedSteps << "  "
+            << std::setw( 8 ) << 1.E3 * result.seconds << "  "
+            << std::setw( 12 ) << std::sqrt( posError ) << "  "
+            << stmError << std::endl;
+}
+
+} // namespace
+
+int
+main()
+{
+  const Regime kRegimes[] = {
+    { "ekf_main.cpp low orbit with drag, one day", bench::initialState(),
+      true, 86400. },
+    { "geostationary transfer orbit, three days",
+      orbitAtPerigee( 6678136.3, 42164000. ), false, 3 * 86400. },
+    { "geostationary orbit, three days",
+      orbitAtPerigee( 42164000., 42164000. ), false, 3 * 86400. } };
+  const Motion::Integrator kIntegrators[] = {
+    Motion::kDopri5, Motion::kRungeKuttaFehlberg78, Motion::kBulirschStoer,
+    Motion::kAdamsBashforthMoulton };
+  const char *kNames[] = { "dopri5", "rkf78", "bs", "abm" };
+  const double kTolerances[] = { 1.E-8, 1.E-10, 1.E-12 };
+
+  for ( const Regime &regime: kRegimes )
+  {
+    Result truth = propagate( regime, Motion::kRungeKuttaFehlberg78,
+                              1.E-14, 1.E-14 );
+    std::cout << regime.name << std::endl
+              << "   integrator    tol  rhs calls  accepted  rejected"
+              << "        ms  position err m  relative STM err" << std::endl;
+    for ( int i = 0; i < 4; ++i )
+    {
+      for ( double tolerance: kTolerances )
+      {
+        // Relative tolerance one decade looser, as by default
+        report( kNames[i], tolerance,
+                propagate( regime, kIntegrators[i], tolerance,
+                           10. * tolerance ),
+                truth );
+      }
+    }
+  }
+  return 0;
+}
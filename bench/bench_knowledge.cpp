@@ -0,0 +1,282 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_knowledge.cpp
+/// @brief   Time the UD factorized filter updates against the
+///          conventional and Joseph form covariance updates, and run
+///          Knowledge on the ekf_main.cpp orbit.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// For 6 to 50 estimated agents, a random covariance goes through one
+/// time update and one scalar measurement update per agent, with
+/// UDCovariance and with dense Eigen matrices. The covariances must
+/// agree, and the UD path must not allocate. Knowledge then tracks a
+/// truth trajectory from noisy position measurements, counting the
+/// allocations of its steps after the first, which sizes the
+/// integrator workspaces, and of its updates. Fails if any are seen.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <Knowledge.hpp>
+#include <Motion.hpp>
+#include <UDCovariance.hpp>
+#include <bench/BenchScenario.hpp>
+
+// Count heap allocations, to check the UD updates do not allocate
+static unsigned long g_allocations = 0;
+
+void*
+operator new( std::size_t size )
+{
+  ++g_allocations;
+  void *p = std::malloc( size );
+  if ( !p )
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void
+operator delete( void *p ) noexcept
+{
+  std::free( p );
+}
+
+namespace
+{
+
+typedef Eigen::Matrix< double, Eigen::Dynamic, Eigen::Dynamic,
+                       Eigen::RowMajor > RowMatrix;
+
+const int kNumRepeats = 2000;
+
+// Time the time update and the scalar measurement update for "n"
+// agents, then check one time update followed by n measurement updates
+// against the Joseph form
+void
+benchUpdates( int n )
+{
+  std::mt19937 generator( n );
+  std::normal_distribution< double > normal;
+
+  // An orthogonal transition matrix, so repeated time updates stay
+  // bounded
+  RowMatrix A( n, n ), H( n, n );
+  for ( int i = 0; i < n; ++i )
+  {
+    for ( int j = 0; j < n; ++j )
+    {
+      A( i, j ) = normal( generator );
+      H( i, j ) = normal( generator );
+    }
+  }
+  RowMatrix stm = A.householderQr().householderQ();
+  RowMatrix P0 = A * A.transpose() + n * RowMatrix::Identity( n, n );
+  Eigen::VectorXd noise = Eigen::VectorXd::Constant( n, 0.01 );
+  const double variance = 0.25;
+  const int numUpdates = kNumRepeats * n;
+
+  // UD factors
+  std::vector< double > P0Vector( P0.data(), P0.data() + n * n );
+  UDCovariance ud( n, P0Vector );
+  std::vector< double > gain( n );
+  unsigned long allocations = g_allocations;
+  double start = bench::seconds();
+  for ( int r = 0; r < kNumRepeats; ++r )
+  {
+    ud.propagate( stm.data(), noise.data() );
+  }
+  double udPropagateTime = bench::seconds() - start;
+  start = bench::seconds();
+  for ( int k = 0; k < numUpdates; ++k )
+  {
+    ud.update( H.row( k % n ).data(), variance, gain.data() );
+  }
+  double udUpdateTime = bench::seconds() - start;
+  allocations = g_allocations - allocations;
+
+  // Dense, conventional and Joseph form updates
+  RowMatrix P = P0, IKH( n, n );
+  Eigen::VectorXd PHt( n ), K( n );
+  start = bench::seconds();
+  for ( int r = 0; r < kNumRepeats; ++r )
+  {
+    IKH.noalias() = stm * P;
+    P.noalias() = IKH * stm.transpose();
+    P.diagonal() += noise;
+  }
+  double densePropagateTime = bench::seconds() - start;
+  start = bench::seconds();
+  for ( int k = 0; k < numUpdates; ++k )
+  {
+    PHt.noalias() = P * H.row( k % n ).transpose();
+    K = PHt / ( H.row( k % n ).dot( PHt ) + variance );
+    P.noalias() -= K * PHt.transpose();
+  }
+  double conventionalTime = bench::seconds() - start;
+  P = P0;
+  start = bench::seconds();
+  for ( int k = 0; k < numUpdates; ++k )
+  {
+    PHt.noalias() = P * H.row( k % n ).transpose();
+    K = PHt / ( H.row( k % n ).dot( PHt ) + variance );
+    IKH = RowMatrix::Identity( n, n ) - K * H.row( k % n );
+    P = IKH * P * IKH.transpose() + variance * K * K.transpose();
+  }
+  double josephTime = bench::seconds() - start;
+
+  // One time update and n measurement updates, both ways
+  ud.setCovariance( P0.data() );
+  ud.propagate( stm.data(), noise.data() );
+  P = stm * P0 * stm.transpose();
+  P.diagonal() += noise;
+  for ( int k = 0; k < n; ++k )
+  {
+    ud.update( H.row( k ).data(), variance, gain.data() );
+    PHt.noalias() = P * H.row( k ).transpose();
+    K = PHt / ( H.row( k ).dot( PHt ) + variance );
+    IKH = RowMatrix::Identity( n, n ) - K * H.row( k );
+    P = IKH * P * IKH.transpose() + variance * K * K.transpose();
+  }
+  std::vector< double > udP( n * n );
+  ud.getCovariance( udP.data() );
+  double diff = ( Eigen::Map< RowMatrix >( udP.data(), n, n ) - P ).norm() /
+                P.norm();
+
+  std::cout << "n = " << n << std::endl
+            << "   time update us,  UD: "
+            << 1.E6 * udPropagateTime / kNumRepeats
+            << "  dense: " << 1.E6 * densePropagateTime / kNumRepeats
+            << std::endl
+            << "   scalar update ns,  UD: "
+            << 1.E9 * udUpdateTime / numUpdates
+            << "  conventional: " << 1.E9 * conventionalTime / numUpdates
+            << "  Joseph: " << 1.E9 * josephTime / numUpdates << std::endl
+            << "   relative |P_UD - P_Joseph|: " << diff
+            << "  UD heap allocations: " << allocations << std::endl;
+}
+
+// Track the ekf_main.cpp orbit from noisy position measurements,
+// returning false if a step after the first or an update allocated
+bool
+benchFilter()
+{
+  const double sigma = 10.0;
+  const double interval = 60.0;
+  const double arcLength = 6000.0;
+  std::mt19937 generator( 2015 );
+  std::normal_distribution< double > normal;
+
+  Motion truth( bench::initialState(), 10. );
+  truth.addAction( bench::earthGravity() );
+  truth.addAction( bench::earthAtmosphere() );
+  truth.setLogPolicy( Motion::kLogNothing );
+
+  // The filter starts 1 km and 1 m/s off, estimating mu, J2 and Cd too
+  std::vector< double > ic = bench::initialState();
+  for ( int i = 0; i < 6; ++i )
+  {
+    ic[i] += ( i < 3 ) ? 1000. : 1.;
+  }
+  Motion reference( ic, 10. );
+  reference.addAction( bench::earthGravity() );
+  reference.addAction( bench::earthAtmosphere() );
+  reference.activateAgents( { "mu", "J2", "Cd" } );
+  int n = reference.getActiveAgents().size();
+
+  std::vector< double > P0( n * n, 0.0 );
+  double sigmas[] = { 2000., 2000., 2000., 2., 2., 2., 1.E6, 1.E-9, 1.E-3 };
+  for ( int i = 0; i < n; ++i )
+  {
+    P0[ i * n + i ] = sigmas[i] * sigmas[i];
+  }
+  Knowledge filter( reference, P0 );
+
+  std::vector< double > partials( n );
+  double stepTime = 0.0;
+  double updateTime = 0.0;
+  unsigned long stepAllocations = 0;
+  unsigned long updateAllocations = 0;
+  int numSteps = 0;
+  for ( double t = interval; t <= arcLength; t += interval )
+  {
+    truth.stepTo( t );
+    std::vector< double > x = truth.getState( t );
+
+    unsigned long allocations = g_allocations;
+    double start = bench::seconds();
+    filter.step( t );
+    stepTime += bench::seconds() - start;
+    if ( numSteps > 0 )
+    {
+      stepAllocations += g_allocations - allocations;
+    }
+
+    allocations = g_allocations;
+    start = bench::seconds();
+    for ( int i = 0; i < 3; ++i )
+    {
+      std::fill( partials.begin(), partials.end(), 0.0 );
+      partials[i] = 1.0;
+      double observed = x[i] + sigma * normal( generator );
+      filter.update( observed - filter.getEstimate()[i], partials,
+                     sigma * sigma );
+    }
+    updateTime += bench::seconds() - start;
+    updateAllocations += g_allocations - allocations;
+    ++numSteps;
+  }
+
+  std::vector< double > x = truth.getState( arcLength );
+  std::vector< double > P = filter.getCovariance();
+  double error = 0.0;
+  double variance = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    double d = filter.getEstimate()[i] - x[i];
+    error += d * d;
+    variance += P[ i * n + i ];
+  }
+  std::cout << "Knowledge, " << n << " agents, " << numSteps
+            << " steps of " << interval << " s with 3 position measurements"
+            << std::endl
+            << "   us per step: " << 1.E6 * stepTime / numSteps
+            << "  us per 3 updates: " << 1.E6 * updateTime / numSteps
+            << std::endl
+            << "   final position error ( m ): " << std::sqrt( error )
+            << "  1 sigma ( m ): " << std::sqrt( variance ) << std::endl
+            << "   heap allocations,  steps: " << stepAllocations
+            << "  updates: " << updateAllocations << std::endl;
+  return ( stepAllocations == 0 ) && ( updateAllocations == 0 );
+}
+
+} // namespace
+
+int
+main()
+{
+  for ( int n: { 6, 9, 18, 30, 50 } )
+  {
+    benchUpdates( n );
+  }
+  if ( !benchFilter() )
+  {
+    std::cout << "ERROR: Knowledge allocated" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_log_policy.cpp
+/// @brief   Time a multi-day propagation under each Motion log policy.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kArcLength = 3 * 86400.0;
+
+// Propagate 18 agents over the arc after "configure" set the policy,
+// returning the final state and the elapsed time
+template< class Configure >
+std::vector< double >
+propagate( const char *label, Configure configure )
+{
+  Motion motion( bench::initialState(), 60. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  std::vector< std::string > agents = bench::activeAgents( 18 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+  configure( motion );
+
+  double start = bench::seconds();
+  motion.stepTo( kArcLength );
+  double elapsed = bench::seconds() - start;
+
+  std::cout << label << " ms: " << 1.E3 * elapsed << std::endl;
+  return motion.getState( kArcLength );
+}
+
+} // namespace
+
+int
+main()
+{
+  std::vector< double > reference = propagate( "every step      ",
+    []( Motion &m ) { m.setLogPolicy( Motion::kLogEveryStep ); } );
+  propagate( "state only      ",
+    []( Motion &m ) { m.setLogPolicy( Motion::kLogStateOnly ); } );
+  propagate( "every 10th step ",
+    []( Motion &m ) { m.setLogEveryKthStep( 10 ); } );
+  propagate( "hourly epochs   ",
+    []( Motion &m )
+    {
+      std::vector< double > epochs;
+      for ( double t = 0; t <= kArcLength; t += 3600. )
+      {
+        epochs.push_back( t );
+      }
+      m.setLogEpochs( epochs );
+    } );
+  std::vector< double > final = propagate( "nothing         ",
+    []( Motion &m ) { m.setLogPolicy( Motion::kLogNothing ); } );
+
+  std::cout << "final position difference, nothing vs every step ( m ): "
+            << std::abs( final[0] - reference[0] ) +
+               std::abs( final[1] - reference[1] ) +
+               std::abs( final[2] - reference[2] ) << std::endl;
+  return 0;
+}
@@ -0,0 +1,117 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_propagate_all.cpp
+/// @brief   Scaling of Motion::propagateAll with the number of threads.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The workload mixes drag-heavy low orbits with quiet high ones, whose
+/// arcs are several times cheaper, all sharing one gravity and one
+/// atmosphere Action. It is propagated serially, then with
+/// propagateAll on 1, 2, 4, ... threads up to the hardware threads,
+/// and every parallel result must match the serial one exactly. An
+/// argument overrides the largest number of threads tried.
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// ekf Library
+#include <Motion.hpp>
+#include <ThreadPool.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const int kNumMotions = 64;
+const double kArcLength = 86400.0;
+
+// Every third Motion is a low orbit, the others are four times higher
+std::vector< Motion >
+makeMotions( const std::shared_ptr< Action > &gravity,
+             const std::shared_ptr< Action > &atmosphere )
+{
+  std::vector< std::string > agents = bench::activeAgents( 9 );
+  std::vector< std::string > params( agents.begin() + 6, agents.end() );
+
+  std::vector< Motion > motions;
+  for ( int k = 0; k < kNumMotions; ++k )
+  {
+    std::vector< double > ic = bench::initialState();
+    double scale = ( k % 3 == 0 ) ? 1.0 : 4.0;
+    for ( int i = 0; i < 3; ++i )
+    {
+      ic[i] *= scale;
+      ic[i + 3] /= std::sqrt( scale );
+    }
+
+    Motion motion( ic, 10. );
+    motion.addAction( gravity );
+    motion.addAction( atmosphere );
+    motion.activateAgents( params );
+    motion.setLogPolicy( Motion::kLogNothing );
+    motions.push_back( motion );
+  }
+  return motions;
+}
+
+} // namespace
+
+int
+main( int argc, char **argv )
+{
+  std::shared_ptr< Action > gravity = bench::earthGravity();
+  std::shared_ptr< Action > atmosphere = bench::earthAtmosphere();
+
+  std::vector< Motion > serial = makeMotions( gravity, atmosphere );
+  double start = bench::seconds();
+  for ( Motion &motion: serial )
+  {
+    motion.stepTo( kArcLength );
+  }
+  double serialTime = bench::seconds() - start;
+  std::cout << kNumMotions << " Motions over " << kArcLength << " s"
+            << std::endl
+            << "   serial ms: " << 1.E3 * serialTime << std::endl;
+
+  unsigned maxThreads = std::max( 1u, std::thread::hardware_concurrency() );
+  if ( argc > 1 )
+  {
+    maxThreads = std::atoi( argv[1] );
+  }
+  int status = 0;
+  for ( unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+  {
+    ThreadPool pool( numThreads );
+    std::vector< Motion > motions = makeMotions( gravity, atmosphere );
+
+    start = bench::seconds();
+    Motion::propagateAll( motions, kArcLength, pool );
+    double elapsed = bench::seconds() - start;
+
+    bool same = true;
+    for ( int k = 0; k < kNumMotions; ++k )
+    {
+      same = same && ( motions[k].getState( kArcLength ) ==
+                       serial[k].getState( kArcLength ) );
+    }
+
+    std::cout << "   threads: " << numThreads
+              << "  ms: " << 1.E3 * elapsed
+              << "  speed up: " << serialTime / elapsed
+              << "  efficiency: " << serialTime / elapsed / numThreads
+              << ( same ? "" : "  ERROR: differs from serial" ) << std::endl;
+    if ( !same )
+    {
+      status = 1;
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,273 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_range_model.cpp
+/// @brief   Compare block evaluation of range and range-rate with a
+///          per-observation scalar model, and check the partials.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The ekf_main.cpp orbit is observed from three stations on the
+/// rotating Earth every second for a day. RangeModel::evaluate on
+/// blocks of observations is timed against the same model, with the
+/// range-rate partials, written one observation at a time. The partials
+/// are checked against central differences.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// ekf Library
+#include <Motion.hpp>
+#include <RangeModel.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kRotation = 7.29211585530066E-5;
+const double kArcLength = 86400.0;
+const std::size_t kBlockSize = 1024;
+const int kNumRepeats = 20;
+
+// Body-fixed station coordinates, by id 1 .. 3
+const double kStations[3][3] = {
+  { 1130745.0, -4831368.0, 3994084.0 },
+  { 4846691.0, -370199.0, 4116010.0 },
+  { -4460870.0, 2682367.0, -3674624.0 } };
+
+// The model written one observation at a time: range, range-rate and
+// the partials of range-rate with respect to position and the station
+void
+scalarRangeRate( double t, const double *station, const double *x,
+                 double &range, double &rangeRate, double *partials )
+{
+  double c = std::cos( kRotation * t );
+  double s = std::sin( kRotation * t );
+  double S[3] = { c * station[0] - s * station[1],
+                  s * station[0] + c * station[1], station[2] };
+  double vS[3] = { -kRotation * S[1], kRotation * S[0], 0.0 };
+  double rho[3] = { x[0] - S[0], x[1] - S[1], x[2] - S[2] };
+  range = std::sqrt( rho[0] * rho[0] + rho[1] * rho[1] + rho[2] * rho[2] );
+  double u[3], dv[3];
+  rangeRate = 0.0;
+  for ( int k = 0; k < 3; ++k )
+  {
+    u[k] = rho[k] / range;
+    dv[k] = x[ 3 + k ] - vS[k];
+    rangeRate += u[k] * dv[k];
+  }
+  double inertial[3];
+  for ( int k = 0; k < 3; ++k )
+  {
+    partials[k] = ( dv[k] - rangeRate * u[k] ) / range;
+    inertial[k] = -partials[k];
+  }
+  inertial[0] -= kRotation * u[1];
+  inertial[1] += kRotation * u[0];
+  partials[3] = c * inertial[0] + s * inertial[1];
+  partials[4] = -s * inertial[0] + c * inertial[1];
+  partials[5] = inertial[2];
+}
+
+// Fill block entries [first, first + size) of the observations
+void
+fillBlock( RangeBlock &block, const std::vector< double > &times,
+           const std::vector< std::vector< double > > &states,
+           std::size_t first )
+{
+  for ( std::size_t i = 0; i < block.size(); ++i )
+  {
+    std::size_t k = first + i;
+    block.time( i ) = times[k];
+    block.station[i] = 1 + k % 3;
+    for ( int c = 0; c < 3; ++c )
+    {
+      block.position[c]( i ) = states[k][c];
+      block.velocity[c]( i ) = states[k][ 3 + c ];
+    }
+  }
+}
+
+RangeModel
+makeModel( const double stations[3][3] )
+{
+  RangeModel model( kRotation );
+  for ( int id = 1; id <= 3; ++id )
+  {
+    model.addStation( id, stations[ id - 1 ][0], stations[ id - 1 ][1],
+                      stations[ id - 1 ][2] );
+  }
+  model.indexAgents( bench::activeAgents( 18 ) );
+  return model;
+}
+
+// Worst relative difference between the partials rows of observation
+// i and central differences over the spacecraft state and the
+// coordinates of its station
+double
+checkPartials( const std::vector< double > &state, double t, int id )
+{
+  const std::vector< std::string > agents = bench::activeAgents( 18 );
+  RangeBlock block( 1 );
+  RangeModel model = makeModel( kStations );
+
+  // Evaluate at the spacecraft state "x" and station coordinates
+  // "stations"
+  auto evaluate = [ & ]( const std::vector< double > &x,
+                         const double stations[3][3], double *out )
+  {
+    RangeModel m = makeModel( stations );
+    block.time( 0 ) = t;
+    block.station[0] = id;
+    for ( int c = 0; c < 3; ++c )
+    {
+      block.position[c]( 0 ) = x[c];
+      block.velocity[c]( 0 ) = x[ 3 + c ];
+    }
+    m.evaluate( block );
+    out[0] = block.range( 0 );
+    out[1] = block.rangeRate( 0 );
+  };
+
+  double nominal[2];
+  evaluate( state, kStations, nominal );
+  std::vector< double > rangeRow( agents.size() ), rateRow( agents.size() );
+  model.evaluate( block );
+  model.rangePartials( block, 0, rangeRow.data() );
+  model.rangeRatePartials( block, 0, rateRow.data() );
+
+  double worst = 0.0;
+  for ( std::size_t j = 0; j < agents.size(); ++j )
+  {
+    std::vector< double > xPlus = state, xMinus = state;
+    double plusStations[3][3], minusStations[3][3];
+    std::copy( &kStations[0][0], &kStations[0][0] + 9, &plusStations[0][0] );
+    std::copy( &kStations[0][0], &kStations[0][0] + 9, &minusStations[0][0] );
+    double h = ( j >= 3 && j < 6 ) ? 1.E-3 : 1.0;
+    if ( j < 6 )
+    {
+      xPlus[j] += h;
+      xMinus[j] -= h;
+    }
+    else if ( j >= 9 )
+    {
+      int station = ( j - 9 ) / 3;
+      int axis = ( j - 9 ) % 3;
+      plusStations[station][axis] += h;
+      minusStations[station][axis] -= h;
+    }
+    else
+    {
+      continue;
+    }
+
+    double plus[2], minus[2];
+    evaluate( xPlus, plusStations, plus );
+    evaluate( xMinus, minusStations, minus );
+    double numeric[2] = { ( plus[0] - minus[0] ) / ( 2 * h ),
+                          ( plus[1] - minus[1] ) / ( 2 * h ) };
+    double analytic[2] = { rangeRow[j], rateRow[j] };
+    for ( int m = 0; m < 2; ++m )
+    {
+      double scale = std::max( std::abs( numeric[m] ), 1.E-6 );
+      worst = std::max( worst, std::abs( numeric[m] - analytic[m] ) /
+                                 scale );
+    }
+  }
+  return worst;
+}
+
+} // namespace
+
+int
+main()
+{
+  // States at every second of the arc
+  Motion motion( bench::initialState(), 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  motion.setLogPolicy( Motion::kLogStateOnly );
+  motion.stepTo( kArcLength );
+  std::vector< double > times;
+  std::vector< std::vector< double > > states;
+  for ( double t = 0.0; t < kArcLength; t += 1.0 )
+  {
+    times.push_back( t );
+    states.push_back( motion.getState( t ) );
+  }
+  std::size_t numBlocks = times.size() / kBlockSize;
+  std::size_t numObservations = numBlocks * kBlockSize;
+
+  // Blocks
+  RangeModel model = makeModel( kStations );
+  std::vector< RangeBlock > blocks( numBlocks, RangeBlock( kBlockSize ) );
+  for ( std::size_t b = 0; b < numBlocks; ++b )
+  {
+    fillBlock( blocks[b], times, states, b * kBlockSize );
+  }
+  double start = bench::seconds();
+  for ( int r = 0; r < kNumRepeats; ++r )
+  {
+    for ( RangeBlock &block: blocks )
+    {
+      model.evaluate( block );
+    }
+  }
+  double blockTime = bench::seconds() - start;
+
+  // One observation at a time
+  std::vector< double > range( numObservations ), rate( numObservations );
+  std::vector< double > partials( 6 * numObservations );
+  start = bench::seconds();
+  for ( int r = 0; r < kNumRepeats; ++r )
+  {
+    for ( std::size_t k = 0; k < numObservations; ++k )
+    {
+      scalarRangeRate( times[k], kStations[ k % 3 ], states[k].data(),
+                       range[k], rate[k], &partials[ 6 * k ] );
+    }
+  }
+  double scalarTime = bench::seconds() - start;
+
+  double maxDiff = 0.0;
+  for ( std::size_t k = 0; k < numObservations; ++k )
+  {
+    const RangeBlock &block = blocks[ k / kBlockSize ];
+    std::size_t i = k % kBlockSize;
+    maxDiff = std::max( maxDiff, std::abs( block.range( i ) - range[k] ) );
+    maxDiff = std::max( maxDiff, std::abs( block.rangeRate( i ) - rate[k] ) );
+    for ( int c = 0; c < 3; ++c )
+    {
+      maxDiff = std::max( maxDiff,
+                          std::abs( block.rangeRateWrtPosition[c]( i ) -
+                                    partials[ 6 * k + c ] ) );
+      maxDiff = std::max( maxDiff,
+                          std::abs( block.rangeRateWrtStation[c]( i ) -
+                                    partials[ 6 * k + 3 + c ] ) );
+    }
+  }
+
+  double worstPartial = 0.0;
+  for ( std::size_t k = 0; k < times.size(); k += 9973 )
+  {
+    worstPartial = std::max( worstPartial,
+                             checkPartials( states[k], times[k], 1 + k % 3 ) );
+  }
+
+  double perObservation = 1.E9 / ( double( kNumRepeats ) * numObservations );
+  std::cout << numObservations << " observations in blocks of "
+            << kBlockSize << std::endl
+            << "   ns per observation,  blocks: "
+            << perObservation * blockTime
+            << "  one at a time: " << perObservation * scalarTime
+            << std::endl
+            << "   max |block - one at a time|: " << maxDiff
+            << std::endl
+            << "   worst relative partials error vs central differences: "
+            << worstPartial << std::endl;
+  return 0;
+}
@@ -0,0 +1,127 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_rhs.cpp
+/// @brief   Time the OdeintHelper right hand side and count the heap
+///          allocations it makes per call.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The right hand side is meant to be allocation free once agents are
+/// activated. This benchmark interposes the glibc malloc family to
+/// count allocations made during the timed calls, and exits non-zero if
+/// any are seen so a regression shows up as a failing run. Counting at
+/// malloc catches both operator new and Eigen's dynamic matrices, which
+/// allocate with malloc directly.
+///
+
+// C++ Standard Library
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+
+// ekf Library
+#include <OdeintHelper.hpp>
+#include <bench/BenchScenario.hpp>
+
+static std::size_t g_allocations = 0;
+
+// Counting wrappers around the glibc allocator. operator new and Eigen
+// both end up here.
+extern "C"
+{
+
+void* __libc_malloc( std::size_t size );
+void* __libc_calloc( std::size_t count, std::size_t size );
+void* __libc_realloc( void* p, std::size_t size );
+void* __libc_memalign( std::size_t alignment, std::size_t size );
+void __libc_free( void* p );
+
+void* malloc( std::size_t size ) noexcept
+{
+  ++g_allocations;
+  return __libc_malloc( size );
+}
+
+void* calloc( std::size_t count, std::size_t size ) noexcept
+{
+  ++g_allocations;
+  return __libc_calloc( count, size );
+}
+
+void* realloc( void* p, std::size_t size ) noexcept
+{
+  ++g_allocations;
+  return __libc_realloc( p, size );
+}
+
+void* aligned_alloc( std::size_t alignment, std::size_t size ) noexcept
+{
+  ++g_allocations;
+  return __libc_memalign( alignment, size );
+}
+
+int posix_memalign( void** p, std::size_t alignment,
+                    std::size_t size ) noexcept
+{
+  ++g_allocations;
+  *p = __libc_memalign( alignment, size );
+  return *p ? 0 : ENOMEM;
+}
+
+void free( void* p ) noexcept
+{
+  __libc_free( p );
+}
+
+} // extern "C"
+
+int
+main()
+{
+  const int numCalls = 100000;
+  int status = 0;
+
+  std::vector< std::shared_ptr< Action > > actions = {
+    bench::earthGravity(), bench::earthAtmosphere() };
+
+  for ( int numAgents: { 6, 9, 12, 18 } )
+  {
+    std::vector< std::string > agents = bench::activeAgents( numAgents );
+    OdeintHelper helper( actions, agents );
+    helper.activateAgents();
+
+    // State followed by an identity STM
+    std::vector< double > x = bench::initialState();
+    x.resize( 6 + numAgents * numAgents, 0.0 );
+    for ( int i = 0; i < numAgents; ++i )
+    {
+      x[ 6 + i * numAgents + i ] = 1.0;
+    }
+    std::vector< double > dxdt( x.size(), 0.0 );
+
+    std::size_t allocationsBefore = g_allocations;
+    double start = bench::seconds();
+    for ( int i = 0; i < numCalls; ++i )
+    {
+      helper( x, dxdt, 0.0 );
+    }
+    double elapsed = bench::seconds() - start;
+    std::size_t allocations = g_allocations - allocationsBefore;
+
+    std::cout << "agents: " << numAgents
+              << "   ns/call: " << 1.E9 * elapsed / numCalls
+              << "   allocations/call: "
+              << static_cast< double >( allocations ) / numCalls
+              << std::endl;
+
+    if ( allocations != 0 )
+    {
+      std::cout << "ERROR: OdeintHelper::operator() allocated on the heap"
+                << std::endl;
+      status = 1;
+    }
+  }
+
+  return status;
+}
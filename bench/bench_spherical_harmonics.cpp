@@ -0,0 +1,288 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_spherical_harmonics.cpp
+/// @brief   Check the spherical harmonic gravity Action and time it
+///          against the degree of the field.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// A synthetic degree 360 Earth field, the ekf_main.cpp J2 plus random
+/// coefficients following Kaula's rule, is written to $TMPDIR ( or
+/// /tmp ) and loaded back. The field cut to J2 is checked against
+/// GravityAction, and the gradient of the full field against the Dual
+/// differentiated sum and central differences along the ekf_main.cpp
+/// orbit. Then the cost of getAcceleration and evaluate is reported per
+/// degree, and the degree the truncation keeps per altitude. Fails if
+/// any check does not agree.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// ekf Library
+#include <GravityAction.hpp>
+#include <GravityField.hpp>
+#include <Kinematics.hpp>
+#include <Motion.hpp>
+#include <SphericalHarmonicAction.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kRadius = 6378136.3;
+const double kMu = 3.986004415E+14;
+const double kJ2 = 1.082626925638815E-3;
+const double kRotation = 7.29211585530066E-5;
+const int kDegree = 360;
+
+// Write a field of degree "degree": the J2 of ekf_main.cpp and, if
+// "random", Kaula's rule coefficients 1.E-5 / n^2 for the rest
+void
+writeField( const std::string &path, int degree, bool random )
+{
+  std::size_t size = GravityField::index( degree + 1, 0 );
+  std::vector< double > C( size, 0.0 ), S( size, 0.0 );
+  std::mt19937 generator( 42 );
+  std::normal_distribution< double > normal;
+  for ( int n = 2; ( n <= degree ) && random; ++n )
+  {
+    for ( int m = 0; m <= n; ++m )
+    {
+      C[ GravityField::index( n, m ) ] = 1.E-5 / ( n * n ) *
+                                         normal( generator );
+      S[ GravityField::index( n, m ) ] = ( m > 0 ) ?
+        1.E-5 / ( n * n ) * normal( generator ) : 0.0;
+    }
+  }
+  C[0] = 1.0;
+  C[ GravityField::index( 2, 0 ) ] = -kJ2 / std::sqrt( 5.0 );
+  GravityField::write( path, kMu, kRadius, degree, C, S );
+}
+
+// Acceleration and partials wrt X, Y, Z, mu of "action", 3 x 4
+void
+partialsOf( const Action &action, bool automatic, const Kinematics &k,
+            double *a, double *partials )
+{
+  std::vector< std::string > agents = { "X", "Y", "Z", "mu" };
+  AgentIndex index = action.indexAgents( agents );
+  std::fill( a, a + 3, 0.0 );
+  std::fill( partials, partials + 12, 0.0 );
+  if ( automatic )
+  {
+    action.evaluateAutomatic( a, partials, k, index );
+  }
+  else
+  {
+    action.evaluate( a, partials, k, index );
+  }
+}
+
+// Worst difference of two 3 x 4 partials blocks relative to the
+// largest element of each column, and of the accelerations relative
+// to their size
+double
+worstError( const double *a, const double *partialsA, const double *b,
+            const double *partialsB )
+{
+  double size = std::sqrt( b[0] * b[0] + b[1] * b[1] + b[2] * b[2] );
+  double worst = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    worst = std::max( worst, std::abs( a[i] - b[i] ) / size );
+  }
+  for ( int j = 0; j < 4; ++j )
+  {
+    double scale = 0.0, error = 0.0;
+    for ( int i = 0; i < 3; ++i )
+    {
+      scale = std::max( scale, std::abs( partialsB[ 4 * i + j ] ) );
+      error = std::max( error, std::abs( partialsA[ 4 * i + j ] -
+                                         partialsB[ 4 * i + j ] ) );
+    }
+    worst = std::max( worst, error / scale );
+  }
+  return worst;
+}
+
+// Central difference position partials of getAcceleration, in the
+// first three columns of a 3 x 4 block; the mu column is copied from
+// "partials"
+void
+centralDifferences( const Action &action, const std::vector< double > &state,
+                    double t, const double *partials, double *numeric )
+{
+  for ( int j = 0; j < 3; ++j )
+  {
+    double h = 1.0;
+    std::vector< double > plus = state, minus = state;
+    plus[j] += h;
+    minus[j] -= h;
+    Kinematics k( action.getRotationRate() );
+    double aPlus[3] = { 0.0, 0.0, 0.0 }, aMinus[3] = { 0.0, 0.0, 0.0 };
+    k.update( plus.data(), t );
+    action.getAcceleration( aPlus, k );
+    k.update( minus.data(), t );
+    action.getAcceleration( aMinus, k );
+    for ( int i = 0; i < 3; ++i )
+    {
+      numeric[ 4 * i + j ] = ( aPlus[i] - aMinus[i] ) / ( 2 * h );
+      numeric[ 4 * i + 3 ] = partials[ 4 * i + 3 ];
+    }
+  }
+}
+
+// Nanoseconds per call of getAcceleration and evaluate at "k"
+void
+timeAction( const Action &action, const Kinematics &k, int numCalls,
+            double &accelerationTime, double &evaluateTime )
+{
+  std::vector< std::string > agents = bench::activeAgents( 7 );
+  AgentIndex index = action.indexAgents( agents );
+  std::vector< double > partials( 3 * agents.size(), 0.0 );
+  double a[3] = { 0.0, 0.0, 0.0 };
+
+  double start = bench::seconds();
+  for ( int i = 0; i < numCalls; ++i )
+  {
+    action.getAcceleration( a, k );
+  }
+  accelerationTime = 1.E9 * ( bench::seconds() - start ) / numCalls;
+  start = bench::seconds();
+  for ( int i = 0; i < numCalls; ++i )
+  {
+    action.evaluate( a, partials.data(), k, index );
+  }
+  evaluateTime = 1.E9 * ( bench::seconds() - start ) / numCalls;
+}
+
+} // namespace
+
+int
+main()
+{
+  int status = 0;
+  const char *tmp = std::getenv( "TMPDIR" );
+  std::string directory = tmp ? tmp : "/tmp";
+  std::string j2Path = directory + "/bench_spherical_harmonics_j2.grv";
+  std::string fieldPath = directory + "/bench_spherical_harmonics.grv";
+  writeField( j2Path, 2, false );
+  writeField( fieldPath, kDegree, true );
+  std::shared_ptr< const GravityField > j2Field =
+    std::make_shared< GravityField >( j2Path );
+  std::shared_ptr< const GravityField > field =
+    std::make_shared< GravityField >( fieldPath );
+  std::remove( j2Path.c_str() );
+  std::remove( fieldPath.c_str() );
+
+  // States along one revolution of the ekf_main.cpp orbit
+  Motion motion( bench::initialState(), 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.setLogPolicy( Motion::kLogStateOnly );
+  motion.stepTo( 6000.0 );
+  std::vector< double > times;
+  std::vector< std::vector< double > > states;
+  for ( double t = 0.0; t <= 6000.0; t += 500.0 )
+  {
+    times.push_back( t );
+    states.push_back( motion.getState( t ) );
+  }
+
+  // J2 alone against GravityAction, and the full field's gradient
+  // against Duals and central differences
+  SphericalHarmonicAction j2Action( "Earth", j2Field, kRotation );
+  GravityAction gravity = bench::earthGravityModel();
+  SphericalHarmonicAction action( "Earth", field, kRotation );
+  action.setTruncation( 0.0 );
+  double j2Error = 0.0, dualError = 0.0, differenceError = 0.0;
+  for ( std::size_t i = 0; i < states.size(); ++i )
+  {
+    Kinematics k( kRotation );
+    k.update( states[i].data(), times[i] );
+    double a[3], partials[12], b[3], reference[12], numeric[12];
+
+    partialsOf( j2Action, false, k, a, partials );
+    partialsOf( gravity, false, k, b, reference );
+    j2Error = std::max( j2Error, worstError( a, partials, b, reference ) );
+
+    partialsOf( action, false, k, a, partials );
+    partialsOf( action, true, k, b, reference );
+    dualError = std::max( dualError,
+                          worstError( a, partials, b, reference ) );
+    centralDifferences( action, states[i], times[i], partials, numeric );
+    differenceError = std::max( differenceError,
+                                worstError( a, partials, a, numeric ) );
+  }
+  std::cout << "Degree " << kDegree << " field" << std::endl
+            << "   worst relative error,  J2 field vs GravityAction: "
+            << j2Error << std::endl
+            << "   evaluate vs evaluateAutomatic: " << dualError
+            << "  vs central differences: " << differenceError
+            << std::endl;
+  if ( ( j2Error > 1.E-12 ) || ( dualError > 1.E-10 ) ||
+       ( differenceError > 1.E-6 ) )
+  {
+    std::cout << "ERROR: spherical harmonic partials disagree" << std::endl;
+    status = 1;
+  }
+
+  // Cost per degree, at the ekf_main.cpp initial state
+  Kinematics k( kRotation );
+  k.update( bench::initialState().data(), 0.0 );
+  double pointTime, pointEvaluateTime;
+  timeAction( gravity, k, 2000000, pointTime, pointEvaluateTime );
+  std::cout << "ns per call,  GravityAction: getAcceleration "
+            << pointTime << "  evaluate " << pointEvaluateTime << std::endl
+            << "   degree  getAcceleration  evaluate" << std::endl;
+  const int kDegrees[] = { 2, 4, 8, 16, 30, 50, 70, 100, 120, 200, 360 };
+  for ( int degree: kDegrees )
+  {
+    action.setDegree( degree );
+    int numCalls = 20000000 / ( ( degree + 3 ) * ( degree + 3 ) );
+    double accelerationTime, evaluateTime;
+    timeAction( action, k, numCalls, accelerationTime, evaluateTime );
+    std::cout << "   " << std::setw( 6 ) << degree << "  "
+              << std::setw( 15 ) << accelerationTime << "  "
+              << std::setw( 8 ) << evaluateTime << std::endl;
+  }
+
+  // Degree kept by the default truncation, and its error against the
+  // whole field
+  SphericalHarmonicAction truncated( "Earth", field, kRotation );
+  action.setDegree( kDegree );
+  std::cout << "Truncation at 1e-12" << std::endl
+            << "   altitude km  degree  relative error" << std::endl;
+  const double kAltitudes[] = { 300., 700., 2000., 5000., 20000., 35786. };
+  for ( double altitude: kAltitudes )
+  {
+    double r = kRadius + 1000. * altitude;
+    std::vector< double > state = { r * 0.6, r * 0.48, r * 0.64,
+                                    0.0, 0.0, 0.0 };
+    Kinematics kr( kRotation );
+    kr.update( state.data(), 0.0 );
+    double full[3] = { 0.0, 0.0, 0.0 }, cut[3] = { 0.0, 0.0, 0.0 };
+    action.getAcceleration( full, kr );
+    truncated.getAcceleration( cut, kr );
+    double error = 0.0, size = 0.0;
+    for ( int i = 0; i < 3; ++i )
+    {
+      error += ( cut[i] - full[i] ) * ( cut[i] - full[i] );
+      size += full[i] * full[i];
+    }
+    std::cout << "   " << std::setw( 11 ) << altitude << "  "
+              << std::setw( 6 ) << truncated.getDegree( r ) << "  "
+              << std::sqrt( error / size ) << std::endl;
+  }
+  return status;
+}
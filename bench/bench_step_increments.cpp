@@ -0,0 +1,65 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_step_increments.cpp
+/// @brief   Time stepping a Motion over an arc in many small increments,
+///          as a filter does once per measurement, against a single
+///          call.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kArcLength = 86400.0;
+
+// Step over the arc in increments of "increment" seconds
+std::vector< double >
+propagate( double increment )
+{
+  Motion motion( bench::initialState(), 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  std::vector< std::string > agents = bench::activeAgents( 9 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+  motion.setLogPolicy( Motion::kLogNothing );
+
+  double start = bench::seconds();
+  int numCalls = std::ceil( kArcLength / increment );
+  for ( int i = 1; i <= numCalls; ++i )
+  {
+    motion.stepTo( std::min( kArcLength, i * increment ) );
+  }
+  double elapsed = bench::seconds() - start;
+
+  std::cout << "increment " << increment << " s, " << numCalls
+            << " calls: " << 1.E3 * elapsed << " ms" << std::endl;
+  return motion.getState( kArcLength );
+}
+
+} // namespace
+
+int
+main()
+{
+  std::vector< double > single = propagate( kArcLength );
+  for ( double increment: { 600., 60., 10., 1. } )
+  {
+    std::vector< double > state = propagate( increment );
+    std::cout << "   final position difference vs single call ( m ): "
+              << std::abs( state[0] - single[0] ) +
+                 std::abs( state[1] - single[1] ) +
+                 std::abs( state[2] - single[2] ) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,196 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_tabulated_atmosphere.cpp
+/// @brief   Check the tabulated atmosphere and time its uniform cell
+///          lookup against a search over the bands.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// The density of TabulatedAtmosphereAction is compared with the band
+/// formula at every band base and at random altitudes from 0 to 1100
+/// km, where the band is found by binary search, and the two lookups
+/// are timed. The batch acceleration is checked against the scalar
+/// one, getAcceleration is timed against the single exponential
+/// AtmosphereAction, and the ekf_main.cpp orbit is flown for a day with
+/// each atmosphere. Fails if the densities or accelerations disagree.
+///
+
+// C++ Standard Library
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// ekf Library
+#include <BatchKinematics.hpp>
+#include <Motion.hpp>
+#include <TabulatedAtmosphereAction.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kRadius = 6378136.3;
+const double kRotation = 7.29211585530066E-5;
+const int kNumSamples = 1000000;
+const int kNumRepeats = 20;
+
+// Density from the band found by binary search
+double
+searchDensity( const std::vector< AtmosphereBand > &bands, double height )
+{
+  std::vector< AtmosphereBand >::const_iterator band = std::upper_bound(
+    bands.begin(), bands.end(), height,
+    []( double h, const AtmosphereBand &b ) { return h < b.height; } );
+  if ( band != bands.begin() )
+  {
+    --band;
+  }
+  return band->density * std::exp( -( height - band->height ) /
+                                   band->scaleHeight );
+}
+
+} // namespace
+
+int
+main()
+{
+  int status = 0;
+  double bodyDragTerm = ( 1.0 / 2.0 ) * 2.0 * ( 3.0 / 970.0 );
+  TabulatedAtmosphereAction atmosphere( "Earth Atmosphere", kRadius,
+                                        kRotation, bodyDragTerm );
+  const std::vector< AtmosphereBand > &bands =
+    TabulatedAtmosphereAction::standardBands();
+
+  // Table values at the band bases, and random altitudes
+  double worst = 0.0;
+  for ( const AtmosphereBand &band: bands )
+  {
+    worst = std::max( worst, std::abs( atmosphere.getDensity(
+      kRadius + band.height ) / band.density - 1.0 ) );
+  }
+  std::mt19937 generator( 7 );
+  std::uniform_real_distribution< double > altitude( 0.0, 1.1E6 );
+  std::vector< double > heights( kNumSamples );
+  for ( double &h: heights )
+  {
+    h = altitude( generator );
+    worst = std::max( worst, std::abs( atmosphere.getDensity( kRadius + h ) /
+                                       searchDensity( bands, h ) - 1.0 ) );
+  }
+
+  double start = bench::seconds();
+  double sum = 0.0;
+  for ( int r = 0; r < kNumRepeats; ++r )
+  {
+    for ( double h: heights )
+    {
+      sum += atmosphere.getDensity( kRadius + h );
+    }
+  }
+  double cellTime = bench::seconds() - start;
+  start = bench::seconds();
+  for ( int r = 0; r < kNumRepeats; ++r )
+  {
+    for ( double h: heights )
+    {
+      sum -= searchDensity( bands, h );
+    }
+  }
+  double searchTime = bench::seconds() - start;
+
+  // Batch lanes against one at a time, along the ekf_main.cpp orbit
+  Motion motion( bench::initialState(), 10. );
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( std::make_shared< TabulatedAtmosphereAction >(
+    atmosphere ) );
+  motion.setLogPolicy( Motion::kLogStateOnly );
+  motion.stepTo( 86400.0 );
+  BatchKinematics batch( kRotation );
+  std::vector< double > batchState( 6 * BatchKinematics::kLanes );
+  for ( int l = 0; l < BatchKinematics::kLanes; ++l )
+  {
+    std::vector< double > state = motion.getState( 700.0 * l );
+    for ( int c = 0; c < 6; ++c )
+    {
+      batchState[ c * BatchKinematics::kLanes + l ] = state[c];
+    }
+  }
+  batch.update( batchState.data(), 0.0 );
+  BatchKinematics::Lanes lanes[3];
+  for ( int i = 0; i < 3; ++i )
+  {
+    lanes[i].setZero();
+  }
+  atmosphere.getBatchAcceleration( lanes, batch );
+  double batchError = 0.0;
+  for ( int l = 0; l < BatchKinematics::kLanes; ++l )
+  {
+    Kinematics k( kRotation );
+    k.update( motion.getState( 700.0 * l ).data(), 0.0 );
+    double a[3] = { 0.0, 0.0, 0.0 };
+    atmosphere.getAcceleration( a, k );
+    for ( int i = 0; i < 3; ++i )
+    {
+      batchError = std::max( batchError,
+                             std::abs( lanes[i]( l ) / a[i] - 1.0 ) );
+    }
+  }
+
+  // Cost of the acceleration against the single exponential
+  Kinematics k( kRotation );
+  k.update( bench::initialState().data(), 0.0 );
+  AtmosphereAction exponential = bench::earthAtmosphereModel();
+  double a[3] = { 0.0, 0.0, 0.0 };
+  start = bench::seconds();
+  for ( int i = 0; i < kNumSamples * kNumRepeats; ++i )
+  {
+    atmosphere.getAcceleration( a, k );
+  }
+  double tabulatedTime = bench::seconds() - start;
+  start = bench::seconds();
+  for ( int i = 0; i < kNumSamples * kNumRepeats; ++i )
+  {
+    exponential.getAcceleration( a, k );
+  }
+  double exponentialTime = bench::seconds() - start;
+
+  // A day of the ekf_main.cpp orbit with each atmosphere
+  Motion reference( bench::initialState(), 10. );
+  reference.addAction( bench::earthGravity() );
+  reference.addAction( bench::earthAtmosphere() );
+  reference.setLogPolicy( Motion::kLogStateOnly );
+  reference.stepTo( 86400.0 );
+  std::vector< double > tabulatedEnd = motion.getState( 86400.0 );
+  std::vector< double > exponentialEnd = reference.getState( 86400.0 );
+  double separation = 0.0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    separation += ( tabulatedEnd[i] - exponentialEnd[i] ) *
+                  ( tabulatedEnd[i] - exponentialEnd[i] );
+  }
+
+  double perCall = 1.E9 / ( double( kNumRepeats ) * kNumSamples );
+  std::cout << "Tabulated atmosphere, " << bands.size() << " bands"
+            << std::endl
+            << "   worst relative density error vs band search: " << worst
+            << std::endl
+            << "   ns per density,  cells: " << perCall * cellTime
+            << "  band search: " << perCall * searchTime << std::endl
+            << "   worst relative batch acceleration error: " << batchError
+            << std::endl
+            << "   ns per getAcceleration,  tabulated: "
+            << perCall * tabulatedTime << "  exponential: "
+            << perCall * exponentialTime << std::endl
+            << "   ekf_main.cpp orbit after a day, tabulated vs exponential "
+            << "atmosphere: " << std::sqrt( separation ) << " m" << std::endl
+            << "   ( checksum " << sum << " )" << std::endl;
+  if ( ( worst > 1.E-12 ) || ( batchError > 1.E-12 ) )
+  {
+    std::cout << "ERROR: tabulated atmosphere disagrees" << std::endl;
+    status = 1;
+  }
+  return status;
+}
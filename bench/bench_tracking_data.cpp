@@ -0,0 +1,111 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_tracking_data.cpp
+/// @brief   Compare reading tracking data from CSV with streaming it
+///          from a memory-mapped binary file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Two million records from three stations are written as CSV to
+/// $TMPDIR ( or /tmp ), converted to binary, and then read back both
+/// ways. Both reads must see the same data.
+///
+
+// C++ Standard Library
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// ekf Library
+#include <TrackingData.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const int kNumRecords = 2000000;
+
+// Sum of every field, to check the two reads agree
+double
+checksum( const TrackingRecord &r )
+{
+  return r.time + r.station + r.range + r.rangeRate + r.rangeSigma +
+         r.rangeRateSigma;
+}
+
+} // namespace
+
+int
+main()
+{
+  const char *tmp = std::getenv( "TMPDIR" );
+  std::string directory = tmp ? tmp : "/tmp";
+  std::string csvPath = directory + "/bench_tracking_data.csv";
+  std::string binaryPath = directory + "/bench_tracking_data.trk";
+
+  // One sample per second, cycling through three stations
+  {
+    std::ofstream csv( csvPath.c_str() );
+    csv << "time,station,range,range_rate,range_sigma,range_rate_sigma\n"
+        << std::setprecision( 17 );
+    for ( int i = 0; i < kNumRecords; ++i )
+    {
+      csv << i << ',' << 1 + i % 3 << ',' << 1.E6 + 1234.5678901 * ( i % 997 )
+          << ',' << -3000. + 0.01234567 * ( i % 1009 ) << ",1.5,0.001\n";
+    }
+  }
+
+  double start = bench::seconds();
+  std::size_t count = TrackingFile::convertCsv( csvPath, binaryPath );
+  double convertTime = bench::seconds() - start;
+
+  // Read the CSV as a filter would without the binary format
+  start = bench::seconds();
+  double csvSum = 0.0;
+  {
+    std::ifstream csv( csvPath.c_str() );
+    std::string line;
+    std::getline( csv, line );
+    while ( std::getline( csv, line ) )
+    {
+      TrackingRecord r;
+      char *p = const_cast< char* >( line.c_str() );
+      r.time = std::strtod( p, &p );
+      r.station = std::strtol( p + 1, &p, 10 );
+      r.range = std::strtod( p + 1, &p );
+      r.rangeRate = std::strtod( p + 1, &p );
+      r.rangeSigma = std::strtod( p + 1, &p );
+      r.rangeRateSigma = std::strtod( p + 1, &p );
+      csvSum += checksum( r );
+    }
+  }
+  double csvTime = bench::seconds() - start;
+
+  // Stream the binary file
+  start = bench::seconds();
+  double binarySum = 0.0;
+  {
+    TrackingFile file( binaryPath );
+    for ( const TrackingRecord &r: file )
+    {
+      binarySum += checksum( r );
+    }
+  }
+  double binaryTime = bench::seconds() - start;
+
+  std::cout << count << " records, " << sizeof( TrackingRecord )
+            << " bytes each" << std::endl
+            << "   CSV to binary conversion s: " << convertTime << std::endl
+            << "   ns per record,  CSV parse: " << 1.E9 * csvTime / count
+            << "  mapped binary: " << 1.E9 * binaryTime / count << std::endl
+            << "   checksums agree: " << ( csvSum == binarySum ? "yes" : "NO" )
+            << std::endl;
+
+  std::remove( csvPath.c_str() );
+  std::remove( binaryPath.c_str() );
+  return ( csvSum == binarySum ) ? 0 : 1;
+}
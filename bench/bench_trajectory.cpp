@@ -0,0 +1,69 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_trajectory.cpp
+/// @brief   Time a multi-day propagation with the logged history kept on
+///          the heap and spilled to memory-mapped files.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <iostream>
+
+// ekf Library
+#include <Motion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+const double kArcLength = 3 * 86400.0;
+
+double
+propagate( Motion &motion )
+{
+  motion.addAction( bench::earthGravity() );
+  motion.addAction( bench::earthAtmosphere() );
+  std::vector< std::string > agents = bench::activeAgents( 18 );
+  motion.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+
+  double start = bench::seconds();
+  motion.stepTo( kArcLength );
+  return bench::seconds() - start;
+}
+
+} // namespace
+
+int
+main()
+{
+  Motion onHeap( bench::initialState(), 60. );
+  double heapTime = propagate( onHeap );
+
+  Motion spilled( bench::initialState(), 60. );
+  spilled.setHistorySpill( 1 << 20, "/tmp" );
+  double spilledTime = propagate( spilled );
+
+  // Both histories must answer queries identically
+  double maxDiff = 0.0;
+  for ( int i = 0; i < 1000; ++i )
+  {
+    double t = kArcLength * ( i + 0.25 ) / 1000;
+    std::vector< double > a = onHeap.getStatePartials( t );
+    std::vector< double > b = spilled.getStatePartials( t );
+    for ( std::size_t j = 0; j < a.size(); ++j )
+    {
+      maxDiff = std::max( maxDiff, std::abs( a[j] - b[j] ) );
+    }
+  }
+
+  std::cout << "18 agents over " << kArcLength / 86400. << " days" << std::endl
+            << "   history on heap ms: " << 1.E3 * heapTime << std::endl
+            << "   history spilled ms: " << 1.E3 * spilledTime << std::endl
+            << "   max |query difference|: " << maxDiff << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,174 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    bench_unscented.cpp
+/// @brief   Compare covariance propagation through the STM with the
+///          unscented transform on a drag arc.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// A low orbit with a wide initial covariance is propagated for a day
+/// with a Monte Carlo sample as reference, with the 12 x 12 STM of a
+/// Motion, and with UnscentedMotion. The mean and the position block of
+/// the covariance are compared with the sample mean and covariance, and
+/// the right hand side calls of the sigma points with those of the STM.
+///
+
+// C++ Standard Library
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Eigen Library
+#include <Eigen/Dense>
+
+// ekf Library
+#include <BatchMotion.hpp>
+#include <Motion.hpp>
+#include <UnscentedMotion.hpp>
+#include <bench/BenchScenario.hpp>
+
+namespace
+{
+
+typedef Eigen::Matrix< double, 6, 6, Eigen::RowMajor > StateMatrix;
+typedef Eigen::Matrix< double, 6, 1 > StateVector;
+
+const int kNumSamples = 4000;
+const double kArcLength = 86400.0;
+
+// The ekf_main.cpp orbit lowered to about 400 km, deep in the
+// atmosphere model
+std::vector< double >
+lowOrbit()
+{
+  std::vector< double > ic = bench::initialState();
+  double scale = 6778136.3 / std::sqrt( ic[0] * ic[0] + ic[1] * ic[1] +
+                                        ic[2] * ic[2] );
+  for ( int i = 0; i < 3; ++i )
+  {
+    ic[i] *= scale;
+    ic[i + 3] /= std::sqrt( scale );
+  }
+  return ic;
+}
+
+// 1 km and 1 m/s standard deviations
+StateMatrix
+initialCovariance()
+{
+  StateVector sigma;
+  sigma << 1000., 1000., 1000., 1., 1., 1.;
+  return sigma.array().square().matrix().asDiagonal();
+}
+
+void
+report( const char *label, double ms, unsigned long rhs,
+        const StateVector &mean, const StateMatrix &covariance,
+        const StateVector &refMean, const StateMatrix &refCovariance )
+{
+  double meanError = ( mean - refMean ).head< 3 >().norm();
+  double covarianceError =
+    ( covariance - refCovariance ).topLeftCorner< 3, 3 >().norm() /
+    refCovariance.topLeftCorner< 3, 3 >().norm();
+  std::cout << "   " << label << "  ms: " << ms << "  rhs calls: " << rhs
+            << "  mean position error ( m ): " << meanError
+            << "  relative position covariance error: " << covarianceError
+            << std::endl;
+}
+
+} // namespace
+
+int
+main()
+{
+  std::vector< double > ic = lowOrbit();
+  StateVector mean0 = Eigen::Map< const StateVector >( ic.data() );
+  StateMatrix P0 = initialCovariance();
+  std::vector< double > P0Vector( P0.data(), P0.data() + 36 );
+
+  // Monte Carlo reference
+  BatchMotion samples( 10. );
+  samples.addAction( bench::earthGravity() );
+  samples.addAction( bench::earthAtmosphere() );
+  std::mt19937 generator( 2015 );
+  std::normal_distribution< double > normal;
+  StateMatrix root = P0.llt().matrixL();
+  for ( int k = 0; k < kNumSamples; ++k )
+  {
+    StateVector z;
+    for ( int i = 0; i < 6; ++i )
+    {
+      z( i ) = normal( generator );
+    }
+    StateVector x = mean0 + root * z;
+    samples.addAgent( std::vector< double >( x.data(), x.data() + 6 ) );
+  }
+  double start = bench::seconds();
+  samples.stepTo( kArcLength );
+  double sampleTime = bench::seconds() - start;
+
+  StateVector refMean = StateVector::Zero();
+  for ( int k = 0; k < kNumSamples; ++k )
+  {
+    refMean += Eigen::Map< const StateVector >(
+      samples.getState( k ).data() );
+  }
+  refMean /= kNumSamples;
+  StateMatrix refCovariance = StateMatrix::Zero();
+  for ( int k = 0; k < kNumSamples; ++k )
+  {
+    StateVector d = Eigen::Map< const StateVector >(
+      samples.getState( k ).data() ) - refMean;
+    refCovariance += d * d.transpose();
+  }
+  refCovariance /= kNumSamples - 1;
+
+  std::cout << "400 km orbit over " << kArcLength << " s, initial sigma "
+            << "1 km, 1 m/s" << std::endl
+            << "   Monte Carlo, " << kNumSamples << " samples  ms: "
+            << 1.E3 * sampleTime << "  ( sampling error of the covariance "
+            << "about " << std::sqrt( 2.0 / kNumSamples ) << " )"
+            << std::endl;
+
+  // Linearized: mean through the dynamics, covariance through the STM
+  Motion linear( ic, 10. );
+  linear.addAction( bench::earthGravity() );
+  linear.addAction( bench::earthAtmosphere() );
+  std::vector< std::string > agents = bench::activeAgents( 12 );
+  linear.activateAgents(
+    std::vector< std::string >( agents.begin() + 6, agents.end() ) );
+  linear.setLogPolicy( Motion::kLogNothing );
+  start = bench::seconds();
+  linear.stepTo( kArcLength );
+  double linearTime = bench::seconds() - start;
+
+  std::vector< double > phi = linear.getStatePartials( kArcLength );
+  Eigen::Map< const Eigen::Matrix< double, 12, 12, Eigen::RowMajor > >
+    stm( phi.data() );
+  StateMatrix phiState = stm.topLeftCorner< 6, 6 >();
+  StateMatrix linearCovariance = phiState * P0 * phiState.transpose();
+  report( "STM, 12 x 12 ", 1.E3 * linearTime, linear.getRhsCount(),
+          Eigen::Map< const StateVector >(
+            linear.getState( kArcLength ).data() ),
+          linearCovariance, refMean, refCovariance );
+
+  // Unscented
+  UnscentedMotion unscented( ic, P0Vector, 10. );
+  unscented.addAction( bench::earthGravity() );
+  unscented.addAction( bench::earthAtmosphere() );
+  start = bench::seconds();
+  unscented.stepTo( kArcLength );
+  double unscentedTime = bench::seconds() - start;
+  report( "unscented    ", 1.E3 * unscentedTime, unscented.getRhsCount(),
+          Eigen::Map< const StateVector >( unscented.getMean().data() ),
+          Eigen::Map< const StateMatrix >(
+            unscented.getCovariance().data() ),
+          refMean, refCovariance );
+  std::cout << "   sigma point / STM rhs calls: "
+            << double( unscented.getRhsCount() ) / linear.getRhsCount()
+            << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    csv_to_tracking.cpp
+/// @brief   Convert CSV tracking data to a binary tracking data file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Usage: csv_to_tracking input.csv output.trk
+///
+/// Each CSV line holds time, station, range, range-rate, range sigma
+/// and range-rate sigma; see TrackingFile::convertCsv.
+///
+
+// C++ Standard Library
+#include <exception>
+#include <iostream>
+
+// ekf Library
+#include <TrackingData.hpp>
+
+int
+main( int argc, char **argv )
+{
+  if ( argc != 3 )
+  {
+    std::cerr << "usage: " << argv[0] << " input.csv output.trk"
+              << std::endl;
+    return 2;
+  }
+
+  try
+  {
+    std::size_t count = TrackingFile::convertCsv( argv[1], argv[2] );
+    std::cout << "wrote " << count << " records to " << argv[2]
+              << std::endl;
+  }
+  catch ( const std::exception &e )
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
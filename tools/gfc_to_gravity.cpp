@@ -0,0 +1,48 @@
+// -*- coding:utf-8; mode:c++; mode:auto-fill; fill-column:80; -*-
+
+///
+/// @file    gfc_to_gravity.cpp
+/// @brief   Convert an ICGEM .gfc gravity model to a binary gravity
+///          field coefficient file.
+/// @author  Jonathon Smith <jonathon.j.smith@gmail.com>
+/// @date    January 24, 2015
+///
+/// Usage: gfc_to_gravity input.gfc output.grv [max degree]
+///
+/// The model must be fully normalized; see GravityField::convertGfc.
+/// The degree defaults to that of the model.
+///
+
+// C++ Standard Library
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+// ekf Library
+#include <GravityField.hpp>
+
+int
+main( int argc, char **argv )
+{
+  if ( ( argc != 3 ) && ( argc != 4 ) )
+  {
+    std::cerr << "usage: " << argv[0] << " input.gfc output.grv [max degree]"
+              << std::endl;
+    return 2;
+  }
+
+  try
+  {
+    int maxDegree = ( argc == 4 ) ? std::atoi( argv[3] )
+                                  : GravityField::kAllDegrees;
+    int degree = GravityField::convertGfc( argv[1], argv[2], maxDegree );
+    std::cout << "wrote degree " << degree << " field to " << argv[2]
+              << std::endl;
+  }
+  catch ( const std::exception &e )
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}